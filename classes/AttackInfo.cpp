@@ -0,0 +1,77 @@
+#include "AttackInfo.h"
+#include "Attacks.h"
+
+uint64_t AttackInfo::checkers()
+{
+    if (!cached(kCheckers)) _checkers = _pos->checkers();
+    return _checkers;
+}
+
+uint64_t AttackInfo::pinned()
+{
+    if (!cached(kPinned)) _pinned = _pos->pinnedPieces(_pos->sideToMove());
+    return _pinned;
+}
+
+uint64_t AttackInfo::kingDanger()
+{
+    if (cached(kKingDanger)) return _kingDanger;
+
+    int us = _pos->sideToMove(), them = us ^ 1;
+    uint64_t occ = _pos->occupied() ^ _pos->pieces(us, King);
+    uint64_t danger = 0;
+    uint64_t pawns = _pos->pieces(them, Pawn);
+    danger |= them == White ? ((pawns << 7) & ~Attacks::kFileH) | ((pawns << 9) & ~Attacks::kFileA)
+                            : ((pawns >> 9) & ~Attacks::kFileH) | ((pawns >> 7) & ~Attacks::kFileA);
+    for (uint64_t b = _pos->pieces(them, Knight); b;) danger |= Attacks::kKnight[popLsb(b)];
+    for (uint64_t b = _pos->diagonalSliders() & _pos->pieces(them); b;) danger |= Attacks::bishop(popLsb(b), occ);
+    for (uint64_t b = _pos->straightSliders() & _pos->pieces(them); b;) danger |= Attacks::rook(popLsb(b), occ);
+    danger |= Attacks::kKing[_pos->kingSquare(them)];
+    _kingDanger = danger;
+    return _kingDanger;
+}
+
+uint64_t AttackInfo::attacks(int colour, ChessPiece piece)
+{
+    if (!cached(colour == White ? kAttacksWhite : kAttacksBlack)) fillAttacks(colour);
+    return _attacks[colour][piece];
+}
+
+void AttackInfo::fillAttacks(int colour)
+{
+    uint64_t occ = _pos->occupied();
+    uint64_t* maps = _attacks[colour];
+    uint64_t pawns = _pos->pieces(colour, Pawn);
+    maps[Pawn] = colour == White ? ((pawns << 7) & ~Attacks::kFileH) | ((pawns << 9) & ~Attacks::kFileA)
+                                 : ((pawns >> 9) & ~Attacks::kFileH) | ((pawns >> 7) & ~Attacks::kFileA);
+    maps[Knight] = maps[Bishop] = maps[Rook] = maps[Queen] = 0;
+    for (uint64_t b = _pos->pieces(colour, Knight); b;) maps[Knight] |= Attacks::kKnight[popLsb(b)];
+    for (uint64_t b = _pos->pieces(colour, Bishop); b;) maps[Bishop] |= Attacks::bishop(popLsb(b), occ);
+    for (uint64_t b = _pos->pieces(colour, Rook); b;) maps[Rook] |= Attacks::rook(popLsb(b), occ);
+    for (uint64_t b = _pos->pieces(colour, Queen); b;) maps[Queen] |= Attacks::queen(popLsb(b), occ);
+    maps[King] = Attacks::kKing[_pos->kingSquare(colour)];
+    maps[NoPiece] = maps[Pawn] | maps[Knight] | maps[Bishop] | maps[Rook] | maps[Queen] | maps[King];
+}
+
+//
+// a king step has to avoid the danger squares. any other move has to take
+// or block a single checker, and a pinned piece has to stay on the line
+// through its king; past that it is legal. en passant goes the long way
+//
+bool AttackInfo::isLegal(Move m)
+{
+    if (m.isCastle()) return true;
+    int from = m.from(), to = m.to();
+    int king = _pos->kingSquare(_pos->sideToMove());
+    if (from == king) return !(kingDanger() & Attacks::squareBB(to));
+    if (m.flags() == kEnPassant) return _pos->isLegal(m);
+
+    uint64_t checks = checkers();
+    if (checks) {
+        if (checks & (checks - 1)) return false;
+        uint64_t block = Attacks::between(king, lsb(checks)) | checks;
+        if (!(block & Attacks::squareBB(to))) return false;
+    }
+    if (!(pinned() & Attacks::squareBB(from))) return true;
+    return (Attacks::between(king, to) & Attacks::squareBB(from)) || (Attacks::between(king, from) & Attacks::squareBB(to));
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Position.h"
+#include <cstdint>
+
+//
+// attack information of one node, worked out the first time something asks
+// for it and then shared by everything else in that node
+//
+// the search keeps one per ply and resets it on entering a node. in check
+// detection, the legality test of every move and the castling test of the
+// move generator then read the same checkers, pinned pieces and king danger
+// squares instead of each calling attackersTo() again. per piece attack
+// maps are there for the evaluation to read the same way
+//
+// each part is filled on its own, so a node that cuts off after one move
+// only pays for what that move needed
+//
+
+// how many attack sets were worked out and how many questions the cached
+// ones answered; reused is the attack work saved
+struct AttackStats
+{
+    uint64_t computed = 0;
+    uint64_t reused = 0;
+};
+
+class AttackInfo
+{
+public:
+    void reset(const Position& pos, AttackStats& stats)
+    {
+        _pos = &pos;
+        _stats = &stats;
+        _filled = 0;
+    }
+
+    // enemy pieces giving check
+    uint64_t checkers();
+    // our pieces that are the only thing between our king and an enemy slider
+    uint64_t pinned();
+    // squares attacked by the enemy with our king lifted off the board, so a
+    // king step is legal exactly when it does not land on one
+    uint64_t kingDanger();
+    // squares attacked by one colour's pieces of one type, NoPiece for all of them
+    uint64_t attacks(int colour, ChessPiece piece);
+
+    bool inCheck() { return checkers() != 0; }
+    // isLegal() of the position, answered from the sets above
+    bool isLegal(Move m);
+
+private:
+    enum : uint32_t { kCheckers = 1, kPinned = 2, kKingDanger = 4, kAttacksWhite = 8, kAttacksBlack = 16 };
+
+    bool cached(uint32_t part)
+    {
+        if (_filled & part) {
+            _stats->reused++;
+            return true;
+        }
+        _filled |= part;
+        _stats->computed++;
+        return false;
+    }
+    void fillAttacks(int colour);
+
+    const Position* _pos = nullptr;
+    AttackStats* _stats = nullptr;
+    uint32_t _filled = 0;
+    uint64_t _checkers = 0;
+    uint64_t _pinned = 0;
+    uint64_t _kingDanger = 0;
+    uint64_t _attacks[2][7] = {};
+};
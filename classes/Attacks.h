@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Bitboard.h"
+#include <array>
+
+//
+// attack tables for the engine, squares are a1 = 0 .. h8 = 63
+// leaper and ray tables are built at compile time so nothing needs initializing
+//
+
+namespace Attacks {
+
+constexpr uint64_t kFileA = 0x0101010101010101ULL;
+constexpr uint64_t kFileH = kFileA << 7;
+constexpr uint64_t kRank1 = 0xFFULL;
+constexpr uint64_t kRank8 = kRank1 << 56;
+
+constexpr uint64_t squareBB(int sq) { return 1ULL << sq; }
+
+namespace detail {
+
+using Table = std::array<uint64_t, 64>;
+
+constexpr uint64_t leaper(int sq, const int (&deltas)[8][2])
+{
+    uint64_t bb = 0;
+    int x = sq & 7, y = sq >> 3;
+    for (const auto& d : deltas) {
+        int nx = x + d[0], ny = y + d[1];
+        if (nx >= 0 && nx < 8 && ny >= 0 && ny < 8) bb |= 1ULL << (ny * 8 + nx);
+    }
+    return bb;
+}
+
+constexpr int kKnightDeltas[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+constexpr int kKingDeltas[8][2]   = { {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1} };
+
+constexpr Table makeKnight()
+{
+    Table t{};
+    for (int sq = 0; sq < 64; sq++) t[sq] = leaper(sq, kKnightDeltas);
+    return t;
+}
+
+constexpr Table makeKing()
+{
+    Table t{};
+    for (int sq = 0; sq < 64; sq++) t[sq] = leaper(sq, kKingDeltas);
+    return t;
+}
+
+constexpr std::array<Table, 2> makePawn()
+{
+    std::array<Table, 2> t{};
+    for (int sq = 0; sq < 64; sq++) {
+        uint64_t b = 1ULL << sq;
+        t[0][sq] = ((b << 7) & ~kFileH) | ((b << 9) & ~kFileA);
+        t[1][sq] = ((b >> 9) & ~kFileH) | ((b >> 7) & ~kFileA);
+    }
+    return t;
+}
+
+// ray directions: the first four step towards higher squares, the last four towards lower
+constexpr int kRayDeltas[8][2] = { {0, 1}, {1, 0}, {1, 1}, {-1, 1}, {0, -1}, {-1, 0}, {-1, -1}, {1, -1} };
+
+constexpr std::array<Table, 8> makeRays()
+{
+    std::array<Table, 8> t{};
+    for (int dir = 0; dir < 8; dir++) {
+        for (int sq = 0; sq < 64; sq++) {
+            uint64_t bb = 0;
+            int x = (sq & 7) + kRayDeltas[dir][0], y = (sq >> 3) + kRayDeltas[dir][1];
+            while (x >= 0 && x < 8 && y >= 0 && y < 8) {
+                bb |= 1ULL << (y * 8 + x);
+                x += kRayDeltas[dir][0];
+                y += kRayDeltas[dir][1];
+            }
+            t[dir][sq] = bb;
+        }
+    }
+    return t;
+}
+
+// squares strictly between two squares on a rank, file or diagonal, empty otherwise
+constexpr std::array<Table, 64> makeBetween()
+{
+    std::array<Table, 64> t{};
+    for (int from = 0; from < 64; from++) {
+        for (const auto& d : kRayDeltas) {
+            uint64_t passed = 0;
+            int x = (from & 7) + d[0], y = (from >> 3) + d[1];
+            while (x >= 0 && x < 8 && y >= 0 && y < 8) {
+                t[from][y * 8 + x] = passed;
+                passed |= 1ULL << (y * 8 + x);
+                x += d[0];
+                y += d[1];
+            }
+        }
+    }
+    return t;
+}
+
+} // namespace detail
+
+enum RayDirection { North, East, NorthEast, NorthWest, South, West, SouthWest, SouthEast };
+
+inline constexpr detail::Table kKnight = detail::makeKnight();
+inline constexpr detail::Table kKing = detail::makeKing();
+inline constexpr std::array<detail::Table, 2> kPawn = detail::makePawn();  // [colour][square]
+inline constexpr std::array<detail::Table, 8> kRays = detail::makeRays();  // [direction][square]
+inline constexpr std::array<detail::Table, 64> kBetween = detail::makeBetween();  // [square][square]
+
+inline uint64_t between(int s1, int s2) { return kBetween[s1][s2]; }
+
+// classical sliding attacks: walk the ray to the first blocker and cut it off there
+inline uint64_t rayAttacks(int dir, int sq, uint64_t occupied)
+{
+    uint64_t ray = kRays[dir][sq];
+    uint64_t blockers = ray & occupied;
+    if (blockers) {
+        int blocker = dir < 4 ? lsb(blockers) : msb(blockers);
+        ray ^= kRays[dir][blocker];
+    }
+    return ray;
+}
+
+inline uint64_t bishop(int sq, uint64_t occupied)
+{
+    return rayAttacks(NorthEast, sq, occupied) | rayAttacks(NorthWest, sq, occupied) |
+           rayAttacks(SouthWest, sq, occupied) | rayAttacks(SouthEast, sq, occupied);
+}
+
+inline uint64_t rook(int sq, uint64_t occupied)
+{
+    return rayAttacks(North, sq, occupied) | rayAttacks(East, sq, occupied) |
+           rayAttacks(South, sq, occupied) | rayAttacks(West, sq, occupied);
+}
+
+inline uint64_t queen(int sq, uint64_t occupied)
+{
+    return bishop(sq, occupied) | rook(sq, occupied);
+}
+
+} // namespace Attacks
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Search.h"
+#include <functional>
+
+//
+// fixed benchmark: a set of positions searched one after another to a fixed
+// depth on one thread, each from an empty transposition table and a fresh
+// search, so the total node count only changes when the search does
+//
+// the node count is the signature to compare before and after a change that
+// should not alter the search; nodes per second compares builds and machines
+//
+
+constexpr int kBenchDepth = 9;
+
+struct BenchResult
+{
+    int      positions = 0;
+    uint64_t nodes = 0;
+    int64_t  timeMs = 0;
+    uint64_t nps = 0;
+    AttackStats attacks;    // summed over the positions
+};
+
+int benchPositionCount();
+const char* benchFen(int index);
+
+// onPosition is called after each position with its index and result
+BenchResult runBench(int depth = kBenchDepth, size_t hashMb = 16,
+                     const std::function<void(int index, const SearchResult& result)>& onPosition = nullptr);
+
+// perft: leaves of the legal move tree to a fixed depth, the usual check of
+// the move generator; the last ply is counted from the target sets of
+// Position::legalTargets() rather than played out
+uint64_t perft(Position& pos, int depth);
+
+// the standard perft positions run three times: make/unmake with the side
+// to move fixed at compile time (as perft() does), make/unmake picking it
+// at run time on every call, and copy-make
+struct PerftBenchResult
+{
+    uint64_t nodes = 0;         // per run
+    int64_t  templatedMs = 0;
+    int64_t  runTimeMs = 0;
+    int64_t  copyMakeMs = 0;
+    bool     correct = true;    // every count matched the known one
+};
+
+PerftBenchResult runPerftBench();
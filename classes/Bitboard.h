@@ -3,6 +3,7 @@
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
+#include <cstdint>
 #include <iostream>
 
 enum ChessPiece
@@ -16,6 +17,50 @@ enum ChessPiece
     King
 };
 
+constexpr uint8_t kNoSquare = 64;
+
+// castling rights bits
+constexpr uint8_t kCastleWhiteKing  = 1;
+constexpr uint8_t kCastleWhiteQueen = 2;
+constexpr uint8_t kCastleBlackKing  = 4;
+constexpr uint8_t kCastleBlackQueen = 8;
+
+// free bit helpers for the engine code, same intrinsics as the classes below
+inline int lsb(uint64_t bb) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, bb);
+    return (int)index;
+#else
+    return __builtin_ctzll(bb);
+#endif
+}
+
+inline int msb(uint64_t bb) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, bb);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(bb);
+#endif
+}
+
+inline int popCount(uint64_t bb) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (int)__popcnt64(bb);
+#else
+    return __builtin_popcountll(bb);
+#endif
+}
+
+// returns the lowest set square and clears it
+inline int popLsb(uint64_t& bb) {
+    int index = lsb(bb);
+    bb &= bb - 1;
+    return index;
+}
+
 class BitboardElement {
   public:
     // Constructors
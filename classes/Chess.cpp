@@ -1,4 +1,6 @@
 #include "Chess.h"
+#include "Notation.h"
+#include "../imgui/imgui.h"
 #include <limits>
 #include <cmath>
 #include <cctype>
@@ -13,6 +15,7 @@ Chess::Chess()
 
 Chess::~Chess()
 {
+    stopAnalysis();
     delete _grid;
 }
 
@@ -20,12 +23,8 @@ char Chess::pieceNotation(int x, int y) const
 {
     const char *wpieces = { "0PNBRQK" };
     const char *bpieces = { "0pnbrqk" };
-    Bit *bit = _grid->getSquare(x, y)->bit();
-    char notation = '0';
-    if (bit) {
-        notation = bit->gameTag() < 128 ? wpieces[bit->gameTag()] : bpieces[bit->gameTag()-128];
-    }
-    return notation;
+    uint8_t tag = _position.pieceOn((y * 8 + x) ^ 56);
+    return tagColour(tag) == White ? wpieces[tagPiece(tag)] : bpieces[tagPiece(tag)];
 }
 
 Bit* Chess::PieceForPlayer(const int playerNumber, ChessPiece piece)
@@ -53,8 +52,23 @@ void Chess::setUpBoard()
     _gameOptions.rowY = 8;
 
     _grid->initializeChessSquares(pieceSize, "boardsquare.png");
+    _grid->forEachSquare([](ChessSquare* square, int x, int y) {
+        char name[3];
+        writeSquare((y * 8 + x) ^ 56, name);
+        square->setNotation(name);
+    });
     FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
 
+    // engines survive a reset, they just start a new game
+    for (EngineSlot& slot : _engines) {
+        if (!slot.client.isRunning()) continue;
+        slot.client.send("ucinewgame");
+        slot.client.send("isready");
+        slot.ready = false;
+    }
+    updatePlayerFlags();
+    restartAnalysis();
+
     startGame();
 }
 
@@ -75,6 +89,12 @@ void Chess::FENtoBoard(const std::string& fen) {
         boardField = fen.substr(0, spacePos);
     }
 
+    // the engine position needs the remaining fields, default them for a bare board
+    _startFen = spacePos == std::string::npos ? fen + " w KQkq - 0 1" : fen;
+    _position.setFen(_startFen);
+    _history.clear();
+    _keys.clear();
+
     // CHANGE: clear existing pieces so calling FENtoBoard multiple times works
     _grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
@@ -161,151 +181,19 @@ int Chess::holderToIndex(BitHolder& h) const
     return found;
 }
 
-bool Chess::isOccupied(int idx) const
-{
-    int x = idx % 8;
-    int y = idx / 8;
-    if (x < 0 || x >= 8 || y < 0 || y >= 8) return false;
-    return _grid->getSquare(x, y)->bit() != nullptr;
-}
-
-bool Chess::isOccupiedByWhite(int idx) const
-{
-    int x = idx % 8;
-    int y = idx / 8;
-    if (x < 0 || x >= 8 || y < 0 || y >= 8) return false;
-
-    Bit* b = _grid->getSquare(x, y)->bit();
-    return b && isWhiteBit(*b);
-}
-
-bool Chess::isOccupiedByBlack(int idx) const
-{
-    int x = idx % 8;
-    int y = idx / 8;
-    if (x < 0 || x >= 8 || y < 0 || y >= 8) return false;
-
-    Bit* b = _grid->getSquare(x, y)->bit();
-    return b && !isWhiteBit(*b);
-}
-
 void Chess::regenerateLegalMoves()
 {
     _legalMoves.clear();
-
-    _whiteToMove = (getCurrentPlayer()->playerNumber() == 0);
-
-    // Build moves for the side to move by scanning the board
-    _grid->forEachSquare([&](ChessSquare* sq, int x, int y) {
-        Bit* b = sq->bit();
-        if (!b) return;
-
-        bool pieceIsWhite = isWhiteBit(*b);
-        if (pieceIsWhite != _whiteToMove) return; // enforce turn
-
-        ChessPiece piece = bitToPiece(*b);
-        if (piece != Pawn && piece != Knight && piece != King) return;
-
-        int from = y * 8 + x;
-
-        //  PAWNS 
-        if (piece == Pawn)
-        {
-            // White pawns start at y=6 and move toward y-1
-            // Black pawns start at y=1 and move toward y+1
-            int dir = _whiteToMove ? -8 : +8;
-
-            int one = from + dir;
-            if (one >= 0 && one < 64)
-            {
-                // forward move must be empty
-                if (!isOccupied(one))
-                {
-                    _legalMoves.push_back(BitMove(from, one, Pawn));
-
-                    // two forward from starting rank, only if intermediate was empty too
-                    bool onStartRank = _whiteToMove ? (y == 6) : (y == 1);
-                    if (onStartRank)
-                    {
-                        int two = from + 2 * dir;
-                        if (two >= 0 && two < 64 && !isOccupied(two))
-                        {
-                            _legalMoves.push_back(BitMove(from, two, Pawn));
-                        }
-                    }
-                }
-            }
-
-            // pawn captures, diagonals only 
-            // white (dir=-8): captures to from-9 and from-7
-            // black (dir=+8): captures to from+7 and from+9
-            int capL = from + dir - 1;
-            int capR = from + dir + 1;
-
-            // prevent wrap around files
-            bool canCapL = (x > 0);
-            bool canCapR = (x < 7);
-
-            if (canCapL && capL >= 0 && capL < 64)
-            {
-                if (_whiteToMove && isOccupiedByBlack(capL)) _legalMoves.push_back(BitMove(from, capL, Pawn));
-                if (!_whiteToMove && isOccupiedByWhite(capL)) _legalMoves.push_back(BitMove(from, capL, Pawn));
-            }
-
-            if (canCapR && capR >= 0 && capR < 64)
-            {
-                if (_whiteToMove && isOccupiedByBlack(capR)) _legalMoves.push_back(BitMove(from, capR, Pawn));
-                if (!_whiteToMove && isOccupiedByWhite(capR)) _legalMoves.push_back(BitMove(from, capR, Pawn));
-            }
-        }
-
-        //  KNIGHTS 
-        if (piece == Knight)
-        {
-            // use (dx,dy) so we never do wrap-around bugs
-            const int dx[8] = { 1, 2,  2,  1, -1, -2, -2, -1 };
-            const int dy[8] = { 2, 1, -1, -2, -2, -1,  1,  2 };
-
-            for (int i = 0; i < 8; i++)
-            {
-                int nx = x + dx[i];
-                int ny = y + dy[i];
-                if (nx < 0 || nx > 7 || ny < 0 || ny > 7) continue;
-
-                int to = ny * 8 + nx;
-
-                // can't land on friendly
-                if (_whiteToMove && isOccupiedByWhite(to)) continue;
-                if (!_whiteToMove && isOccupiedByBlack(to)) continue;
-
-                _legalMoves.push_back(BitMove(from, to, Knight));
-            }
-        }
-
-        // KING 
-        if (piece == King)
-        {
-            for (int oy = -1; oy <= 1; oy++)
-            {
-                for (int ox = -1; ox <= 1; ox++)
-                {
-                    if (ox == 0 && oy == 0) continue;
-
-                    int nx = x + ox;
-                    int ny = y + oy;
-                    if (nx < 0 || nx > 7 || ny < 0 || ny > 7) continue;
-
-                    int to = ny * 8 + nx;
-
-                    // can't land on friendly
-                    if (_whiteToMove && isOccupiedByWhite(to)) continue;
-                    if (!_whiteToMove && isOccupiedByBlack(to)) continue;
-
-                    _legalMoves.push_back(BitMove(from, to, King));
-                }
-            }
-        }
-    });
+    _whiteToMove = _position.whiteToMove();
+
+    // grid index y * 8 + x with y = 0 at the top is the engine square flipped vertically
+    MoveList moves;
+    _position.generateLegalMoves(moves);
+    for (Move m : moves) {
+        // dropping a pawn on the last rank always makes a queen
+        if (m.isPromotion() && m.promotionPiece() != Queen) continue;
+        _legalMoves.push_back(BitMove(m.from() ^ 56, m.to() ^ 56, tagPiece(_position.pieceOn(m.from()))));
+    }
 }
 
 
@@ -320,21 +208,15 @@ bool Chess::canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
 {
     ChessPiece piece = bitToPiece(bit);
 
-    // only pawn/knight/king for this assignment
-    if (piece != Pawn && piece != Knight && piece != King) return false;
-
     int from = holderToIndex(src);
     int to   = holderToIndex(dst);
     if (from < 0 || to < 0) return false;
 
-    // ensure moves list is current
-    regenerateLegalMoves();
-
+    // the list is rebuilt after every move, so it is current here
     for (const BitMove& m : _legalMoves)
     {
         if (m.from == from && m.to == to && m.piece == piece)
         {
-            regenerateLegalMoves();
             return true;
         }
     }
@@ -342,34 +224,80 @@ bool Chess::canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
     return false;
 }
 
-void Chess::stopGame()
+void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
 {
-    _grid->forEachSquare([](ChessSquare* square, int x, int y) {
-        square->destroyBit();
-    });
+    int from = holderToIndex(src) ^ 56;
+    int to   = holderToIndex(dst) ^ 56;
+
+    MoveList moves;
+    _position.generateLegalMoves(moves);
+    for (Move m : moves) {
+        if (m.from() == from && m.to() == to && (!m.isPromotion() || m.promotionPiece() == Queen)) {
+            playMove(m);
+            return;
+        }
+    }
 }
 
-Player* Chess::ownerAt(int x, int y) const
+void Chess::playMove(Move move)
 {
-    if (x < 0 || x >= 8 || y < 0 || y >= 8) {
-        return nullptr;
+    // an engine pondering on this move carries on with a real search, anything else is wasted
+    for (EngineSlot& slot : _engines) {
+        if (!slot.pondering) continue;
+        slot.client.send(move == slot.ponderMove ? "ponderhit" : "stop");
+        slot.pondering = false;
     }
 
-    auto square = _grid->getSquare(x, y);
-    if (!square || !square->bit()) {
-        return nullptr;
+    UndoInfo undo;
+    _keys.push(_position.key());
+    _position.makeMove(move, undo);
+    _history.push_back(move);
+    // castling rooks, en passant and promotions are easiest to fix up from the position
+    syncGridToPosition();
+    regenerateLegalMoves();
+    restartAnalysis();
+    endTurn();
+}
+
+void Chess::syncGridToPosition()
+{
+    _grid->forEachSquare([&](ChessSquare* square, int x, int y) {
+        uint8_t tag = _position.pieceOn((y * 8 + x) ^ 56);
+        Bit* bit = square->bit();
+        if (bit && bit->gameTag() == tag) return;
+        square->destroyBit();
+        if (tag) {
+            square->setBit(PieceForPlayer(tagColour(tag), tagPiece(tag)));
+        }
+    });
+}
+
+void Chess::stopGame()
+{
+    for (EngineSlot& slot : _engines) {
+        if (slot.thinking) slot.client.send("stop");
+        slot.pondering = false;
     }
-    return square->bit()->getOwner();
+    if (_analysis) _analysis->stop();
+    _grid->forEachSquare([](ChessSquare* square, int x, int y) {
+        square->destroyBit();
+    });
 }
 
+// checkmate: the side to move is in check without a legal move
 Player* Chess::checkForWinner()
 {
-    return nullptr;
+    if (!_position.inCheck() || _position.hasLegalMove()) return nullptr;
+    return getPlayerAt(_position.sideToMove() ^ 1);
 }
 
+// stalemate, the fifty move rule, threefold repetition or material that can't mate
 bool Chess::checkForDraw()
 {
-    return false;
+    if (!_position.inCheck() && !_position.hasLegalMove()) return true;
+    if (_position.halfmoveClock() >= 100) return true;
+    if (_position.insufficientMaterial()) return true;
+    return _keys.repetitions(_position.key(), _position.halfmoveClock()) >= 2;
 }
 
 std::string Chess::initialStateString()
@@ -401,3 +329,426 @@ void Chess::setStateString(const std::string &s)
 
     regenerateLegalMoves();
 }
+
+//
+// external UCI engines
+// the render thread only ever sends commands and drains lines the client has
+// already buffered, so a slow engine never stalls a frame
+//
+
+bool Chess::gameHasAI()
+{
+    return _engines[0].client.isRunning() || _engines[1].client.isRunning();
+}
+
+void Chess::updatePlayerFlags()
+{
+    for (int side = 0; side < 2; side++) {
+        getPlayerAt(side)->setAIPlayer(_engines[side].client.isRunning());
+    }
+}
+
+void Chess::startEngine(int side)
+{
+    EngineSlot& slot = _engines[side];
+    slot.ready = false;
+    slot.thinking = false;
+    slot.name.clear();
+    slot.info = UciInfo();
+    slot.log.clear();
+    if (slot.client.start(slot.command)) {
+        slot.client.send("uci");
+    } else {
+        slot.log.push_back(std::string("could not start ") + slot.command);
+    }
+    updatePlayerFlags();
+}
+
+void Chess::stopEngine(int side)
+{
+    _engines[side].client.quit();
+    _engines[side].ready = false;
+    _engines[side].thinking = false;
+    _engines[side].pondering = false;
+    updatePlayerFlags();
+}
+
+std::string Chess::positionCommand() const
+{
+    std::string command = "position ";
+    if (_startFen == kStartFen) {
+        command += "startpos";
+    } else {
+        command += "fen ";
+        command += _startFen;
+    }
+    if (!_history.empty()) {
+        command += " moves";
+        for (Move m : _history) {
+            command += ' ';
+            command += m.toUci();
+        }
+    }
+    return command;
+}
+
+void Chess::updateAI()
+{
+    EngineSlot& slot = _engines[_position.sideToMove()];
+    if (!slot.client.isRunning() || !slot.ready || slot.thinking || _legalMoves.empty()) return;
+
+    slot.client.send(positionCommand());
+    slot.client.send("go movetime " + std::to_string(slot.movetimeMs));
+    slot.thinking = true;
+    slot.searchKey = _position.key();
+}
+
+void Chess::pollEngines()
+{
+    constexpr size_t kMaxLogLines = 200;
+
+    for (int side = 0; side < 2; side++) {
+        EngineSlot& slot = _engines[side];
+        std::vector<std::string> lines;
+        slot.client.poll(lines);
+
+        for (const std::string& line : lines) {
+            std::string best, ponder;
+            if (line.rfind("id name ", 0) == 0) {
+                slot.name = line.substr(8);
+            } else if (line == "uciok") {
+                if (slot.ponder) slot.client.send("setoption name Ponder value true");
+                slot.client.send("ucinewgame");
+                slot.client.send("isready");
+            } else if (line == "readyok") {
+                slot.ready = true;
+            } else if (UciClient::parseInfo(line, slot.info)) {
+                // keeps the latest pv line
+            } else if (UciClient::parseBestMove(line, best, ponder)) {
+                slot.thinking = false;
+                // ignore answers for a position that has since changed (e.g. the game was reset)
+                if (slot.searchKey == _position.key() && _position.sideToMove() == side) {
+                    Move move = _position.parseUciMove(best);
+                    if (move) {
+                        playMove(move);
+                        if (slot.ponder) startPonder(side, ponder);
+                    } else {
+                        slot.log.push_back("illegal move from engine: " + best);
+                    }
+                }
+            }
+
+            slot.log.push_back(line);
+            if (slot.log.size() > kMaxLogLines) slot.log.pop_front();
+        }
+
+        if (!slot.client.isRunning() && slot.ready) {
+            // the process went away on its own
+            slot.ready = false;
+            slot.thinking = false;
+            slot.pondering = false;
+            slot.log.push_back("engine exited");
+            updatePlayerFlags();
+        }
+    }
+}
+
+// searches the reply the engine expects while the opponent thinks,
+// the ponderhit or stop is sent from playMove() once the real move is known
+void Chess::startPonder(int side, const std::string& ponder)
+{
+    EngineSlot& slot = _engines[side];
+    Move expected = _position.parseUciMove(ponder);
+    if (!expected || slot.thinking) return;
+
+    Position next = _position;
+    UndoInfo undo;
+    next.makeMove(expected, undo);
+
+    slot.client.send(positionCommand() + " " + expected.toUci());
+    slot.client.send("go ponder movetime " + std::to_string(slot.movetimeMs));
+    slot.thinking = true;
+    slot.pondering = true;
+    slot.ponderMove = expected;
+    slot.searchKey = next.key();
+}
+
+void Chess::drawFrame()
+{
+    pollEngines();
+    Game::drawFrame();
+    drawEngineWindow();
+    drawAnalysisWindow();
+    drawExplorerWindow();
+}
+
+void Chess::drawEngineWindow()
+{
+    ImGui::Begin("Engines");
+    for (int side = 0; side < 2; side++) {
+        EngineSlot& slot = _engines[side];
+        ImGui::PushID(side);
+        ImGui::SeparatorText(side == 0 ? "White" : "Black");
+
+        if (!slot.client.isRunning()) {
+            ImGui::InputText("command", slot.command, sizeof(slot.command));
+            if (ImGui::Button("Start engine")) startEngine(side);
+        } else {
+            ImGui::Text("%s%s", slot.name.empty() ? slot.command : slot.name.c_str(),
+                        slot.thinking ? " (thinking)" : "");
+            if (ImGui::Button("Quit engine")) stopEngine(side);
+        }
+        ImGui::SliderInt("move time (ms)", &slot.movetimeMs, 50, 10000);
+        if (ImGui::Checkbox("ponder", &slot.ponder) && slot.client.isRunning()) {
+            slot.client.send(std::string("setoption name Ponder value ") + (slot.ponder ? "true" : "false"));
+        }
+
+        if (slot.info.depth > 0) {
+            ImGui::Text("depth %d  score %s %d  nodes %llu  nps %llu", slot.info.depth,
+                        slot.info.mate ? "mate" : "cp", slot.info.score,
+                        (unsigned long long)slot.info.nodes, (unsigned long long)slot.info.nps);
+            ImGui::TextWrapped("pv %s", slot.info.pv.c_str());
+        }
+
+        if (ImGui::TreeNode("output")) {
+            ImGui::BeginChild("log", ImVec2(0, 150), true);
+            for (const std::string& line : slot.log) {
+                ImGui::TextUnformatted(line.c_str());
+            }
+            if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY()) ImGui::SetScrollHereY(1.0f);
+            ImGui::EndChild();
+            ImGui::TreePop();
+        }
+        ImGui::PopID();
+    }
+    ImGui::End();
+}
+
+//
+// analysis with the built in engine
+// the search runs until the board changes; the transposition table is kept
+// between positions, so the next search starts from what the last one learned
+//
+
+void Chess::restartAnalysis()
+{
+    if (!_analysing) return;
+    if (!_analysis) {
+        _analysis = std::make_unique<Engine>();
+        _analysis->onInfo = [this](const SearchInfo& info) {
+            // if the panel has fallen behind the update is dropped, a newer one follows
+            _analysisQueue.push(AnalysisUpdate{ _analysisGeneration, info });
+        };
+    }
+
+    // nothing is searching after this, so the settings below are safe to change
+    stopAnalysis();
+    _analysisGeneration++;
+    _analysisLines.clear();
+    if (_analysis->threads() != _analysisThreads) _analysis->setThreads(_analysisThreads);
+    _analysis->setMultiPv(_analysisMultiPv);
+
+    Position root;
+    root.setFen(_startFen);
+    _analysis->setPosition(root, _history);
+    _analysisWhiteToMove = _position.whiteToMove();
+    if (_legalMoves.empty()) return;
+
+    GoParams params;
+    params.infinite = true;
+    _analysis->go(params);
+}
+
+void Chess::stopAnalysis()
+{
+    if (!_analysis) return;
+    _analysis->stop();
+    _analysis->wait();
+}
+
+void Chess::drawAnalysisWindow()
+{
+    AnalysisUpdate update;
+    while (_analysisQueue.pop(update)) {
+        if (update.generation != _analysisGeneration) continue;
+        size_t index = (size_t)update.info.multipv - 1;
+        if (_analysisLines.size() <= index) _analysisLines.resize(index + 1);
+        _analysisLines[index] = std::move(update.info);
+    }
+
+    ImGui::Begin("Analysis");
+    if (ImGui::Checkbox("analyse", &_analysing)) {
+        if (_analysing) restartAnalysis(); else stopAnalysis();
+    }
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    ImGui::SliderInt("lines", &_analysisMultiPv, 1, 8);
+    bool restart = ImGui::IsItemDeactivatedAfterEdit();
+    ImGui::SliderInt("threads", &_analysisThreads, 1, maxThreads);
+    restart |= ImGui::IsItemDeactivatedAfterEdit();
+    if (restart) restartAnalysis();
+
+    if (!_analysisLines.empty()) {
+        const SearchInfo& best = _analysisLines[0];
+        ImGui::Text("depth %d  nodes %llu  nps %llu  hash %d%%", best.depth, (unsigned long long)best.nodes,
+                    (unsigned long long)best.nps, best.hashfull / 10);
+    }
+    for (const SearchInfo& line : _analysisLines) {
+        if (line.pv.empty()) continue;
+        // scores are shown from white's side like a GUI would, the search reports them for the side to move
+        int score = _analysisWhiteToMove ? line.score : -line.score;
+        char scoreText[16];
+        if (std::abs(score) >= kMateBound) {
+            int mateIn = (kMateScore - std::abs(score) + 1) / 2;
+            snprintf(scoreText, sizeof(scoreText), "%s#%d", score > 0 ? "" : "-", mateIn);
+        } else {
+            snprintf(scoreText, sizeof(scoreText), "%+.2f", score / 100.0);
+        }
+        // the lines belong to the board as it is now, older generations were dropped above
+        std::string pv;
+        Position walk = _position;
+        char san[kMaxMoveText];
+        for (Move m : line.pv) {
+            if (parseLan(walk, m.toUci()) != m) break;
+            writeSan(walk, m, san);
+            pv += san;
+            pv += ' ';
+            UndoInfo undo;
+            walk.makeMove(m, undo);
+        }
+        ImGui::Text("%2d  %7s  %s", line.depth, scoreText, pv.c_str());
+    }
+
+    drawMoveList();
+    drawBookMoves();
+    ImGui::End();
+}
+
+// the game so far in SAN, "1. e4 e5 2. Nf3"
+void Chess::drawMoveList()
+{
+    ImGui::SeparatorText("Moves");
+    Position walk;
+    walk.setFen(_startFen);
+    std::string text;
+    char san[kMaxMoveText];
+    for (size_t i = 0; i < _history.size(); i++) {
+        if (walk.whiteToMove() || i == 0) {
+            text += std::to_string(walk.fullmoveNumber());
+            text += walk.whiteToMove() ? ". " : "... ";
+        }
+        writeSan(walk, _history[i], san);
+        text += san;
+        text += ' ';
+        UndoInfo undo;
+        walk.makeMove(_history[i], undo);
+    }
+    ImGui::TextWrapped("%s", text.c_str());
+}
+
+// book moves for the board with their share of the weight, click one to play it
+void Chess::drawBookMoves()
+{
+    ImGui::SeparatorText("Book");
+    ImGui::InputText("book file", _bookPath, sizeof(_bookPath));
+    ImGui::SameLine();
+    if (ImGui::Button("Load")) _book.open(_bookPath);
+    if (!_book.isOpen()) return;
+
+    std::vector<BookMove> moves = _book.probe(_position);
+    if (moves.empty()) {
+        ImGui::TextUnformatted("out of book");
+        return;
+    }
+    int total = 0;
+    for (const BookMove& b : moves) total += b.weight;
+    bool humanToMove = !getCurrentPlayer()->isAIPlayer();
+    for (const BookMove& b : moves) {
+        std::string label = toSan(_position, b.move);
+        if (humanToMove && ImGui::SmallButton(label.c_str())) {
+            playMove(b.move);
+            return;
+        }
+        if (!humanToMove) ImGui::TextUnformatted(label.c_str());
+        ImGui::SameLine();
+        ImGui::Text("%5.1f%%", 100.0 * b.weight / total);
+    }
+}
+
+// games from the archive that reached the board, with the moves played next
+void Chess::drawExplorerWindow()
+{
+    constexpr size_t kListedGames = 20;
+
+    ImGui::Begin("Explorer");
+    ImGui::InputText("archive", _archivePath, sizeof(_archivePath));
+    ImGui::InputText("index", _indexPath, sizeof(_indexPath));
+    if (ImGui::Button("Open")) {
+        _explorerArchive.open(_archivePath);
+        _explorerIndex.open(_indexPath);
+        _explorerKey = 0;
+    }
+    if (!_explorerIndex.isOpen()) {
+        ImGui::TextUnformatted("build an index with game_archive pack and position_index build");
+        ImGui::End();
+        return;
+    }
+
+    if (_explorerKey != _position.key()) {
+        _explorerKey = _position.key();
+        _explorerCount = _explorerIndex.count(_explorerKey);
+        _explorerMoves = _explorerIndex.explore(_position);
+        _explorerGames.clear();
+        for (const PositionEntry& e : _explorerIndex.find(_explorerKey, kListedGames)) {
+            PgnGame game;
+            if (!_explorerArchive.readGame(e.game, game)) continue;
+            const std::string* white = game.tag("White");
+            const std::string* black = game.tag("Black");
+            const char* result = game.result == kPgnWhiteWins ? "1-0" : game.result == kPgnBlackWins ? "0-1" :
+                                 game.result == kPgnDraw ? "1/2-1/2" : "*";
+            std::string line = "#";
+            line += std::to_string(e.game);
+            line += "  ";
+            line += white ? *white : "?";
+            line += " - ";
+            line += black ? *black : "?";
+            line += "  ";
+            line += result;
+            _explorerGames.push_back(std::move(line));
+        }
+    }
+
+    ImGui::Text("%llu games in the index reached this position", (unsigned long long)_explorerCount);
+    bool humanToMove = !getCurrentPlayer()->isAIPlayer();
+    if (ImGui::BeginTable("moves", 5)) {
+        ImGui::TableSetupColumn("move");
+        ImGui::TableSetupColumn("games");
+        ImGui::TableSetupColumn("white");
+        ImGui::TableSetupColumn("draw");
+        ImGui::TableSetupColumn("black");
+        ImGui::TableHeadersRow();
+        for (const ExplorerMove& m : _explorerMoves) {
+            double n = (double)m.games;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            std::string label = toSan(_position, m.move);
+            if (humanToMove && ImGui::SmallButton(label.c_str())) {
+                playMove(m.move);
+                break;
+            }
+            if (!humanToMove) ImGui::TextUnformatted(label.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)m.games);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f%%", 100 * m.whiteWins / n);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f%%", 100 * m.draws / n);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f%%", 100 * m.blackWins / n);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::SeparatorText("Games");
+    for (const std::string& line : _explorerGames) ImGui::TextUnformatted(line.c_str());
+    ImGui::End();
+}
@@ -3,6 +3,14 @@
 #include "Game.h"
 #include "Bitboard.h"
 #include "Grid.h"
+#include "KeyHistory.h"
+#include "Engine.h"
+#include "LockFreeQueue.h"
+#include "PositionIndex.h"
+#include "Position.h"
+#include "UciClient.h"
+#include <deque>
+#include <memory>
 #include <vector>
 
 
@@ -31,8 +39,14 @@ public:
     bool canBitMoveFrom(Bit &bit, BitHolder &src) override;
     bool canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
     bool actionForEmptyHolder(BitHolder &holder) override;
+    void bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
 
     void stopGame() override;
+    void drawFrame() override;
+
+    // either side can be played by an external UCI engine
+    bool gameHasAI() override;
+    void updateAI() override;
 
     Player *checkForWinner() override;
     bool checkForDraw() override;
@@ -44,20 +58,90 @@ public:
     Grid* getGrid() override { return _grid; }
 
 private:
+    // one external engine process per side
+    struct EngineSlot
+    {
+        UciClient client;
+        char command[256] = "./chess_uci";
+        std::string name;
+        int movetimeMs = 1000;
+        bool ready = false;         // answered isready
+        bool thinking = false;      // a go is outstanding
+        bool ponder = false;        // think on the opponent's time
+        bool pondering = false;     // the outstanding go is a go ponder on ponderMove
+        Move ponderMove;
+        uint64_t searchKey = 0;     // position the outstanding go was sent for
+        UciInfo info;
+        std::deque<std::string> log;
+    };
+
+    // infos travel from the analysis search thread to the render thread,
+    // generation drops the ones still in flight from the previous position
+    struct AnalysisUpdate
+    {
+        uint32_t generation = 0;
+        SearchInfo info;
+    };
+
     Bit* PieceForPlayer(const int playerNumber, ChessPiece piece);
-    Player* ownerAt(int x, int y) const;
     void FENtoBoard(const std::string& fen);
     char pieceNotation(int x, int y) const;
 
+    void playMove(Move move);
+    void syncGridToPosition();
+    void updatePlayerFlags();
+    void startEngine(int side);
+    void stopEngine(int side);
+    void pollEngines();
+    void startPonder(int side, const std::string& ponder);
+    void drawEngineWindow();
+    std::string positionCommand() const;
+
+    void restartAnalysis();
+    void stopAnalysis();
+    void drawAnalysisWindow();
+    void drawMoveList();
+    void drawBookMoves();
+    void drawExplorerWindow();
+
     bool _whiteToMove = true;
     std::vector<BitMove> _legalMoves;
 
+    // the rules live in the engine position, the grid just mirrors it
+    Position _position;
+    std::string _startFen;
+    std::vector<Move> _history;
+    KeyHistory _keys;       // positions before the current one, for repetitions
+    EngineSlot _engines[2];
+
+    // built in engine analysing the board on background threads
+    SpscQueue<AnalysisUpdate> _analysisQueue{256};
+    std::vector<SearchInfo> _analysisLines;
+    uint32_t _analysisGeneration = 0;
+    bool _analysing = false;
+    bool _analysisWhiteToMove = true;
+    int _analysisMultiPv = 3;
+    int _analysisThreads = 1;
+    // declared after the queue so it is destroyed (and its threads joined) first
+    std::unique_ptr<Engine> _analysis;
+
+    OpeningBook _book;
+    char _bookPath[256] = "book.bin";
+
+    // opening explorer over a game archive and its position index,
+    // looked up again only when the board changes
+    GameArchive _explorerArchive;
+    PositionIndex _explorerIndex;
+    char _archivePath[256] = "games.gar";
+    char _indexPath[256] = "games.idx";
+    uint64_t _explorerKey = 0;
+    uint64_t _explorerCount = 0;
+    std::vector<ExplorerMove> _explorerMoves;
+    std::vector<std::string> _explorerGames;
+
     void regenerateLegalMoves();
     int holderToIndex(BitHolder& h) const;
     bool isWhiteBit(const Bit& bit) const;
     ChessPiece bitToPiece(const Bit& bit) const;
-    bool isOccupied(int idx) const;
-    bool isOccupiedByWhite(int idx) const;
-    bool isOccupiedByBlack(int idx) const;
     Grid* _grid;
 };
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "Engine.h"
+#include <algorithm>
+
+Engine::Engine()
+    : _tt(16), _multiPv(1), _book(nullptr), _bookRandom(std::random_device{}()), _stopRequested(false), _ponderhit(false), _mainDone(false), _abort(false), _searching(false)
+{
+    setThreads(1);
+}
+
+Engine::~Engine()
+{
+    stop();
+    wait();
+}
+
+void Engine::setHashSize(size_t megabytes)
+{
+    wait();
+    _tt.resize(megabytes);
+}
+
+void Engine::setThreads(int count)
+{
+    wait();
+    _searches.clear();
+    for (int i = 0; i < std::max(1, count); i++) {
+        _searches.push_back(std::make_unique<Search>(_tt));
+        _searches.back()->setAbortFlag(&_abort);
+    }
+}
+
+void Engine::newGame()
+{
+    wait();
+    _tt.clear();
+    _position.setFen(kStartFen);
+    _history.clear();
+}
+
+void Engine::setPosition(const Position& root, const std::vector<Move>& moves)
+{
+    wait();
+    _position = root;
+    _history.clear();
+    for (Move m : moves) {
+        UndoInfo undo;
+        _history.push(_position.key());
+        _position.makeMove(m, undo);
+    }
+}
+
+void Engine::go(const GoParams& params)
+{
+    stop();
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopRequested = false;
+        _ponderhit = false;
+        _mainDone = false;
+    }
+    _abort = false;
+    _searching = true;
+    _controller = std::thread(&Engine::run, this, params);
+}
+
+void Engine::stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopRequested = true;
+    _wake.notify_all();
+}
+
+void Engine::ponderhit()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ponderhit = true;
+    _wake.notify_all();
+}
+
+void Engine::wait()
+{
+    if (_controller.joinable()) _controller.join();
+}
+
+uint64_t Engine::totalNodes() const
+{
+    uint64_t nodes = 0;
+    for (const auto& s : _searches) nodes += s->nodes();
+    return nodes;
+}
+
+int64_t Engine::allocateTime(const GoParams& params) const
+{
+    if (params.movetime > 0) return params.movetime;
+
+    bool white = _position.whiteToMove();
+    int64_t left = white ? params.wtime : params.btime;
+    int64_t inc = white ? params.winc : params.binc;
+    if (left < 0) return 0;
+
+    // spread the clock over the expected rest of the game, keep a safety margin
+    int movesLeft = params.movestogo > 0 ? params.movestogo : 30;
+    int64_t budget = left / movesLeft + inc * 3 / 4;
+    return std::clamp<int64_t>(budget, 1, std::max<int64_t>(1, left - 50));
+}
+
+void Engine::run(GoParams params)
+{
+    // analysis and pondering want a search, everything else takes a book move as is
+    if (_book && !params.infinite && !params.ponder) {
+        Move bookMove = _book->pick(_position, _bookRandom());
+        if (bookMove) {
+            _searching = false;
+            if (onBestMove) onBestMove(bookMove, Move::none());
+            return;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t budget = allocateTime(params);
+    _tt.newSearch();
+
+    SearchLimits mainLimits;
+    if (params.depth > 0) mainLimits.depth = params.depth;
+    mainLimits.nodes = params.nodes;
+    mainLimits.multiPv = _multiPv;
+    SearchLimits helperLimits;
+    helperLimits.depth = mainLimits.depth;
+
+    SearchResult mainResult;
+    _searches[0]->setIterationCallback([&](const SearchResult& r) {
+        if (!onInfo) return;
+        SearchInfo info;
+        info.depth = r.depth;
+        info.nodes = totalNodes();
+        info.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        info.nps = info.nodes * 1000 / (uint64_t)std::max<int64_t>(1, info.timeMs);
+        info.hashfull = _tt.hashfull();
+        // one report per line, like UCI's info multipv
+        for (size_t i = 0; i < r.lines.size(); i++) {
+            info.multipv = (int)i + 1;
+            info.score = r.lines[i].score;
+            info.pv = r.lines[i].pv;
+            onInfo(info);
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < _searches.size(); i++) {
+        _searches[i]->setGameHistory(_history);
+        workers.emplace_back([this, i, &mainLimits, &helperLimits, &mainResult]() {
+            Position pos = _position;
+            if (i == 0) {
+                mainResult = _searches[0]->think(pos, mainLimits);
+                std::lock_guard<std::mutex> lock(_mutex);
+                _mainDone = true;
+                _wake.notify_all();
+            } else {
+                _searches[i]->think(pos, helperLimits);
+            }
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        bool pondering = params.ponder;
+        bool hasDeadline = budget > 0 && !pondering;
+        auto deadline = start + std::chrono::milliseconds(budget);
+
+        while (!_stopRequested) {
+            if (_ponderhit) {
+                // the expected move was played, the clock starts now
+                _ponderhit = false;
+                pondering = false;
+                hasDeadline = budget > 0;
+                deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget);
+            }
+            // UCI forbids a bestmove while pondering or in infinite mode, even if the search is done
+            if (_mainDone && !pondering && !params.infinite) break;
+            if (hasDeadline) {
+                if (_wake.wait_until(lock, deadline) == std::cv_status::timeout) break;
+            } else {
+                _wake.wait(lock);
+            }
+        }
+    }
+
+    _abort = true;
+    for (auto& w : workers) w.join();
+    _searches[0]->setIterationCallback(nullptr);
+
+    Move ponder = mainResult.pv.size() > 1 ? mainResult.pv[1] : Move::none();
+    _searching = false;
+    if (onBestMove) onBestMove(mainResult.bestMove, ponder);
+}
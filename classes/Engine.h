@@ -0,0 +1,102 @@
+#pragma once
+
+#include "OpeningBook.h"
+#include "Position.h"
+#include "Search.h"
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+//
+// asynchronous engine front end shared by the UCI executable and the GUI
+//
+// go() returns immediately; a controller thread runs one Search per thread
+// over a shared transposition table (lazy SMP), stops them on time, on
+// stop() or when the main search finishes, and then reports the best move
+//
+
+struct GoParams
+{
+    int      depth = 0;         // 0 = no depth limit
+    uint64_t nodes = 0;         // 0 = no node limit
+    int64_t  movetime = 0;      // exact time for this move in ms
+    int64_t  wtime = -1;        // clock times, -1 when not given
+    int64_t  btime = -1;
+    int64_t  winc = 0;
+    int64_t  binc = 0;
+    int      movestogo = 0;
+    bool     infinite = false;  // search until stop()
+    bool     ponder = false;    // search until ponderhit() or stop()
+};
+
+struct SearchInfo
+{
+    int               multipv = 1;      // 1 = best line
+    int               depth = 0;
+    int               score = 0;
+    uint64_t          nodes = 0;
+    int64_t           timeMs = 0;
+    uint64_t          nps = 0;
+    int               hashfull = 0;
+    std::vector<Move> pv;
+};
+
+class Engine
+{
+public:
+    Engine();
+    ~Engine();
+
+    // only while no search is running
+    void setHashSize(size_t megabytes);
+    void setThreads(int count);
+    int threads() const { return (int)_searches.size(); }
+    void setMultiPv(int lines) { _multiPv = std::max(1, lines); }
+    int multiPv() const { return _multiPv; }
+    // a timed go plays straight from the book when the position is in it, nullptr turns it off
+    void setBook(const OpeningBook* book) { _book = book; }
+    void newGame();
+
+    void setPosition(const Position& root, const std::vector<Move>& moves);
+    const Position& position() const { return _position; }
+
+    void go(const GoParams& params);
+    void stop();
+    void ponderhit();
+    // blocks until the current search has reported its best move
+    void wait();
+    bool isSearching() const { return _searching.load(); }
+
+    // both are called from engine threads
+    std::function<void(const SearchInfo&)> onInfo;
+    std::function<void(Move best, Move ponder)> onBestMove;
+
+private:
+    void run(GoParams params);
+    int64_t allocateTime(const GoParams& params) const;
+    uint64_t totalNodes() const;
+
+    TranspositionTable _tt;
+    std::vector<std::unique_ptr<Search>> _searches;
+    Position _position;
+    KeyHistory _history;        // the positions before _position, for the repetition rules
+    int _multiPv;
+    const OpeningBook* _book;
+    std::mt19937_64 _bookRandom;
+
+    std::thread _controller;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopRequested;
+    bool _ponderhit;
+    bool _mainDone;
+    std::atomic<bool> _abort;
+    std::atomic<bool> _searching;
+};
@@ -0,0 +1,60 @@
+#include "Evaluate.h"
+#include "EvalParams.h"
+#include "Kpk.h"
+#include "Nnue.h"
+#include <algorithm>
+
+static const Nnue* s_network = nullptr;
+
+void setEvalNetwork(const Nnue* net)
+{
+    s_network = (net && net->isLoaded()) ? net : nullptr;
+}
+
+int gamePhase(const Position& pos)
+{
+    int phase = 0;
+    for (int piece = Knight; piece <= Queen; piece++) {
+        phase += kPhaseWeight[piece] * popCount(pos.pieces((ChessPiece)piece));
+    }
+    return std::min(phase, kMaxPhase);
+}
+
+int evaluate(const Position& pos)
+{
+    // king and pawn against king is looked up, not guessed; a won one still
+    // scores the pawn's advance so the search pushes it home
+    if (isKpk(pos)) {
+        if (!kpkWins(pos)) return 0;
+        int pawn = lsb(pos.pieces(Pawn));
+        int strong = tagColour(pos.pieceOn(pawn));
+        int rank = strong == White ? pawn >> 3 : 7 - (pawn >> 3);
+        int score = kKnownWin + kPieceValueEg[Pawn] + 10 * rank;
+        return pos.sideToMove() == strong ? score : -score;
+    }
+
+    if (s_network) return s_network->evaluate(pos.board(), pos.whiteToMove());
+
+    int mg = 0, eg = 0;
+
+    for (int colour = White; colour <= Black; colour++) {
+        int sign = colour == White ? 1 : -1;
+        int flip = colour == White ? 56 : 0;
+        for (int piece = Pawn; piece <= King; piece++) {
+            uint64_t bb = pos.pieces(colour, (ChessPiece)piece);
+            while (bb) {
+                int sq = popLsb(bb) ^ flip;
+                mg += sign * (kPieceValueMg[piece] + kPstMg[piece][sq]);
+                eg += sign * (kPieceValueEg[piece] + kPstEg[piece][sq]);
+            }
+        }
+        if (popCount(pos.pieces(colour, Bishop)) >= 2) {
+            mg += sign * kBishopPairMg;
+            eg += sign * kBishopPairEg;
+        }
+    }
+
+    int phase = gamePhase(pos);
+    int score = (mg * phase + eg * (kMaxPhase - phase)) / kMaxPhase;
+    return pos.whiteToMove() ? score : -score;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Position.h"
+
+class Nnue;
+
+//
+// hand-written evaluation: tapered material + piece-square tables
+// weights live in EvalParams.h so the tuner can regenerate them
+//
+
+// score of an ending known to be won, well clear of anything the tables
+// give and well below the mate scores
+constexpr int kKnownWin = 10000;
+
+// static evaluation in centipawns from the side to move's point of view
+int evaluate(const Position& pos);
+
+// when a loaded network is set, evaluate() uses it instead of the tables
+// only change this while no search is running
+void setEvalNetwork(const Nnue* net);
+
+// 0 (bare kings and pawns) .. kMaxPhase (all pieces on the board)
+int gamePhase(const Position& pos);
@@ -0,0 +1,315 @@
+#include "GameArchive.h"
+#include "Lz.h"
+#include <algorithm>
+#include <cstring>
+
+static constexpr char kMagic[8] = { 'C', 'H', 'G', 'A', 'R', 'C', '0', '1' };
+static constexpr size_t kHeaderSize = 32;
+static constexpr size_t kBlockInfoSize = 28;
+static constexpr size_t kBlockTarget = 64 * 1024;
+
+static uint64_t readLittleEndian(const uint8_t* p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void writeLittleEndian(uint8_t* p, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static void writeVarint(std::string& out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+static bool readVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static void writeText(std::string& out, const std::string& text)
+{
+    writeVarint(out, text.size());
+    out += text;
+}
+
+static bool readText(const uint8_t*& p, const uint8_t* end, std::string& text)
+{
+    uint64_t size;
+    if (!readVarint(p, end, size) || size > (uint64_t)(end - p)) return false;
+    text.assign((const char*)p, (size_t)size);
+    p += size;
+    return true;
+}
+
+//
+// game records
+//   tag count, then name and value of each tag (Result, FEN and SetUp are implied)
+//   result + 1 (one byte)
+//   start FEN, empty for the standard position
+//   ply count, then one byte per ply: the move's index among the legal moves
+//
+static bool isImpliedTag(const std::string& name)
+{
+    return name == "Result" || name == "FEN" || name == "SetUp";
+}
+
+bool GameArchiveWriter::encodeGame(const PgnGame& game, std::string& record)
+{
+    record.clear();
+    size_t tagCount = 0;
+    for (const auto& tag : game.tags) tagCount += !isImpliedTag(tag.first);
+    writeVarint(record, tagCount);
+    for (const auto& tag : game.tags) {
+        if (isImpliedTag(tag.first)) continue;
+        writeText(record, tag.first);
+        writeText(record, tag.second);
+    }
+    record += (char)(game.result + 1);
+
+    Position pos;
+    if (!pos.setFen(game.startFen)) return false;
+    writeText(record, game.startFen == kStartFen ? std::string() : game.startFen);
+
+    writeVarint(record, game.moves.size());
+    MoveList legal;
+    for (Move m : game.moves) {
+        pos.generateLegalMoves(legal);
+        const Move* found = std::find(legal.begin(), legal.end(), m);
+        if (found == legal.end()) return false;
+        record += (char)(found - legal.begin());
+        UndoInfo undo;
+        pos.makeMove(m, undo);
+    }
+    return true;
+}
+
+static bool decodeGame(const uint8_t*& p, const uint8_t* end, PgnGame& game)
+{
+    game.tags.clear();
+    game.moves.clear();
+
+    uint64_t tagCount;
+    if (!readVarint(p, end, tagCount)) return false;
+    game.tags.resize((size_t)std::min<uint64_t>(tagCount, (uint64_t)(end - p)));
+    for (auto& tag : game.tags) {
+        if (!readText(p, end, tag.first) || !readText(p, end, tag.second)) return false;
+    }
+
+    if (p >= end) return false;
+    game.result = (PgnResult)((int)*p++ - 1);
+    if (!readText(p, end, game.startFen)) return false;
+    if (game.startFen.empty()) game.startFen = kStartFen;
+
+    uint64_t plies;
+    if (!readVarint(p, end, plies) || plies > (uint64_t)(end - p)) return false;
+    Position pos;
+    if (!pos.setFen(game.startFen)) return false;
+    game.moves.reserve((size_t)plies);
+    MoveList legal;
+    for (uint64_t i = 0; i < plies; i++) {
+        pos.generateLegalMoves(legal);
+        uint8_t index = *p++;
+        if (index >= legal.size()) return false;
+        Move m = legal[index];
+        game.moves.push_back(m);
+        UndoInfo undo;
+        pos.makeMove(m, undo);
+    }
+    return true;
+}
+
+// skips a record without replaying it
+static bool skipGame(const uint8_t*& p, const uint8_t* end)
+{
+    uint64_t tagCount, size;
+    if (!readVarint(p, end, tagCount)) return false;
+    for (uint64_t i = 0; i < tagCount * 2; i++) {
+        if (!readVarint(p, end, size) || size > (uint64_t)(end - p)) return false;
+        p += size;
+    }
+    if (p >= end) return false;
+    p++;
+    if (!readVarint(p, end, size) || size > (uint64_t)(end - p)) return false;
+    p += size;
+    if (!readVarint(p, end, size) || size > (uint64_t)(end - p)) return false;
+    p += size;
+    return true;
+}
+
+bool GameArchiveWriter::open(const std::string& path)
+{
+    close();
+    _out.open(path, std::ios::binary | std::ios::trunc);
+    if (!_out) return false;
+    // the header is filled in by close()
+    char header[kHeaderSize] = {};
+    _out.write(header, kHeaderSize);
+    _raw.clear();
+    _rawGames = 0;
+    _games = 0;
+    _blocks.clear();
+    return (bool)_out;
+}
+
+void GameArchiveWriter::add(const std::string& record)
+{
+    _raw += record;
+    _rawGames++;
+    _games++;
+    if (_raw.size() >= kBlockTarget) flushBlock();
+}
+
+bool GameArchiveWriter::add(const PgnGame& game)
+{
+    std::string record;
+    if (!encodeGame(game, record)) return false;
+    add(record);
+    return true;
+}
+
+void GameArchiveWriter::flushBlock()
+{
+    if (!_rawGames) return;
+    std::vector<uint8_t> packed;
+    lzCompress((const uint8_t*)_raw.data(), _raw.size(), packed);
+
+    ArchiveBlock block;
+    block.offset = (uint64_t)_out.tellp();
+    block.firstGame = _games - _rawGames;
+    block.gameCount = _rawGames;
+    block.packedSize = (uint32_t)packed.size();
+    block.rawSize = (uint32_t)_raw.size();
+    _blocks.push_back(block);
+    _out.write((const char*)packed.data(), (std::streamsize)packed.size());
+
+    _raw.clear();
+    _rawGames = 0;
+}
+
+bool GameArchiveWriter::close()
+{
+    if (!_out.is_open()) return false;
+    flushBlock();
+
+    uint64_t tableOffset = (uint64_t)_out.tellp();
+    for (const ArchiveBlock& block : _blocks) {
+        uint8_t info[kBlockInfoSize];
+        writeLittleEndian(info, block.offset, 8);
+        writeLittleEndian(info + 8, block.firstGame, 8);
+        writeLittleEndian(info + 16, block.gameCount, 4);
+        writeLittleEndian(info + 20, block.packedSize, 4);
+        writeLittleEndian(info + 24, block.rawSize, 4);
+        _out.write((const char*)info, kBlockInfoSize);
+    }
+
+    uint8_t header[kHeaderSize];
+    std::memcpy(header, kMagic, 8);
+    writeLittleEndian(header + 8, _games, 8);
+    writeLittleEndian(header + 16, _blocks.size(), 8);
+    writeLittleEndian(header + 24, tableOffset, 8);
+    _out.seekp(0);
+    _out.write((const char*)header, kHeaderSize);
+
+    bool ok = (bool)_out;
+    _out.close();
+    return ok;
+}
+
+bool GameArchive::open(const std::string& path)
+{
+    close();
+    if (!_file.open(path)) return false;
+    const uint8_t* data = _file.data();
+    size_t size = _file.size();
+    if (size < kHeaderSize || std::memcmp(data, kMagic, 8) != 0) {
+        close();
+        return false;
+    }
+    _games = readLittleEndian(data + 8, 8);
+    uint64_t blockCount = readLittleEndian(data + 16, 8);
+    uint64_t tableOffset = readLittleEndian(data + 24, 8);
+    if (tableOffset > size || blockCount > (size - tableOffset) / kBlockInfoSize) {
+        close();
+        return false;
+    }
+
+    _blocks.resize((size_t)blockCount);
+    for (size_t i = 0; i < _blocks.size(); i++) {
+        const uint8_t* info = data + tableOffset + i * kBlockInfoSize;
+        ArchiveBlock& block = _blocks[i];
+        block.offset = readLittleEndian(info, 8);
+        block.firstGame = readLittleEndian(info + 8, 8);
+        block.gameCount = (uint32_t)readLittleEndian(info + 16, 4);
+        block.packedSize = (uint32_t)readLittleEndian(info + 20, 4);
+        block.rawSize = (uint32_t)readLittleEndian(info + 24, 4);
+        if (block.offset > tableOffset || block.packedSize > tableOffset - block.offset) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void GameArchive::close()
+{
+    _file.close();
+    _games = 0;
+    _blocks.clear();
+}
+
+bool GameArchive::unpackBlock(size_t index, std::vector<uint8_t>& raw) const
+{
+    if (index >= _blocks.size()) return false;
+    const ArchiveBlock& block = _blocks[index];
+    raw.resize(block.rawSize);
+    return lzDecompress(_file.data() + block.offset, block.packedSize, raw.data(), raw.size());
+}
+
+bool GameArchive::readBlock(size_t index, std::vector<PgnGame>& games) const
+{
+    std::vector<uint8_t> raw;
+    if (!unpackBlock(index, raw)) return false;
+    games.resize(_blocks[index].gameCount);
+    const uint8_t* p = raw.data();
+    const uint8_t* end = p + raw.size();
+    for (PgnGame& game : games) {
+        if (!decodeGame(p, end, game)) return false;
+    }
+    return true;
+}
+
+bool GameArchive::readGame(uint64_t id, PgnGame& game) const
+{
+    if (id >= _games) return false;
+    // the last block whose first game is not after id
+    auto it = std::upper_bound(_blocks.begin(), _blocks.end(), id,
+                               [](uint64_t value, const ArchiveBlock& b) { return value < b.firstGame; });
+    if (it == _blocks.begin()) return false;
+    size_t index = (size_t)(it - _blocks.begin()) - 1;
+
+    std::vector<uint8_t> raw;
+    if (!unpackBlock(index, raw)) return false;
+    const uint8_t* p = raw.data();
+    const uint8_t* end = p + raw.size();
+    for (uint64_t skip = id - _blocks[index].firstGame; skip > 0; skip--) {
+        if (!skipGame(p, end)) return false;
+    }
+    return decodeGame(p, end, game);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Pgn.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//
+// binary game archive
+//
+// every move is stored as its index in Position::generateLegalMoves(), one
+// byte per ply, so a game is its tags, result, start position and a short
+// string of small numbers. games are packed into blocks of about 64 KB that
+// are LZ compressed on their own (openings repeat a lot between games), and
+// a block table at the end of the file gives random access by game number
+//
+//   header   magic "CHGARC01", game count, block count, block table offset (8 bytes each)
+//   blocks   compressed game records
+//   table    per block: file offset (8), first game (8), game count (4),
+//            packed size (4), raw size (4)
+//
+// all integers are little-endian. replaying a game is one move generation
+// per ply, the same work as walking the moves of a search
+//
+
+struct ArchiveBlock
+{
+    uint64_t offset = 0;
+    uint64_t firstGame = 0;
+    uint32_t gameCount = 0;
+    uint32_t packedSize = 0;
+    uint32_t rawSize = 0;
+};
+
+class GameArchiveWriter
+{
+public:
+    ~GameArchiveWriter() { close(); }
+
+    bool open(const std::string& path);
+    // flushes the last block and writes the block table and header
+    bool close();
+
+    // a game's record, thread safe so workers can encode while another thread writes;
+    // false if a move is not legal in the position it is played in
+    static bool encodeGame(const PgnGame& game, std::string& record);
+
+    void add(const std::string& record);
+    bool add(const PgnGame& game);
+
+    uint64_t games() const { return _games; }
+
+private:
+    void flushBlock();
+
+    std::ofstream _out;
+    std::string _raw;
+    uint32_t _rawGames = 0;
+    uint64_t _games = 0;
+    std::vector<ArchiveBlock> _blocks;
+};
+
+class GameArchive
+{
+public:
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return _file.isOpen(); }
+
+    uint64_t games() const { return _games; }
+    size_t blocks() const { return _blocks.size(); }
+    const ArchiveBlock& block(size_t index) const { return _blocks[index]; }
+
+    // every game of a block in order; safe to call from several threads at once
+    bool readBlock(size_t index, std::vector<PgnGame>& games) const;
+    // one game by number, decompresses its block
+    bool readGame(uint64_t id, PgnGame& game) const;
+
+private:
+    bool unpackBlock(size_t index, std::vector<uint8_t>& raw) const;
+
+    MappedFile _file;
+    uint64_t _games = 0;
+    std::vector<ArchiveBlock> _blocks;
+};
@@ -0,0 +1,125 @@
+#include "KeyHistory.h"
+#include "Attacks.h"
+
+namespace {
+
+// every knight, bishop, rook, queen and king move between two squares of an
+// empty board, for either colour, keyed by the key change it makes: 3668 in all
+struct CuckooTables
+{
+    static constexpr int kSize = 8192;
+    uint64_t keys[kSize] = {};
+    Move moves[kSize] = {};
+
+    static int h1(uint64_t key) { return (int)(key & (kSize - 1)); }
+    static int h2(uint64_t key) { return (int)((key >> 16) & (kSize - 1)); }
+
+    CuckooTables()
+    {
+        for (int colour = White; colour <= Black; colour++) {
+            for (int piece = Knight; piece <= King; piece++) {
+                uint8_t tag = pieceTag(colour, (ChessPiece)piece);
+                for (int s1 = 0; s1 < 64; s1++) {
+                    for (int s2 = s1 + 1; s2 < 64; s2++) {
+                        if (!(attacks(piece, s1) & Attacks::squareBB(s2))) continue;
+                        insert(Zobrist::piece(tag, s1) ^ Zobrist::piece(tag, s2) ^ Zobrist::side(), Move(s1, s2, kQuietMove));
+                    }
+                }
+            }
+        }
+    }
+
+    static uint64_t attacks(int piece, int sq)
+    {
+        switch (piece) {
+            case Knight: return Attacks::kKnight[sq];
+            case Bishop: return Attacks::bishop(sq, 0);
+            case Rook:   return Attacks::rook(sq, 0);
+            case Queen:  return Attacks::queen(sq, 0);
+            default:     return Attacks::kKing[sq];
+        }
+    }
+
+    // each entry has two homes; a newcomer evicts whoever is in its first
+    // one, which moves on to its other home, until one lands in an empty slot
+    void insert(uint64_t key, Move move)
+    {
+        int i = h1(key);
+        for (;;) {
+            std::swap(keys[i], key);
+            std::swap(moves[i], move);
+            if (!move) return;
+            i = i == h1(key) ? h2(key) : h1(key);
+        }
+    }
+
+    // the move whose key change is this, none if there is no such move
+    Move find(uint64_t key) const
+    {
+        if (keys[h1(key)] == key) return moves[h1(key)];
+        if (keys[h2(key)] == key) return moves[h2(key)];
+        return Move::none();
+    }
+};
+
+const CuckooTables kCuckoo;
+
+} // namespace
+
+int KeyHistory::repetitions(uint64_t key, int halfmoveClock) const
+{
+    int count = 0;
+    int n = (int)_entries.size();
+    int end = reach(halfmoveClock);
+    for (int i = 4; i <= end; i += 2) {
+        if (_entries[n - i].key == key) count++;
+    }
+    return count;
+}
+
+bool KeyHistory::isRepetition(uint64_t key, int halfmoveClock, int ply) const
+{
+    int n = (int)_entries.size();
+    int end = reach(halfmoveClock);
+    bool before = false;
+    for (int i = 4; i <= end; i += 2) {
+        if (_entries[n - i].key != key) continue;
+        if (i < ply || before) return true;
+        before = true;
+    }
+    return false;
+}
+
+//
+// an odd number of plies back the other side was to move, so if the key
+// difference to that position is a single move of ours on the cuckoo list
+// and the squares it passes are empty, the move takes us back there. the
+// pieces need not be where the list says: the key difference only matches
+// when they are
+//
+bool KeyHistory::hasUpcomingRepetition(const Position& pos, int ply) const
+{
+    int n = (int)_entries.size();
+    int end = reach(pos.halfmoveClock());
+    if (end < 3) return false;
+
+    uint64_t key = pos.key();
+    for (int i = 3; i <= end; i += 2) {
+        Move move = kCuckoo.find(key ^ _entries[n - i].key);
+        if (!move) continue;
+        int s1 = move.from(), s2 = move.to();
+        if (Attacks::between(s1, s2) & pos.occupied()) continue;
+        if (i < ply) return true;
+
+        // the line reaches back past the root: the move has to be ours (the
+        // list holds a1-b1 and b1-a1 in one entry) and the position it goes
+        // back to has to have been on the board twice already
+        uint8_t piece = pos.pieceOn(pos.pieceOn(s1) ? s1 : s2);
+        if (tagColour(piece) != pos.sideToMove()) continue;
+        int earlier = n - i;
+        for (int j = i + 4; j <= end; j += 2) {
+            if (_entries[n - j].key == _entries[earlier].key) return true;
+        }
+    }
+    return false;
+}
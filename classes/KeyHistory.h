@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Position.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//
+// zobrist keys of the positions a game (and a search line) went through,
+// for the repetition rules
+//
+// push() the key of a position before a move is made from it, pop() after
+// the move is taken back; the current position itself is never on the
+// stack. only the last halfmoveClock entries can repeat, so every check
+// costs at most one step per two plies since the last capture or pawn move
+//
+// a null move in the search pushes with pushNull(): the positions before it
+// were not reached by real moves, so nothing behind it counts
+//
+// hasUpcomingRepetition() answers whether the side to move has a move that
+// goes back to an earlier position, without generating moves: the keys of
+// every reversible piece move on an empty board sit in a cuckoo table, so
+// the difference between the current key and an earlier one is looked up
+// directly (Marcel van Kervinck's method)
+//
+
+class KeyHistory
+{
+public:
+    void clear() { _entries.clear(); }
+    void reserve(size_t count) { _entries.reserve(count); }
+    size_t size() const { return _entries.size(); }
+
+    void push(uint64_t key) { _entries.push_back({ key, floor() }); }
+    void pushNull(uint64_t key) { _entries.push_back({ key, (uint32_t)_entries.size() + 1 }); }
+    void pop() { _entries.pop_back(); }
+
+    // earlier occurrences of the position since the last irreversible move
+    int repetitions(uint64_t key, int halfmoveClock) const;
+
+    // the search's draw by repetition: a second occurrence when the first was
+    // after the root (ply plies ago at most), otherwise the third
+    bool isRepetition(uint64_t key, int halfmoveClock, int ply) const;
+
+    // a move of the side to move reaches an earlier position of this line
+    // (within ply of it) or one that has already occurred twice
+    bool hasUpcomingRepetition(const Position& pos, int ply) const;
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t floor;     // lowest index positions after this one may repeat
+    };
+
+    uint32_t floor() const { return _entries.empty() ? 0 : _entries.back().floor; }
+    // how many entries back a position with this clock can look
+    int reach(int halfmoveClock) const
+    {
+        return std::min(halfmoveClock, (int)(_entries.size() - floor()));
+    }
+
+    std::vector<Entry> _entries;
+};
@@ -0,0 +1,23 @@
+#include "Kpk.h"
+
+// kKpkBitbase, written by kpk_gen into the build tree
+#include "KpkBitbase.inc"
+
+static_assert(sizeof(kKpkBitbase) * 8 == kKpkPositions, "KpkBitbase.inc is out of date");
+
+bool isKpk(const Position& pos)
+{
+    return popCount(pos.occupied()) == 3 && popCount(pos.pieces(Pawn)) == 1;
+}
+
+bool kpkWins(const Position& pos)
+{
+    // look at it from the pawn's side, with the pawn on files a-d
+    int pawn = lsb(pos.pieces(Pawn));
+    int strong = tagColour(pos.pieceOn(pawn));
+    int flip = (strong == White ? 0 : 56) ^ ((pawn & 7) > 3 ? 7 : 0);
+    int sideToMove = pos.sideToMove() == strong ? White : Black;
+
+    int index = kpkIndex(sideToMove, pos.kingSquare(strong ^ 1) ^ flip, pos.kingSquare(strong) ^ flip, pawn ^ flip);
+    return (kKpkBitbase[index / 32] >> (index & 31)) & 1;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Position.h"
+
+//
+// king and pawn against king, solved exactly
+//
+// the bitbase holds one bit per position with the pawn side as white and the
+// pawn on files a-d (the rest is the mirror image): set when white wins.
+// 2 sides to move * 24 pawn squares * 64 * 64 king squares = 196608 bits,
+// 24 KB. tools/kpk_gen.cpp solves it while building and the result is
+// compiled in, so the evaluator answers these endings with no file to load
+//
+
+constexpr int kKpkPositions = 2 * 24 * 64 * 64;
+
+// white king, black king, side to move, then the pawn's file (a-d) and rank
+// with the 7th rank first
+constexpr int kpkIndex(int sideToMove, int blackKing, int whiteKing, int pawn)
+{
+    return whiteKing | (blackKing << 6) | (sideToMove << 12) | ((pawn & 7) << 13) | ((6 - (pawn >> 3)) << 15);
+}
+
+// true when the position is king and one pawn against a bare king
+bool isKpk(const Position& pos);
+
+// whether the side with the pawn wins (with best play, ignoring the 50 move
+// rule); only valid when isKpk(pos)
+bool kpkWins(const Position& pos);
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//
+// bounded lock-free queues for handing data between threads
+//
+// capacity is rounded up to a power of two; push fails instead of waiting
+// when the queue is full, so a search thread is never held up by a slow reader
+// (a caller that must not lose the item retries). the value is only moved
+// from when push succeeds
+//
+// queue_bench in tools/ measures both against a mutex and a deque
+//
+
+constexpr size_t kCacheLineSize = 64;
+
+inline size_t queueCapacity(size_t requested)
+{
+    size_t size = 2;
+    while (size < requested) size <<= 1;
+    return size;
+}
+
+//
+// one producer thread, one consumer thread
+// push and pop are wait-free: a fixed number of steps whatever the other side does
+//
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity = 1024)
+        : _slots(queueCapacity(capacity)), _mask(queueCapacity(capacity) - 1)
+    {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer side
+    bool push(T&& value) { return emplace(std::move(value)); }
+    bool push(const T& value) { return emplace(value); }
+
+    // consumer side
+    bool pop(T& value)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _cachedTail) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head == _cachedTail) return false;
+        }
+        value = std::move(_slots[head & _mask]);
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    template <typename U>
+    bool emplace(U&& value)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cachedHead > _mask) {
+            // looks full, refresh our copy of the consumer's index and check again
+            _cachedHead = _head.load(std::memory_order_acquire);
+            if (tail - _cachedHead > _mask) return false;
+        }
+        _slots[tail & _mask] = std::forward<U>(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::vector<T> _slots;
+    size_t _mask;
+
+    // each side's index on its own cache line, next to its cached copy of the other side's
+    alignas(kCacheLineSize) std::atomic<size_t> _tail{0};
+    size_t _cachedHead = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> _head{0};
+    size_t _cachedTail = 0;
+};
+
+//
+// any number of producer threads, one consumer thread
+//
+// every slot carries a sequence number telling whose turn it is: a producer
+// claims a ticket with a compare-exchange on the tail, fills the slot and
+// publishes it by bumping the sequence; the consumer reads slots in ticket
+// order. pop is wait-free; push is lock-free, a producer only retries when
+// another producer's push succeeded in between
+//
+template <typename T>
+class MpscQueue
+{
+public:
+    explicit MpscQueue(size_t capacity = 1024)
+        : _slots(new Slot[queueCapacity(capacity)]), _mask(queueCapacity(capacity) - 1)
+    {
+        for (size_t i = 0; i <= _mask; i++) _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // producer side, safe from any thread
+    bool push(T&& value) { return emplace(std::move(value)); }
+    bool push(const T& value) { return emplace(value); }
+
+    // consumer side
+    bool pop(T& value)
+    {
+        Slot& slot = _slots[_head & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != _head + 1) return false;
+        value = std::move(slot.value);
+        // the slot is free again once the tail has gone round the ring
+        slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    template <typename U>
+    bool emplace(U&& value)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = _slots[tail & _mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == tail) {
+                // the slot is free for this ticket, try to take it
+                if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    slot.value = std::forward<U>(value);
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+                // tail was reloaded by the failed exchange
+            } else if (sequence < tail) {
+                // the consumer has not freed this slot from the previous lap: full
+                return false;
+            } else {
+                // another producer took this ticket
+                tail = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+
+    alignas(kCacheLineSize) std::atomic<size_t> _tail{0};
+    alignas(kCacheLineSize) size_t _head = 0;
+};
@@ -0,0 +1,93 @@
+#include "Lz.h"
+#include <algorithm>
+#include <cstring>
+
+static constexpr int kMinMatch = 4;
+static constexpr int kHashBits = 14;
+
+static void writeLength(std::vector<uint8_t>& out, size_t length)
+{
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back((uint8_t)length);
+}
+
+void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+{
+    out.clear();
+    std::vector<uint32_t> table(1u << kHashBits, UINT32_MAX);
+    auto hashAt = [&](size_t i) {
+        uint32_t v;
+        std::memcpy(&v, src + i, 4);
+        return (v * 2654435761u) >> (32 - kHashBits);
+    };
+
+    auto emit = [&](size_t literalStart, size_t literalCount, size_t matchLength, size_t offset) {
+        uint8_t token = (uint8_t)(std::min<size_t>(literalCount, 15) << 4);
+        if (matchLength) token |= (uint8_t)std::min<size_t>(matchLength - kMinMatch, 15);
+        out.push_back(token);
+        if (literalCount >= 15) writeLength(out, literalCount - 15);
+        out.insert(out.end(), src + literalStart, src + literalStart + literalCount);
+        if (!matchLength) return;
+        out.push_back((uint8_t)offset);
+        out.push_back((uint8_t)(offset >> 8));
+        if (matchLength - kMinMatch >= 15) writeLength(out, matchLength - kMinMatch - 15);
+    };
+
+    size_t anchor = 0, i = 0;
+    while (i + kMinMatch <= size) {
+        uint32_t h = hashAt(i);
+        uint32_t candidate = table[h];
+        table[h] = (uint32_t)i;
+        if (candidate != UINT32_MAX && i - candidate <= 65535 && std::memcmp(src + candidate, src + i, kMinMatch) == 0) {
+            size_t length = kMinMatch;
+            while (i + length < size && src[candidate + length] == src[i + length]) length++;
+            emit(anchor, i - anchor, length, i - candidate);
+            i += length;
+            anchor = i;
+        } else {
+            i++;
+        }
+    }
+    emit(anchor, size - anchor, 0, 0);
+}
+
+static bool readLength(const uint8_t*& p, const uint8_t* end, size_t& length)
+{
+    for (;;) {
+        if (p >= end) return false;
+        uint8_t b = *p++;
+        length += b;
+        if (b != 255) return true;
+    }
+}
+
+bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t rawSize)
+{
+    const uint8_t* p = src;
+    const uint8_t* end = src + size;
+    size_t out = 0;
+    while (p < end) {
+        uint8_t token = *p++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(p, end, literals)) return false;
+        if (literals > (size_t)(end - p) || literals > rawSize - out) return false;
+        std::memcpy(dst + out, p, literals);
+        p += literals;
+        out += literals;
+        if (p == end) break;
+
+        if (end - p < 2) return false;
+        size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+        size_t length = (token & 15);
+        if (length == 15 && !readLength(p, end, length)) return false;
+        length += kMinMatch;
+        if (offset == 0 || offset > out || length > rawSize - out) return false;
+        // byte by byte, the match may overlap what it is copying
+        for (size_t k = 0; k < length; k++, out++) dst[out] = dst[out - offset];
+    }
+    return out == rawSize;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// LZ77 in the LZ4 style: a token byte holds the literal run length and the
+// match length - 4 in a nibble each (15 means more length bytes follow), then
+// the literals, then a 16 bit offset back into the output. the last sequence
+// is literals only. compression is a single hash probe per position, which
+// is plenty for repeated openings and runs of equal table values
+//
+
+// replaces out with the compressed bytes
+void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+
+// false if the data is damaged or does not decode to exactly rawSize bytes
+bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t rawSize);
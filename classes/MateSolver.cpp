@@ -0,0 +1,265 @@
+#include "MateSolver.h"
+#include <algorithm>
+
+static constexpr uint32_t kInfinite = 1u << 30;
+static constexpr int kBucketSize = 4;
+
+static uint32_t addNumbers(uint32_t a, uint32_t b)
+{
+    return std::min<uint64_t>((uint64_t)a + b, kInfinite);
+}
+
+MateSolver::MateSolver(size_t megabytes)
+{
+    resize(megabytes);
+}
+
+void MateSolver::resize(size_t megabytes)
+{
+    size_t count = std::max<size_t>(megabytes * 1024 * 1024 / sizeof(Entry), kBucketSize);
+    size_t buckets = 1;
+    while (buckets * 2 * kBucketSize <= count) buckets *= 2;
+    _entries.assign(buckets * kBucketSize, Entry{});
+    _mask = buckets - 1;
+}
+
+void MateSolver::clear()
+{
+    std::fill(_entries.begin(), _entries.end(), Entry{});
+}
+
+// an entry only answers for the ply limit it was searched with, except that
+// a mate within the limit stays a mate and an escape stays one with less room
+bool MateSolver::lookup(uint64_t key, int remaining, uint32_t& pn, uint32_t& dn, int& distance) const
+{
+    const Entry* bucket = &_entries[(key & _mask) * kBucketSize];
+    for (int i = 0; i < kBucketSize; i++) {
+        const Entry& e = bucket[i];
+        if (e.key != key || (!e.pn && !e.dn)) continue;
+        bool usable = (e.pn == 0 && e.distance <= remaining) || (e.dn == 0 && e.remaining >= remaining) ||
+                      e.remaining == remaining;
+        if (!usable) return false;
+        pn = e.pn;
+        dn = e.dn;
+        distance = e.distance;
+        return true;
+    }
+    return false;
+}
+
+void MateSolver::store(uint64_t key, int remaining, uint32_t pn, uint32_t dn, int distance, uint64_t work)
+{
+    Entry* bucket = &_entries[(key & _mask) * kBucketSize];
+    Entry* replace = bucket;
+    for (int i = 0; i < kBucketSize; i++) {
+        if (bucket[i].key == key) {
+            replace = &bucket[i];
+            break;
+        }
+        if (bucket[i].work < replace->work) replace = &bucket[i];
+    }
+    replace->key = key;
+    replace->pn = pn;
+    replace->dn = dn;
+    replace->work = (uint32_t)std::min<uint64_t>(work, UINT32_MAX);
+    replace->remaining = (uint8_t)remaining;
+    replace->distance = (uint8_t)std::min(distance, 255);
+}
+
+bool MateSolver::shouldStop()
+{
+    if (_stop) return true;
+    if (_limits.nodes && _nodes >= _limits.nodes) _stop = true;
+    if (_limits.timeMs && (_nodes & 1023) == 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start);
+        if (elapsed.count() >= _limits.timeMs) _stop = true;
+    }
+    return _stop;
+}
+
+// first numbers for a position not in the table: the defender's move count
+// makes the attacker try checks and other forcing moves first
+void MateSolver::initChild(Position& pos, Child& child, int remaining)
+{
+    child.distance = 0;
+    if (lookup(child.key, remaining, child.pn, child.dn, child.distance)) return;
+
+    if (pos.sideToMove() == _attacker) {
+        // out of plies before the attacker could mate
+        child.pn = remaining <= 0 ? kInfinite : 1;
+        child.dn = remaining <= 0 ? 0 : 1;
+        return;
+    }
+    MoveList moves;
+    pos.generateLegalMoves(moves);
+    if (moves.empty()) {
+        bool mated = pos.inCheck();
+        child.pn = mated ? 0 : kInfinite;
+        child.dn = mated ? kInfinite : 0;
+        store(child.key, remaining, child.pn, child.dn, 0, 1);
+    } else if (remaining <= 0) {
+        child.pn = kInfinite;
+        child.dn = 0;
+    } else {
+        child.pn = (uint32_t)moves.size();
+        child.dn = 1;
+    }
+}
+
+void MateSolver::evaluateChild(Child& child, int remaining) const
+{
+    if (child.repetition) {
+        child.pn = kInfinite;
+        child.dn = 0;
+        return;
+    }
+    lookup(child.key, remaining, child.pn, child.dn, child.distance);
+}
+
+//
+// the numbers are kept from the mover's side: phi is the proof number at an
+// attacker node and the disproof number at a defender node, delta the other
+// one. a node's phi is the smallest delta of its children and its delta the
+// sum of their phis; the child with the smallest delta is searched until its
+// numbers pass the thresholds, then the next best is chosen
+//
+void MateSolver::expand(Position& pos, uint32_t thPhi, uint32_t thDelta, int remaining)
+{
+    _nodes++;
+    if (shouldStop()) return;
+    uint64_t startNodes = _nodes;
+    bool attacker = pos.sideToMove() == _attacker;
+
+    MoveList list;
+    pos.generateLegalMoves(list);
+    std::vector<Child> children(list.size());
+    _path.push_back(pos.key());
+    for (int i = 0; i < list.size(); i++) {
+        Child& child = children[i];
+        child.move = list[i];
+        UndoInfo undo;
+        pos.makeMove(child.move, undo);
+        child.key = pos.key();
+        child.repetition = std::find(_path.begin(), _path.end(), child.key) != _path.end();
+        if (child.repetition) evaluateChild(child, remaining - 1);
+        else initChild(pos, child, remaining - 1);
+        pos.unmakeMove(child.move, undo);
+    }
+
+    auto childPhi = [&](const Child& c) { return attacker ? c.dn : c.pn; };
+    auto childDelta = [&](const Child& c) { return attacker ? c.pn : c.dn; };
+    uint32_t phi, delta;
+    for (;;) {
+        phi = kInfinite;
+        delta = 0;
+        int best = -1;
+        uint32_t secondDelta = kInfinite;
+        for (int i = 0; i < (int)children.size(); i++) {
+            evaluateChild(children[i], remaining - 1);
+            uint32_t d = childDelta(children[i]);
+            delta = addNumbers(delta, childPhi(children[i]));
+            if (d < phi) {
+                secondDelta = phi;
+                phi = d;
+                best = i;
+            } else if (d < secondDelta) {
+                secondDelta = d;
+            }
+        }
+        if (phi >= thPhi || delta >= thDelta || best < 0) break;
+
+        Child& child = children[best];
+        uint32_t childThPhi = thDelta == kInfinite ? kInfinite : thDelta - delta + childPhi(child);
+        uint32_t childThDelta = std::min(thPhi, addNumbers(secondDelta, 1));
+        UndoInfo undo;
+        pos.makeMove(child.move, undo);
+        expand(pos, childThPhi, childThDelta, remaining - 1);
+        pos.unmakeMove(child.move, undo);
+        if (_stop) break;
+    }
+    _path.pop_back();
+
+    uint32_t pn = attacker ? phi : delta;
+    uint32_t dn = attacker ? delta : phi;
+    int distance = 0;
+    if (pn == 0) {
+        // the quickest mate the attacker has found, against the longest defence
+        distance = attacker ? 255 : 0;
+        for (const Child& c : children) {
+            if (c.pn != 0) continue;
+            distance = attacker ? std::min(distance, c.distance + 1) : std::max(distance, c.distance + 1);
+        }
+    }
+    store(pos.key(), remaining, pn, dn, distance, _nodes - startNodes + 1);
+}
+
+// 1 for a mate (distance set), 0 for none within maxPlies, -1 if stopped
+int MateSolver::solveOnce(Position& pos, int maxPlies, int& distance)
+{
+    _path.clear();
+    uint32_t pn, dn;
+    expand(pos, kInfinite, kInfinite, maxPlies);
+    if (_stop || !lookup(pos.key(), maxPlies, pn, dn, distance)) return -1;
+    if (pn == 0) return 1;
+    if (dn == 0) return 0;
+    return -1;
+}
+
+// the attacker's quickest mating move and the defender's longest answer
+void MateSolver::extractPv(Position& pos, int remaining, std::vector<Move>& pv)
+{
+    pv.clear();
+    Position walk = pos;
+    for (; remaining > 0; remaining--) {
+        bool attacker = walk.sideToMove() == _attacker;
+        MoveList moves;
+        walk.generateLegalMoves(moves);
+        Move best;
+        int bestDistance = attacker ? 256 : -1;
+        for (Move m : moves) {
+            UndoInfo undo;
+            walk.makeMove(m, undo);
+            uint32_t pn, dn;
+            int distance;
+            bool proven = lookup(walk.key(), remaining - 1, pn, dn, distance) && pn == 0;
+            walk.unmakeMove(m, undo);
+            if (!proven) continue;
+            if (attacker ? distance < bestDistance : distance > bestDistance) {
+                bestDistance = distance;
+                best = m;
+            }
+        }
+        if (!best) break;
+        pv.push_back(best);
+        UndoInfo undo;
+        walk.makeMove(best, undo);
+    }
+}
+
+MateResult MateSolver::solve(Position& pos, const MateLimits& limits)
+{
+    _limits = limits;
+    _start = std::chrono::steady_clock::now();
+    _stop = false;
+    _nodes = 0;
+    _attacker = pos.sideToMove();
+
+    MateResult result;
+    int distance = 0;
+    int outcome = solveOnce(pos, std::clamp(limits.maxPlies, 1, 255), distance);
+    result.noMate = outcome == 0;
+    while (outcome == 1) {
+        result.mate = true;
+        result.plies = distance;
+        extractPv(pos, distance, result.pv);
+        if (distance <= 1) {
+            result.shortest = true;
+            break;
+        }
+        // a mate always takes an odd number of plies, so look for one two shorter
+        outcome = solveOnce(pos, distance - 2, distance);
+        result.shortest = outcome == 0;
+    }
+    result.nodes = _nodes;
+    return result;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Position.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//
+// proves forced mates with depth-first proof-number search (df-pn)
+//
+// unlike the alpha-beta search this does not look for a good move, only for
+// a proof: every defence of every line ends in mate. the side to move at
+// the root is the attacker. each node carries a proof number (how many
+// leaves still have to be shown mated) and a disproof number (how many to
+// show the defender escapes), and the search always expands the most proving
+// node below thresholds passed down the tree, so it goes deep quickly along
+// forcing lines and only re-expands a subtree when its numbers say so
+//
+// the tree is bounded by a ply limit: a line where the attacker has not
+// mated within maxPlies counts as an escape. once a mate is found the limit
+// is tightened to just below it and the search repeated until it fails,
+// which makes the reported mate the shortest one
+//
+// the solver has its own table of fixed size, replacing the entries with
+// the least work behind them; a search that outgrows it still finishes, it
+// just redoes some work. positions repeated within a line count as escapes
+// without being stored, which is the usual graph history compromise
+//
+
+struct MateLimits
+{
+    int      maxPlies = 31;     // longest mate looked for, in plies (31 = mate in 16)
+    uint64_t nodes = 0;         // 0 = no node limit
+    int64_t  timeMs = 0;        // 0 = no time limit
+};
+
+struct MateResult
+{
+    bool              mate = false;     // a forced mate was proven
+    bool              noMate = false;   // proven that there is none within maxPlies
+    bool              shortest = false; // and none shorter than plies
+    int               plies = 0;        // mate in (plies + 1) / 2 moves
+    std::vector<Move> pv;               // mating line against the longest defence
+    uint64_t          nodes = 0;
+};
+
+class MateSolver
+{
+public:
+    explicit MateSolver(size_t megabytes = 16);
+
+    void resize(size_t megabytes);
+    void clear();
+
+    MateResult solve(Position& pos, const MateLimits& limits);
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t pn;
+        uint32_t dn;
+        uint32_t work;          // nodes spent below this entry, for replacement
+        uint8_t  remaining;     // plies left when pn and dn were worked out
+        uint8_t  distance;      // plies to mate once proven
+    };
+
+    struct Child
+    {
+        Move     move;
+        uint64_t key;
+        uint32_t pn;
+        uint32_t dn;
+        int      distance;
+        bool     repetition;
+    };
+
+    bool lookup(uint64_t key, int remaining, uint32_t& pn, uint32_t& dn, int& distance) const;
+    void store(uint64_t key, int remaining, uint32_t pn, uint32_t dn, int distance, uint64_t work);
+
+    bool shouldStop();
+    void expand(Position& pos, uint32_t thPhi, uint32_t thDelta, int remaining);
+    void initChild(Position& pos, Child& child, int remaining);
+    void evaluateChild(Child& child, int remaining) const;
+    int solveOnce(Position& pos, int maxPlies, int& distance);
+    void extractPv(Position& pos, int remaining, std::vector<Move>& pv);
+
+    std::vector<Entry> _entries;
+    uint64_t _mask = 0;
+    int _attacker = 0;
+    uint64_t _nodes = 0;
+    bool _stop = false;
+    MateLimits _limits;
+    std::chrono::steady_clock::time_point _start;
+    std::vector<uint64_t> _path;        // keys of the positions above the current node
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Bitboard.h"
+#include <string>
+
+//
+// 16 bit engine move: 6 bits from, 6 bits to, 4 bits of flags
+// (BitMove stays the GUI's move type, this one is what the search passes around)
+//
+
+enum MoveFlag : uint16_t
+{
+    kQuietMove     = 0,
+    kDoublePawnPush = 1,
+    kKingCastle    = 2,
+    kQueenCastle   = 3,
+    kCaptureFlag   = 4,
+    kEnPassant     = 5,
+    kPromotionFlag = 8,     // + 0..3 for knight, bishop, rook, queen
+};
+
+class Move
+{
+public:
+    constexpr Move() : _data(0) {}
+    constexpr explicit Move(uint16_t data) : _data(data) {}
+    constexpr Move(int from, int to, int flags) : _data((uint16_t)(from | (to << 6) | (flags << 12))) {}
+
+    static constexpr Move none() { return Move(); }
+
+    constexpr int from() const { return _data & 63; }
+    constexpr int to() const { return (_data >> 6) & 63; }
+    constexpr int flags() const { return _data >> 12; }
+    constexpr uint16_t raw() const { return _data; }
+
+    constexpr bool isCapture() const { return (flags() & kCaptureFlag) != 0; }
+    constexpr bool isPromotion() const { return (flags() & kPromotionFlag) != 0; }
+    constexpr bool isCastle() const { return flags() == kKingCastle || flags() == kQueenCastle; }
+    constexpr ChessPiece promotionPiece() const { return isPromotion() ? (ChessPiece)(Knight + (flags() & 3)) : NoPiece; }
+
+    constexpr bool operator==(const Move& other) const { return _data == other._data; }
+    constexpr bool operator!=(const Move& other) const { return _data != other._data; }
+    explicit constexpr operator bool() const { return _data != 0; }
+
+    // long algebraic as used by UCI, e.g. "e2e4" or "e7e8q"
+    std::string toUci() const
+    {
+        if (!_data) return "0000";
+        std::string s;
+        s += (char)('a' + (from() & 7));
+        s += (char)('1' + (from() >> 3));
+        s += (char)('a' + (to() & 7));
+        s += (char)('1' + (to() >> 3));
+        if (isPromotion()) s += "nbrq"[flags() & 3];
+        return s;
+    }
+
+private:
+    uint16_t _data;
+};
+
+// no reachable position has more than 218 moves, and setFen and setBoard
+// turn down placements that are not reachable (Position::checkSetup)
+constexpr int kMaxMoves = 256;
+
+struct MoveList
+{
+    Move moves[kMaxMoves];
+    int count = 0;
+
+    void push(Move m) { moves[count++] = m; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Move& operator[](int i) { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+};
+
+// where each piece of the side to move can go, one bitboard per piece
+// (see Position::legalTargets), for counting moves without listing them
+struct PieceTargets
+{
+    int      from;
+    uint64_t to;
+};
+
+struct TargetList
+{
+    PieceTargets pieces[16];    // one per piece, checkSetup allows no more
+    int count = 0;
+    int moves = 0;      // legal moves in all, a promotion counts once per piece it can become
+
+    void push(int from, uint64_t to) { pieces[count++] = { from, to }; }
+    int size() const { return count; }
+    const PieceTargets* begin() const { return pieces; }
+    const PieceTargets* end() const { return pieces + count; }
+};
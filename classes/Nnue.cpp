@@ -0,0 +1,105 @@
+#include "Nnue.h"
+#include <algorithm>
+#include <fstream>
+
+Nnue::Nnue()
+    : ftWeights(kNnueInputs * kNnueHidden, 0),
+      ftBias(kNnueHidden, 0),
+      l1Weights(kNnueL1 * 2 * kNnueHidden, 0),
+      l1Bias(kNnueL1, 0),
+      outWeights(kNnueL1, 0),
+      outBias(0),
+      _loaded(false)
+{
+}
+
+template <typename T>
+static bool readArray(std::ifstream& in, std::vector<T>& v)
+{
+    in.read((char*)v.data(), v.size() * sizeof(T));
+    return (bool)in;
+}
+
+template <typename T>
+static void writeArray(std::ofstream& out, const std::vector<T>& v)
+{
+    out.write((const char*)v.data(), v.size() * sizeof(T));
+}
+
+bool Nnue::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    uint32_t header[5] = {};
+    in.read((char*)header, sizeof(header));
+    if (!in || header[0] != kNnueMagic || header[1] != kNnueVersion ||
+        header[2] != kNnueInputs || header[3] != kNnueHidden || header[4] != kNnueL1) {
+        return false;
+    }
+
+    bool ok = readArray(in, ftWeights) && readArray(in, ftBias) &&
+              readArray(in, l1Weights) && readArray(in, l1Bias) &&
+              readArray(in, outWeights);
+    in.read((char*)&outBias, sizeof(outBias));
+    _loaded = ok && (bool)in;
+    return _loaded;
+}
+
+bool Nnue::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+
+    const uint32_t header[5] = { kNnueMagic, kNnueVersion, kNnueInputs, kNnueHidden, kNnueL1 };
+    out.write((const char*)header, sizeof(header));
+    writeArray(out, ftWeights);
+    writeArray(out, ftBias);
+    writeArray(out, l1Weights);
+    writeArray(out, l1Bias);
+    writeArray(out, outWeights);
+    out.write((const char*)&outBias, sizeof(outBias));
+    return (bool)out;
+}
+
+int Nnue::evaluate(const uint8_t board[64], bool whiteToMove) const
+{
+    // accumulate both perspectives from scratch
+    alignas(64) int16_t acc[2][kNnueHidden];
+    for (int p = 0; p < 2; p++) {
+        std::copy(ftBias.begin(), ftBias.end(), acc[p]);
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        if (!board[sq]) continue;
+        for (int p = 0; p < 2; p++) {
+            const int16_t* w = &ftWeights[Nnue::featureIndex(p, board[sq], sq) * kNnueHidden];
+            for (int i = 0; i < kNnueHidden; i++) {
+                acc[p][i] += w[i];
+            }
+        }
+    }
+
+    // clipped relu, side to move first
+    alignas(64) uint8_t input[2 * kNnueHidden];
+    int us = whiteToMove ? 0 : 1;
+    for (int i = 0; i < kNnueHidden; i++) {
+        input[i] = (uint8_t)std::clamp<int>(acc[us][i], 0, kNnueQA);
+        input[kNnueHidden + i] = (uint8_t)std::clamp<int>(acc[us ^ 1][i], 0, kNnueQA);
+    }
+
+    int32_t hidden[kNnueL1];
+    for (int o = 0; o < kNnueL1; o++) {
+        const int8_t* w = &l1Weights[o * 2 * kNnueHidden];
+        int32_t sum = 0;
+        for (int i = 0; i < 2 * kNnueHidden; i++) {
+            sum += input[i] * w[i];
+        }
+        hidden[o] = std::clamp<int32_t>((sum + l1Bias[o]) / kNnueQB, 0, kNnueQA);
+    }
+
+    int32_t out = outBias;
+    for (int o = 0; o < kNnueL1; o++) {
+        out += hidden[o] * outWeights[o];
+    }
+    return (int)((int64_t)out * kNnueOutputScale / (kNnueQA * kNnueQB));
+}
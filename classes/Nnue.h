@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// small efficiently-updatable neural network evaluator
+//
+// 768 inputs (colour x piece x square, seen from each side) feed a shared
+// feature transformer, the two perspective accumulators are concatenated
+// side-to-move first and run through one hidden dense layer to a single output
+//
+//   768 -> kNnueHidden (x2 perspectives) -> kNnueL1 -> 1
+//
+// weights are stored quantized, this is the format nnue_trainer exports
+//
+
+constexpr int kNnueInputs = 768;
+constexpr int kNnueHidden = 256;
+constexpr int kNnueL1     = 32;
+
+// quantization scales
+constexpr int kNnueQA = 127;            // activations: float 1.0 == 127
+constexpr int kNnueQB = 64;             // dense weights: float 1.0 == 64
+constexpr int kNnueOutputScale = 400;   // network output 1.0 == 400 centipawns
+
+constexpr uint32_t kNnueMagic   = 0x554e4e43;  // "CNNU"
+constexpr uint32_t kNnueVersion = 1;
+
+class Nnue
+{
+public:
+    Nnue();
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+    bool isLoaded() const { return _loaded; }
+
+    // board uses piece tags (ChessPiece, +128 for black) with a1 = 0
+    // returns centipawns from the side to move's point of view
+    int evaluate(const uint8_t board[64], bool whiteToMove) const;
+
+    // input index for a piece seen from one side, -1 for an empty square
+    static int featureIndex(int perspective, uint8_t tag, int square)
+    {
+        if (!tag) return -1;
+        int piece = (tag & 127) - 1;
+        int colour = (tag & 128) ? 1 : 0;
+        if (perspective == 1) {
+            colour ^= 1;
+            square ^= 56;
+        }
+        return (colour * 6 + piece) * 64 + square;
+    }
+
+    // quantized parameters, public so the trainer can fill them in before save()
+    std::vector<int16_t> ftWeights;     // [kNnueInputs][kNnueHidden]
+    std::vector<int16_t> ftBias;        // [kNnueHidden]
+    std::vector<int8_t>  l1Weights;     // [kNnueL1][2 * kNnueHidden]
+    std::vector<int32_t> l1Bias;        // [kNnueL1]
+    std::vector<int8_t>  outWeights;    // [kNnueL1]
+    int32_t              outBias;
+
+private:
+    bool _loaded;
+};
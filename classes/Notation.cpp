@@ -0,0 +1,319 @@
+#include "Notation.h"
+
+static const char kPieceLetters[] = " PNBRQK";
+
+static int pieceFromLetter(char c)
+{
+    switch (c) {
+        case 'N': return Knight;
+        case 'B': return Bishop;
+        case 'R': return Rook;
+        case 'Q': return Queen;
+        case 'K': return King;
+        default:  return NoPiece;
+    }
+}
+
+// promotions are also written in lower case in long algebraic, "e7e8q"
+static int promotionFromLetter(char c)
+{
+    int piece = pieceFromLetter((char)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c));
+    return piece == King ? NoPiece : piece;
+}
+
+static int parseSquare(std::string_view text, size_t at)
+{
+    if (at + 2 > text.size()) return -1;
+    char file = text[at], rank = text[at + 1];
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8') return -1;
+    return (rank - '1') * 8 + (file - 'a');
+}
+
+// the side to move's pieces of this type that attack (or for pawns, can move to) to
+static uint64_t sourcesTo(const Position& pos, int piece, int to)
+{
+    int us = pos.sideToMove(), them = us ^ 1;
+    uint64_t occ = pos.occupied();
+    uint64_t own = pos.pieces(us, (ChessPiece)piece);
+    switch (piece) {
+        case Knight: return Attacks::kKnight[to] & own;
+        case Bishop: return Attacks::bishop(to, occ) & own;
+        case Rook:   return Attacks::rook(to, occ) & own;
+        case Queen:  return Attacks::queen(to, occ) & own;
+        case King:   return Attacks::kKing[to] & own;
+        case Pawn:   break;
+        default:     return 0;
+    }
+
+    uint64_t target = Attacks::squareBB(to);
+    uint64_t sources = 0;
+    if ((pos.pieces(them) & target) || to == pos.epSquare()) {
+        // squares a pawn of ours would capture to on to from are the ones a pawn of theirs attacks from to
+        sources |= Attacks::kPawn[them][to] & own;
+    } else if (!(occ & target)) {
+        int up = us == White ? 8 : -8;
+        int behind = to - up;
+        if (behind >= 0 && behind < 64) {
+            if (own & Attacks::squareBB(behind)) {
+                sources |= Attacks::squareBB(behind);
+            } else if (!(occ & Attacks::squareBB(behind)) && (to >> 3) == (us == White ? 3 : 4)) {
+                sources |= own & Attacks::squareBB(behind - up);
+            }
+        }
+    }
+    return sources;
+}
+
+// the position's own castling move with this flag, so the rules live in one place
+static Move castleMove(const Position& pos, int flag)
+{
+    MoveList legal;
+    pos.generateLegalMoves(legal);
+    for (Move m : legal) {
+        if (m.flags() == flag) return m;
+    }
+    return Move::none();
+}
+
+// the move from -> to with its flags filled in, Move::none() unless it is legal
+// (from must already be known to reach to, see sourcesTo)
+static Move legalMove(const Position& pos, int from, int to, int promotion)
+{
+    int us = pos.sideToMove();
+    uint8_t moving = pos.pieceOn(from);
+    if (!moving || tagColour(moving) != us) return Move::none();
+    uint8_t target = pos.pieceOn(to);
+    if (target && tagColour(target) == us) return Move::none();
+
+    int flags = target ? kCaptureFlag : kQuietMove;
+    if (tagPiece(moving) == Pawn) {
+        bool lastRank = (to >> 3) == (us == White ? 7 : 0);
+        if (lastRank != (promotion != NoPiece)) return Move::none();
+        if (lastRank) flags |= kPromotionFlag + (promotion - Knight);
+        else if (to == pos.epSquare() && (from & 7) != (to & 7)) flags = kEnPassant;
+        else if (to - from == 16 || from - to == 16) flags = kDoublePawnPush;
+    } else if (promotion != NoPiece) {
+        return Move::none();
+    }
+
+    Move m(from, to, flags);
+    return pos.isLegal(m) ? m : Move::none();
+}
+
+// "+" or "#" if the move gives check or mate
+static int writeCheck(const Position& pos, Move m, char* text)
+{
+    Position after = pos;
+    UndoInfo undo;
+    after.makeMove(m, undo);
+    if (!after.inCheck()) return 0;
+    text[0] = after.hasLegalMove() ? '+' : '#';
+    return 1;
+}
+
+static int writeCastle(Move m, char* text)
+{
+    int n = 0;
+    text[n++] = 'O';
+    text[n++] = '-';
+    text[n++] = 'O';
+    if (m.flags() == kQueenCastle) {
+        text[n++] = '-';
+        text[n++] = 'O';
+    }
+    return n;
+}
+
+int writeSan(const Position& pos, Move m, char* text)
+{
+    int n = 0;
+    if (!m) {
+        text[0] = '\0';
+        return 0;
+    }
+    if (m.isCastle()) {
+        n = writeCastle(m, text);
+    } else {
+        int from = m.from(), to = m.to();
+        int piece = tagPiece(pos.pieceOn(from));
+        if (piece == Pawn) {
+            if (m.isCapture()) text[n++] = (char)('a' + (from & 7));
+        } else {
+            text[n++] = kPieceLetters[piece];
+            // other pieces of the same kind that could also go there legally
+            uint64_t others = sourcesTo(pos, piece, to) & ~Attacks::squareBB(from);
+            uint64_t ambiguous = 0;
+            while (others) {
+                int sq = popLsb(others);
+                if (legalMove(pos, sq, to, NoPiece)) ambiguous |= Attacks::squareBB(sq);
+            }
+            if (ambiguous) {
+                bool fileClash = (ambiguous & (Attacks::kFileA << (from & 7))) != 0;
+                bool rankClash = (ambiguous & (Attacks::kRank1 << (from & 56))) != 0;
+                if (!fileClash || rankClash) text[n++] = (char)('a' + (from & 7));
+                if (fileClash) text[n++] = (char)('1' + (from >> 3));
+            }
+        }
+        if (m.isCapture()) text[n++] = 'x';
+        writeSquare(to, text + n);
+        n += 2;
+        if (m.isPromotion()) {
+            text[n++] = '=';
+            text[n++] = kPieceLetters[m.promotionPiece()];
+        }
+    }
+    n += writeCheck(pos, m, text + n);
+    text[n] = '\0';
+    return n;
+}
+
+int writeLan(const Position& pos, Move m, char* text)
+{
+    int n = 0;
+    if (!m) {
+        text[0] = '\0';
+        return 0;
+    }
+    if (m.isCastle()) {
+        n = writeCastle(m, text);
+    } else {
+        int piece = tagPiece(pos.pieceOn(m.from()));
+        if (piece != Pawn) text[n++] = kPieceLetters[piece];
+        writeSquare(m.from(), text + n);
+        n += 2;
+        text[n++] = m.isCapture() ? 'x' : '-';
+        writeSquare(m.to(), text + n);
+        n += 2;
+        if (m.isPromotion()) {
+            text[n++] = '=';
+            text[n++] = kPieceLetters[m.promotionPiece()];
+        }
+    }
+    n += writeCheck(pos, m, text + n);
+    text[n] = '\0';
+    return n;
+}
+
+std::string toSan(const Position& pos, Move m)
+{
+    char text[kMaxMoveText];
+    int n = writeSan(pos, m, text);
+    return std::string(text, (size_t)n);
+}
+
+std::string toLan(const Position& pos, Move m)
+{
+    char text[kMaxMoveText];
+    int n = writeLan(pos, m, text);
+    return std::string(text, (size_t)n);
+}
+
+// drops check and mate marks, annotations and an en passant note
+static std::string_view trimSuffixes(std::string_view text)
+{
+    for (;;) {
+        if (text.size() >= 4 && text.substr(text.size() - 4) == "e.p.") {
+            text.remove_suffix(4);
+            continue;
+        }
+        if (text.empty()) return text;
+        char c = text.back();
+        if (c == '+' || c == '#' || c == '!' || c == '?' || c == ' ') text.remove_suffix(1);
+        else return text;
+    }
+}
+
+static int castleFlag(std::string_view text)
+{
+    if (text == "O-O" || text == "0-0") return kKingCastle;
+    if (text == "O-O-O" || text == "0-0-0") return kQueenCastle;
+    return -1;
+}
+
+Move parseSan(const Position& pos, std::string_view san)
+{
+    san = trimSuffixes(san);
+    if (san.empty()) return Move::none();
+
+    int castle = castleFlag(san);
+    if (castle >= 0) return castleMove(pos, castle);
+
+    int piece = pieceFromLetter(san[0]);
+    if (piece != NoPiece) san.remove_prefix(1);
+    else piece = Pawn;
+
+    int promotion = NoPiece;
+    if (san.size() >= 2 && san[san.size() - 2] == '=') {
+        promotion = promotionFromLetter(san.back());
+        if (promotion == NoPiece) return Move::none();
+        san.remove_suffix(2);
+    } else if (piece == Pawn && !san.empty() && pieceFromLetter(san.back()) != NoPiece) {
+        // "e8Q" without the equals sign
+        promotion = promotionFromLetter(san.back());
+        if (promotion == NoPiece) return Move::none();
+        san.remove_suffix(1);
+    }
+
+    if (san.size() < 2) return Move::none();
+    int to = parseSquare(san, san.size() - 2);
+    if (to < 0) return Move::none();
+
+    // whatever is left before the target square is disambiguation and the capture mark
+    uint64_t allowed = ~0ULL;
+    for (size_t i = 0; i + 2 < san.size(); i++) {
+        char c = san[i];
+        if (c >= 'a' && c <= 'h') allowed &= Attacks::kFileA << (c - 'a');
+        else if (c >= '1' && c <= '8') allowed &= Attacks::kRank1 << ((c - '1') * 8);
+        else if (c != 'x' && c != ':' && c != '-') return Move::none();
+    }
+    // a pawn without a file letter is a push and stays on its file
+    if (piece == Pawn && allowed == ~0ULL) allowed = Attacks::kFileA << (to & 7);
+
+    uint64_t candidates = sourcesTo(pos, piece, to) & allowed;
+    while (candidates) {
+        Move m = legalMove(pos, popLsb(candidates), to, promotion);
+        if (m) return m;
+    }
+    return Move::none();
+}
+
+Move parseLan(const Position& pos, std::string_view lan)
+{
+    lan = trimSuffixes(lan);
+    if (lan.empty()) return Move::none();
+
+    int castle = castleFlag(lan);
+    if (castle >= 0) return castleMove(pos, castle);
+
+    int piece = pieceFromLetter(lan[0]);
+    if (piece != NoPiece) lan.remove_prefix(1);
+
+    int from = parseSquare(lan, 0);
+    if (from < 0) return Move::none();
+    size_t at = 2;
+    if (at < lan.size() && (lan[at] == '-' || lan[at] == 'x' || lan[at] == ':')) at++;
+    int to = parseSquare(lan, at);
+    if (to < 0) return Move::none();
+    at += 2;
+
+    int promotion = NoPiece;
+    if (at < lan.size() && lan[at] == '=') at++;
+    if (at < lan.size()) {
+        promotion = promotionFromLetter(lan[at]);
+        if (promotion == NoPiece || at + 1 != lan.size()) return Move::none();
+    }
+
+    uint8_t moving = pos.pieceOn(from);
+    if (!moving || tagColour(moving) != pos.sideToMove()) return Move::none();
+    int moved = tagPiece(moving);
+    if (piece != NoPiece && piece != moved) return Move::none();
+
+    // UCI writes castling as the king's two square step
+    if (moved == King && (from & 7) == 4 && (to >> 3) == (from >> 3)) {
+        if ((to & 7) == 6) return castleMove(pos, kKingCastle);
+        if ((to & 7) == 2) return castleMove(pos, kQueenCastle);
+    }
+
+    if (!(sourcesTo(pos, moved, to) & Attacks::squareBB(from))) return Move::none();
+    return legalMove(pos, from, to, promotion);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Position.h"
+#include <string>
+#include <string_view>
+
+//
+// move text: standard algebraic (SAN) as PGN files use it and long algebraic
+// (LAN) as UCI and move lists use it
+//
+// the write functions fill a caller's buffer and the parse functions read
+// views, so neither allocates. instead of generating every legal move they
+// look up which pieces attack the target square and test only those
+//
+
+// longest move text plus the terminator, e.g. "Qh4xe1+" or "e7xd8=Q#"
+constexpr int kMaxMoveText = 12;
+
+// "a1" .. "h8" into text[0..2], null terminated
+inline void writeSquare(int sq, char* text)
+{
+    text[0] = (char)('a' + (sq & 7));
+    text[1] = (char)('1' + (sq >> 3));
+    text[2] = '\0';
+}
+
+// "e4", "Nbd7", "exd8=Q+", "O-O#"; text holds kMaxMoveText, returns the length
+int writeSan(const Position& pos, Move m, char* text);
+// "e2-e4", "Ng8xf6", "e7-e8=Q+", "O-O"; text holds kMaxMoveText, returns the length
+int writeLan(const Position& pos, Move m, char* text);
+
+std::string toSan(const Position& pos, Move m);
+std::string toLan(const Position& pos, Move m);
+
+// SAN for a move in pos; check marks, annotations ("!?") and "e.p." are ignored,
+// "0-0" and "e8Q" are accepted. Move::none() if it names no legal move
+Move parseSan(const Position& pos, std::string_view san);
+// long algebraic with or without the piece letter and separator: "Ng1-f3",
+// "g1f3", "e7e8q", "e7xd8=Q", castling as "e1g1" or "O-O". Move::none() if not legal
+Move parseLan(const Position& pos, std::string_view lan);
@@ -0,0 +1,126 @@
+#include "OpeningBook.h"
+#include <algorithm>
+
+uint64_t bookKey(const Position& pos)
+{
+    return pos.key();
+}
+
+static uint64_t readBigEndian(const uint8_t* p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static void writeBigEndian(uint8_t* p, uint64_t v, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+BookEntry OpeningBook::readEntry(const uint8_t* in)
+{
+    BookEntry e;
+    e.key = readBigEndian(in, 8);
+    e.move = (uint16_t)readBigEndian(in + 8, 2);
+    e.weight = (uint16_t)readBigEndian(in + 10, 2);
+    e.learn = (uint32_t)readBigEndian(in + 12, 4);
+    return e;
+}
+
+void OpeningBook::writeEntry(uint8_t* out, const BookEntry& entry)
+{
+    writeBigEndian(out, entry.key, 8);
+    writeBigEndian(out + 8, entry.move, 2);
+    writeBigEndian(out + 10, entry.weight, 2);
+    writeBigEndian(out + 12, entry.learn, 4);
+}
+
+// the start position under Polyglot's own hashing, present in nearly every
+// book made by other programs
+static constexpr uint64_t kPolyglotStartKey = 0x463B96181691FC9CULL;
+
+bool OpeningBook::open(const std::string& path)
+{
+    if (!_file.open(path)) return false;
+    if (_file.size() % kBookEntrySize != 0 || firstEntry(kPolyglotStartKey) < entries()) {
+        _file.close();
+        return false;
+    }
+    return true;
+}
+
+size_t OpeningBook::firstEntry(uint64_t key) const
+{
+    const uint8_t* base = _file.data();
+    size_t count = entries();
+
+    // lower bound on the key, entries with the same key are adjacent
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (readBigEndian(base + mid * kBookEntrySize, 8) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < count && readBigEndian(base + lo * kBookEntrySize, 8) == key ? lo : count;
+}
+
+uint16_t OpeningBook::encodeMove(Move move)
+{
+    int from = move.from();
+    int to = move.to();
+    if (move.isCastle()) {
+        // king takes rook: e1g1 becomes e1h1, e1c1 becomes e1a1
+        to = (from & 56) | (move.flags() == kKingCastle ? 7 : 0);
+    }
+    int promotion = move.isPromotion() ? move.promotionPiece() - Knight + 1 : 0;
+    return (uint16_t)((to & 7) | ((to >> 3) << 3) | ((from & 7) << 6) | ((from >> 3) << 9) | (promotion << 12));
+}
+
+Move OpeningBook::decodeMove(const Position& pos, uint16_t move)
+{
+    // match against the legal moves so flags (captures, en passant, castling) come out right
+    MoveList legal;
+    pos.generateLegalMoves(legal);
+    for (Move m : legal) {
+        if (encodeMove(m) == (move & 0x7fff)) return m;
+    }
+    return Move::none();
+}
+
+std::vector<BookMove> OpeningBook::probe(const Position& pos) const
+{
+    std::vector<BookMove> moves;
+    if (!isOpen()) return moves;
+
+    uint64_t key = bookKey(pos);
+    const uint8_t* base = _file.data();
+    size_t count = entries();
+    for (size_t i = firstEntry(key); i < count; i++) {
+        BookEntry e = readEntry(base + i * kBookEntrySize);
+        if (e.key != key) break;
+        Move m = decodeMove(pos, e.move);
+        // a zero weight is Polyglot's way of keeping a move in the book but never playing it
+        if (m && e.weight > 0) moves.push_back({ m, e.weight });
+    }
+    std::stable_sort(moves.begin(), moves.end(), [](const BookMove& a, const BookMove& b) { return a.weight > b.weight; });
+    return moves;
+}
+
+Move OpeningBook::pick(const Position& pos, uint64_t random) const
+{
+    std::vector<BookMove> moves = probe(pos);
+    uint64_t total = 0;
+    for (const BookMove& b : moves) total += (uint64_t)b.weight;
+    if (total == 0) return Move::none();
+
+    uint64_t r = random % total;
+    for (const BookMove& b : moves) {
+        if (r < (uint64_t)b.weight) return b.move;
+        r -= (uint64_t)b.weight;
+    }
+    return moves.back().move;
+}
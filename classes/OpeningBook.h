@@ -0,0 +1,69 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Position.h"
+#include <string>
+#include <vector>
+
+//
+// opening book in the file layout of Polyglot .bin books, read straight out
+// of a memory map
+//
+// the file is a sorted array of 16 byte big-endian entries
+//   key (8), move (2), weight (2), learn (4)
+// and a probe is a binary search for the first entry with the position's key
+//
+// the keys are the engine's own zobrist keys (Position::key()), not Polyglot's
+// random table, so this reads the books book_builder writes and no others.
+// a third-party Polyglot book is recognised by its start position key and
+// refused by open() rather than loaded to never match; bookKey() is the one
+// place that decides the key
+//
+
+struct BookEntry
+{
+    uint64_t key;
+    uint16_t move;      // Polyglot encoding, see encodeMove()
+    uint16_t weight;
+    uint32_t learn;
+};
+
+struct BookMove
+{
+    Move move;
+    int  weight;
+};
+
+constexpr size_t kBookEntrySize = 16;
+
+uint64_t bookKey(const Position& pos);
+
+class OpeningBook
+{
+public:
+    bool open(const std::string& path);
+    void close() { _file.close(); }
+    bool isOpen() const { return _file.isOpen(); }
+    size_t entries() const { return _file.size() / kBookEntrySize; }
+
+    // legal book moves for the position, heaviest first
+    std::vector<BookMove> probe(const Position& pos) const;
+    // weighted random choice among the book moves, Move::none() when out of book
+    Move pick(const Position& pos, uint64_t random) const;
+
+    // Polyglot move encoding: to file, to rank, from file, from rank in 3 bits
+    // each, then the promotion piece (1 knight .. 4 queen); castling is written
+    // as the king taking its own rook
+    static uint16_t encodeMove(Move move);
+    static Move decodeMove(const Position& pos, uint16_t move);
+
+    // entries must be sorted by key already
+    static void writeEntry(uint8_t* out, const BookEntry& entry);
+    static BookEntry readEntry(const uint8_t* in);
+
+private:
+    // index of the first entry with this key, entries() if there is none
+    size_t firstEntry(uint64_t key) const;
+
+    MappedFile _file;
+};
@@ -0,0 +1,86 @@
+#include "PackedPosition.h"
+#include "Bitboard.h"
+#include <cstring>
+#include <fstream>
+
+//
+// nibble codes: 0-5 white pawn..king, 6-11 black pawn..king
+//
+static uint8_t tagToNibble(uint8_t tag)
+{
+    int piece = tag & 127;
+    return (uint8_t)((piece - 1) + ((tag & 128) ? 6 : 0));
+}
+
+static uint8_t nibbleToTag(uint8_t nibble)
+{
+    return nibble < 6 ? (uint8_t)(nibble + 1) : (uint8_t)(128 + nibble - 6 + 1);
+}
+
+PackedPosition PackedPosition::pack(const TrainingSample& sample)
+{
+    PackedPosition p;
+    std::memset(&p, 0, sizeof(p));
+
+    int count = 0;
+    for (int sq = 0; sq < 64 && count < 32; sq++) {
+        uint8_t tag = sample.board[sq];
+        if (!tag) continue;
+        p.occupancy |= 1ULL << sq;
+        p.pieces[count >> 1] |= tagToNibble(tag) << ((count & 1) * 4);
+        count++;
+    }
+
+    p.score = sample.score;
+    p.move = sample.move;
+    p.flags = (sample.whiteToMove ? 0 : 1) | ((sample.castling & 15) << 1);
+    p.epSquare = sample.epSquare;
+    p.halfmoveClock = sample.halfmoveClock;
+    p.result = sample.result;
+    return p;
+}
+
+TrainingSample PackedPosition::unpack() const
+{
+    TrainingSample s;
+    std::memset(s.board, 0, sizeof(s.board));
+
+    int count = 0;
+    BitBoard occupied(occupancy);
+    for (int sq : occupied) {
+        uint8_t nibble = (pieces[count >> 1] >> ((count & 1) * 4)) & 15;
+        s.board[sq] = nibbleToTag(nibble);
+        count++;
+    }
+
+    s.whiteToMove = (flags & 1) == 0;
+    s.castling = (flags >> 1) & 15;
+    s.epSquare = epSquare;
+    s.halfmoveClock = halfmoveClock;
+    s.score = score;
+    s.result = result;
+    s.move = move;
+    return s;
+}
+
+bool readPackedPositions(const std::string& path, std::vector<PackedPosition>& out)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+
+    std::streamsize bytes = in.tellg();
+    in.seekg(0);
+    size_t count = (size_t)bytes / sizeof(PackedPosition);
+    size_t first = out.size();
+    out.resize(first + count);
+    in.read((char*)(out.data() + first), count * sizeof(PackedPosition));
+    return (bool)in;
+}
+
+bool appendPackedPositions(const std::string& path, const std::vector<PackedPosition>& positions)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    if (!out) return false;
+    out.write((const char*)positions.data(), positions.size() * sizeof(PackedPosition));
+    return (bool)out;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Bitboard.h"
+#include <string>
+#include <vector>
+
+//
+// compact on-disk training record
+// one position + search score + game result in exactly 32 bytes, so a
+// million positions is 32 MB instead of a multi-GB text FEN dump
+//
+// squares are little-endian rank-file (a1 = 0, h8 = 63) and pieces use the
+// same tag scheme as the GUI: ChessPiece for white, 128 + ChessPiece for black
+//
+
+//
+// unpacked form, easy to fill in from a board and easy to walk for features
+//
+struct TrainingSample
+{
+    uint8_t  board[64];     // 0 = empty, otherwise a piece tag
+    bool     whiteToMove;
+    uint8_t  castling;      // kCastle* bits
+    uint8_t  epSquare;      // kNoSquare if none
+    uint8_t  halfmoveClock;
+    int16_t  score;         // search score in centipawns, side to move's view
+    int8_t   result;        // 1 win, 0 draw, -1 loss for the side to move
+    uint16_t move;          // best move found by the search, 0 if unknown
+};
+
+struct PackedPosition
+{
+    uint64_t occupancy;     // one bit per occupied square
+    uint8_t  pieces[16];    // 4-bit piece code per occupied square, in square order
+    int16_t  score;
+    uint16_t move;
+    uint8_t  flags;         // bit 0: black to move, bits 1-4: castling
+    uint8_t  epSquare;
+    uint8_t  halfmoveClock;
+    int8_t   result;
+
+    static PackedPosition pack(const TrainingSample& sample);
+    TrainingSample unpack() const;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes on disk");
+
+// whole-file helpers, records are written back to back with no header
+bool readPackedPositions(const std::string& path, std::vector<PackedPosition>& out);
+bool appendPackedPositions(const std::string& path, const std::vector<PackedPosition>& positions);
@@ -0,0 +1,324 @@
+#include "Pgn.h"
+#include "MappedFile.h"
+#include "Notation.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+const std::string* PgnGame::tag(std::string_view name) const
+{
+    for (const auto& t : tags) {
+        if (t.first == name) return &t.second;
+    }
+    return nullptr;
+}
+
+static bool isResultToken(std::string_view token, PgnResult& result)
+{
+    if (token == "1-0") result = kPgnWhiteWins;
+    else if (token == "0-1") result = kPgnBlackWins;
+    else if (token == "1/2-1/2") result = kPgnDraw;
+    else if (token == "*") result = kPgnUnknown;
+    else return false;
+    return true;
+}
+
+bool parsePgnGame(std::string_view text, PgnGame& game)
+{
+    game.tags.clear();
+    game.moves.clear();
+    game.startFen = kStartFen;
+    game.result = kPgnUnknown;
+
+    size_t i = 0;
+    // tag pairs: [Name "Value"]
+    while (i < text.size()) {
+        while (i < text.size() && std::isspace((unsigned char)text[i])) i++;
+        if (i >= text.size() || text[i] != '[') break;
+        size_t end = text.find(']', i);
+        size_t quote = text.find('"', i);
+        if (end == std::string_view::npos) break;
+        if (quote != std::string_view::npos && quote < end) {
+            size_t close = text.find('"', quote + 1);
+            // the closing bracket may sit inside the quoted value
+            while (close != std::string_view::npos && close > 0 && text[close - 1] == '\\') close = text.find('"', close + 1);
+            if (close == std::string_view::npos) break;
+            end = text.find(']', close);
+            if (end == std::string_view::npos) break;
+            std::string_view name = text.substr(i + 1, quote - i - 1);
+            while (!name.empty() && std::isspace((unsigned char)name.back())) name.remove_suffix(1);
+            game.tags.emplace_back(std::string(name), std::string(text.substr(quote + 1, close - quote - 1)));
+        }
+        i = end + 1;
+    }
+
+    if (const std::string* fen = game.tag("FEN")) game.startFen = *fen;
+    if (const std::string* result = game.tag("Result")) isResultToken(*result, game.result);
+
+    Position pos;
+    if (!pos.setFen(game.startFen)) return false;
+
+    // movetext
+    int variationDepth = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (std::isspace((unsigned char)c)) {
+            i++;
+        } else if (c == '{') {
+            size_t end = text.find('}', i);
+            i = end == std::string_view::npos ? text.size() : end + 1;
+        } else if (c == ';') {
+            size_t end = text.find('\n', i);
+            i = end == std::string_view::npos ? text.size() : end + 1;
+        } else if (c == '(') {
+            variationDepth++;
+            i++;
+        } else if (c == ')') {
+            variationDepth--;
+            i++;
+        } else {
+            size_t start = i;
+            while (i < text.size() && !std::isspace((unsigned char)text[i]) && text[i] != '{' &&
+                   text[i] != '(' && text[i] != ')' && text[i] != ';') {
+                i++;
+            }
+            if (variationDepth > 0) continue;
+            std::string_view token = text.substr(start, i - start);
+
+            PgnResult result;
+            if (isResultToken(token, result)) {
+                game.result = result;
+                break;
+            }
+            if (token[0] == '$') continue;
+            // move numbers: "12." or "12..." possibly glued to the move
+            size_t digits = 0;
+            while (digits < token.size() && std::isdigit((unsigned char)token[digits])) digits++;
+            if (digits > 0 && digits < token.size() && token[digits] == '.') {
+                while (digits < token.size() && token[digits] == '.') digits++;
+                token.remove_prefix(digits);
+                if (token.empty()) continue;
+            }
+
+            Move m = parseSan(pos, token);
+            if (!m) return false;
+            UndoInfo undo;
+            pos.makeMove(m, undo);
+            game.moves.push_back(m);
+        }
+    }
+    return true;
+}
+
+static const char* resultText(PgnResult result)
+{
+    switch (result) {
+        case kPgnWhiteWins: return "1-0";
+        case kPgnBlackWins: return "0-1";
+        case kPgnDraw:      return "1/2-1/2";
+        default:            return "*";
+    }
+}
+
+void writePgnGame(const PgnGame& game, std::string& out)
+{
+    auto writeTag = [&](const std::string& name, const std::string& value) {
+        out += '[';
+        out += name;
+        out += " \"";
+        out += value;
+        out += "\"]\n";
+    };
+    for (const auto& tag : game.tags) {
+        if (tag.first != "Result" && tag.first != "FEN" && tag.first != "SetUp") writeTag(tag.first, tag.second);
+    }
+    writeTag("Result", resultText(game.result));
+    if (game.startFen != kStartFen) {
+        writeTag("SetUp", "1");
+        writeTag("FEN", game.startFen);
+    }
+    out += '\n';
+
+    // movetext wrapped before 80 columns
+    Position pos;
+    pos.setFen(game.startFen);
+    size_t lineStart = out.size();
+    char san[kMaxMoveText];
+    auto writeToken = [&](const char* token) {
+        size_t length = std::strlen(token);
+        if (out.size() > lineStart && out.size() - lineStart + 1 + length > 79) {
+            out += '\n';
+            lineStart = out.size();
+        } else if (out.size() > lineStart) {
+            out += ' ';
+        }
+        out.append(token, length);
+    };
+    for (size_t i = 0; i < game.moves.size(); i++) {
+        if (pos.whiteToMove() || i == 0) {
+            char number[16];
+            std::snprintf(number, sizeof(number), pos.whiteToMove() ? "%d." : "%d...", pos.fullmoveNumber());
+            writeToken(number);
+        }
+        writeSan(pos, game.moves[i], san);
+        writeToken(san);
+        UndoInfo undo;
+        pos.makeMove(game.moves[i], undo);
+    }
+    writeToken(resultText(game.result));
+    out += "\n\n";
+}
+
+// a line is a tag line if its first non-blank character is '['
+static bool isTagLine(std::string_view text, size_t lineStart, size_t lineEnd)
+{
+    while (lineStart < lineEnd && (text[lineStart] == ' ' || text[lineStart] == '\t')) lineStart++;
+    return lineStart < lineEnd && text[lineStart] == '[';
+}
+
+static bool isBlankLine(std::string_view text, size_t lineStart, size_t lineEnd)
+{
+    for (size_t i = lineStart; i < lineEnd; i++) {
+        if (!std::isspace((unsigned char)text[i])) return false;
+    }
+    return true;
+}
+
+size_t findPgnGameStart(std::string_view text, size_t from)
+{
+    if (from == 0) return 0;
+    // start scanning at the beginning of the line holding from
+    size_t lineStart = text.rfind('\n', from - 1);
+    lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+
+    bool afterMovetext = false;
+    // whether the line before the scan window was movetext
+    if (lineStart > 0) {
+        size_t prevEnd = lineStart - 1;
+        while (prevEnd > 0) {
+            size_t prevStart = text.rfind('\n', prevEnd - 1);
+            prevStart = prevStart == std::string_view::npos ? 0 : prevStart + 1;
+            if (!isBlankLine(text, prevStart, prevEnd)) {
+                afterMovetext = !isTagLine(text, prevStart, prevEnd);
+                break;
+            }
+            if (prevStart == 0) break;
+            prevEnd = prevStart - 1;
+        }
+    }
+
+    while (lineStart < text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        if (!isBlankLine(text, lineStart, lineEnd)) {
+            bool tag = isTagLine(text, lineStart, lineEnd);
+            if (tag && afterMovetext && lineStart >= from) return lineStart;
+            afterMovetext = !tag;
+        }
+        lineStart = lineEnd + 1;
+    }
+    return text.size();
+}
+
+PgnParser::PgnParser(int threads, size_t chunkBytes)
+    : _threads(threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency())),
+      _chunkBytes(std::max<size_t>(chunkBytes, 4096))
+{
+}
+
+bool PgnParser::parseFile(const std::string& path, const Callback& callback, bool ordered)
+{
+    _stats = Stats();
+    MappedFile file;
+    if (!file.open(path)) return false;
+    std::string_view text((const char*)file.data(), file.size());
+    _stats.bytes = file.size();
+
+    // chunks are handed out in file order; ordered mode parks finished chunks
+    // until the calling thread has delivered everything before them
+    const size_t maxInFlight = (size_t)_threads * 2;
+    std::mutex mutex;
+    std::condition_variable chunkDone;
+    std::condition_variable chunkDelivered;
+    size_t cursor = 0;
+    size_t nextChunk = 0;
+    size_t delivered = 0;
+    size_t chunkCount = 0;
+    bool allCut = false;
+    std::map<size_t, std::vector<PgnGame>> finished;
+    std::atomic<uint64_t> games(0), badGames(0);
+
+    auto work = [&](int worker) {
+        std::vector<PgnGame> parsed;
+        PgnGame game;
+        for (;;) {
+            size_t index, start, end;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (ordered) chunkDelivered.wait(lock, [&] { return allCut || nextChunk - delivered < maxInFlight; });
+                if (cursor >= text.size()) {
+                    allCut = true;
+                    chunkCount = nextChunk;
+                    chunkDone.notify_all();
+                    return;
+                }
+                index = nextChunk++;
+                start = cursor;
+                end = findPgnGameStart(text, std::min(text.size(), cursor + _chunkBytes));
+                cursor = end;
+            }
+
+            size_t pos = start;
+            while (pos < end) {
+                size_t next = findPgnGameStart(text.substr(0, end), pos + 1);
+                std::string_view gameText = text.substr(pos, next - pos);
+                pos = next;
+                if (isBlankLine(gameText, 0, gameText.size())) continue;
+
+                bool ok = parsePgnGame(gameText, game);
+                games++;
+                if (!ok) badGames++;
+                if (ordered) parsed.push_back(std::move(game));
+                else callback(game, worker);
+            }
+
+            if (ordered) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished[index] = std::move(parsed);
+                parsed.clear();
+                chunkDone.notify_all();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < _threads; t++) workers.emplace_back(work, t);
+
+    if (ordered) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            chunkDone.wait(lock, [&] { return finished.count(delivered) || (allCut && delivered >= chunkCount); });
+            auto it = finished.find(delivered);
+            if (it == finished.end()) break;
+            std::vector<PgnGame> chunk = std::move(it->second);
+            finished.erase(it);
+            // deliver without holding the lock so the workers keep going
+            lock.unlock();
+            for (const PgnGame& g : chunk) callback(g, 0);
+            lock.lock();
+            delivered++;
+            chunkDelivered.notify_all();
+        }
+    }
+    for (auto& w : workers) w.join();
+
+    _stats.games = games.load();
+    _stats.badGames = badGames.load();
+    return true;
+}
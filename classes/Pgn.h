@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Position.h"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//
+// PGN import and export
+//
+// PgnParser streams a file through a worker pool and hands out parsed games;
+// parsePgnGame() turns the text of one game into tags and engine moves and
+// writePgnGame() turns them back into text
+//
+
+enum PgnResult : int8_t
+{
+    kPgnBlackWins = -1,
+    kPgnDraw      = 0,
+    kPgnWhiteWins = 1,
+    kPgnUnknown   = 2,
+};
+
+struct PgnGame
+{
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::string startFen;       // from the FEN tag, the standard start otherwise
+    std::vector<Move> moves;
+    PgnResult result = kPgnUnknown;
+
+    const std::string* tag(std::string_view name) const;
+};
+
+// false if the game has an illegal or unreadable move; moves up to that point are kept
+bool parsePgnGame(std::string_view text, PgnGame& game);
+// appends the game with its moves in SAN, the Result, FEN and SetUp tags come from the game itself
+void writePgnGame(const PgnGame& game, std::string& out);
+
+//
+// parses whole PGN files on a pool of threads
+//
+// the file is memory mapped and cut into chunks of about chunkBytes that end
+// on game boundaries; each worker takes the next chunk and parses its games.
+// at most a few chunks per thread are in flight, so memory use does not grow
+// with the file
+//
+class PgnParser
+{
+public:
+    // worker is 0 .. threads - 1 in unordered mode, always 0 in ordered mode
+    using Callback = std::function<void(const PgnGame& game, int worker)>;
+
+    struct Stats
+    {
+        uint64_t games = 0;
+        uint64_t badGames = 0;      // stopped at an unreadable or illegal move
+        uint64_t bytes = 0;
+    };
+
+    explicit PgnParser(int threads = 0, size_t chunkBytes = 1 << 20);
+
+    // ordered: the callback runs on the calling thread, games in file order
+    // unordered: the callback runs on the worker threads, concurrently and in any order
+    bool parseFile(const std::string& path, const Callback& callback, bool ordered = true);
+
+    int threads() const { return _threads; }
+    const Stats& stats() const { return _stats; }
+
+private:
+    int _threads;
+    size_t _chunkBytes;
+    Stats _stats;
+};
+
+// offset of the first game that starts at or after from (a tag line following movetext), size if none
+size_t findPgnGameStart(std::string_view text, size_t from);
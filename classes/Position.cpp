@@ -0,0 +1,836 @@
+#include "Position.h"
+#include "AttackInfo.h"
+#include "Notation.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+//
+// zobrist keys, generated at compile time from a fixed seed so hashes are
+// stable across runs and machines (training data dedups on them)
+//
+namespace {
+
+struct ZobristTables
+{
+    uint64_t pieces[12][64];
+    uint64_t castling[16];
+    uint64_t epFile[8];
+    uint64_t side;
+};
+
+constexpr uint64_t splitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristTables makeZobrist()
+{
+    ZobristTables t{};
+    uint64_t state = 0x1234567ULL;
+    for (auto& piece : t.pieces) {
+        for (auto& key : piece) key = splitMix64(state);
+    }
+    uint64_t rights[4] = { splitMix64(state), splitMix64(state), splitMix64(state), splitMix64(state) };
+    for (int r = 0; r < 16; r++) {
+        uint64_t key = 0;
+        for (int bit = 0; bit < 4; bit++) {
+            if (r & (1 << bit)) key ^= rights[bit];
+        }
+        t.castling[r] = key;
+    }
+    for (auto& key : t.epFile) key = splitMix64(state);
+    t.side = splitMix64(state);
+    return t;
+}
+
+constexpr ZobristTables kZobrist = makeZobrist();
+
+// rights that survive a move touching this square
+constexpr uint8_t castleMask(int sq)
+{
+    switch (sq) {
+        case 0:  return (uint8_t)~kCastleWhiteQueen;
+        case 7:  return (uint8_t)~kCastleWhiteKing;
+        case 4:  return (uint8_t)~(kCastleWhiteKing | kCastleWhiteQueen);
+        case 56: return (uint8_t)~kCastleBlackQueen;
+        case 63: return (uint8_t)~kCastleBlackKing;
+        case 60: return (uint8_t)~(kCastleBlackKing | kCastleBlackQueen);
+        default: return 0xFF;
+    }
+}
+
+constexpr std::array<uint8_t, 64> makeCastleMasks()
+{
+    std::array<uint8_t, 64> t{};
+    for (int sq = 0; sq < 64; sq++) t[sq] = castleMask(sq);
+    return t;
+}
+
+constexpr std::array<uint8_t, 64> kCastleMasks = makeCastleMasks();
+
+inline int zobristIndex(uint8_t tag)
+{
+    return tagColour(tag) * 6 + tagPiece(tag) - 1;
+}
+
+} // namespace
+
+uint64_t Zobrist::piece(uint8_t tag, int sq) { return kZobrist.pieces[zobristIndex(tag)][sq]; }
+uint64_t Zobrist::castling(uint8_t rights) { return kZobrist.castling[rights & 15]; }
+uint64_t Zobrist::epFile(int file) { return kZobrist.epFile[file]; }
+uint64_t Zobrist::side() { return kZobrist.side; }
+
+Position::Position()
+{
+    setFen(kStartFen);
+}
+
+void Position::clear()
+{
+    std::memset(_sets, 0, sizeof(_sets));
+    std::memset(_byColour, 0, sizeof(_byColour));
+    _kingSquare[White] = _kingSquare[Black] = 0;
+    std::memset(_board, 0, sizeof(_board));
+    _key = 0;
+    _sideToMove = White;
+    _castling = 0;
+    _epSquare = kNoSquare;
+    _halfmoveClock = 0;
+    _fullmoveNumber = 1;
+}
+
+void Position::putPiece(int sq, uint8_t tag)
+{
+    uint64_t bb = Attacks::squareBB(sq);
+    _board[sq] = tag;
+    toggleSets(tagPiece(tag), bb);
+    _byColour[tagColour(tag)] |= bb;
+    if (tagPiece(tag) == King) _kingSquare[tagColour(tag)] = (uint8_t)sq;
+    _key ^= Zobrist::piece(tag, sq);
+}
+
+void Position::removePiece(int sq)
+{
+    uint8_t tag = _board[sq];
+    uint64_t bb = Attacks::squareBB(sq);
+    _board[sq] = 0;
+    toggleSets(tagPiece(tag), bb);
+    _byColour[tagColour(tag)] &= ~bb;
+    _key ^= Zobrist::piece(tag, sq);
+}
+
+void Position::movePiece(int from, int to)
+{
+    uint8_t tag = _board[from];
+    uint64_t bb = Attacks::squareBB(from) | Attacks::squareBB(to);
+    _board[to] = tag;
+    _board[from] = 0;
+    toggleSets(tagPiece(tag), bb);
+    _byColour[tagColour(tag)] ^= bb;
+    if (tagPiece(tag) == King) _kingSquare[tagColour(tag)] = (uint8_t)to;
+    _key ^= Zobrist::piece(tag, from) ^ Zobrist::piece(tag, to);
+}
+
+// which of _sets each piece type is in, as masks so updating them needs no branches
+static constexpr uint64_t kSetMembership[7][4] = {
+    { 0, 0, 0, 0 },
+    { ~0ull, 0, 0, 0 },         // pawn
+    { 0, ~0ull, 0, 0 },         // knight
+    { 0, 0, ~0ull, 0 },         // bishop
+    { 0, 0, 0, ~0ull },         // rook
+    { 0, 0, ~0ull, ~0ull },     // queen
+    { 0, 0, 0, 0 },             // king
+};
+
+void Position::toggleSets(ChessPiece piece, uint64_t bb)
+{
+    for (int i = 0; i < 4; i++) _sets[i] ^= bb & kSetMembership[piece][i];
+}
+
+//
+// castling rights whose king or rook is not at home and an en passant square
+// without a pawn that just went past it are dropped. after that the
+// placement has to be one a game can reach: one king each, no pawns on the
+// first or last rank, no more pieces than promotions allow, and the side
+// that just moved not in check. move generation and the move lists rely on it
+//
+bool Position::checkSetup()
+{
+    static const struct { uint8_t right; int king; int rook; uint8_t colour; } kHomes[] = {
+        { kCastleWhiteKing, 4, 7, White }, { kCastleWhiteQueen, 4, 0, White },
+        { kCastleBlackKing, 60, 63, Black }, { kCastleBlackQueen, 60, 56, Black },
+    };
+    for (const auto& home : kHomes) {
+        if (_board[home.king] != pieceTag(home.colour, King) || _board[home.rook] != pieceTag(home.colour, Rook)) {
+            _castling &= (uint8_t)~home.right;
+        }
+    }
+    if (_epSquare != kNoSquare) {
+        int them = _sideToMove ^ 1;
+        int pushed = _epSquare + (them == White ? 8 : -8);
+        int rank = _epSquare >> 3;
+        if (rank != (them == White ? 2 : 5) || _board[_epSquare] || _board[pushed] != pieceTag(them, Pawn)) {
+            _epSquare = kNoSquare;
+        }
+    }
+
+    // kings are the pieces in none of the sets
+    uint64_t kings = occupied() & ~(_sets[kPawnSet] | _sets[kKnightSet] | _sets[kDiagonalSet] | _sets[kStraightSet]);
+    for (int colour = White; colour <= Black; colour++) {
+        if (popCount(kings & pieces(colour)) != 1) return false;
+        int pawns = popCount(pieces(colour, Pawn));
+        int promoted = std::max(0, popCount(pieces(colour, Queen)) - 1) + std::max(0, popCount(pieces(colour, Rook)) - 2) +
+                       std::max(0, popCount(pieces(colour, Bishop)) - 2) + std::max(0, popCount(pieces(colour, Knight)) - 2);
+        if (popCount(pieces(colour)) > 16 || pawns + promoted > 8) return false;
+    }
+    if (pieces(Pawn) & (Attacks::kRank1 | Attacks::kRank8)) return false;
+    return !isAttacked(_kingSquare[_sideToMove ^ 1], _sideToMove);
+}
+
+uint64_t Position::computeKey() const
+{
+    uint64_t key = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if (_board[sq]) key ^= Zobrist::piece(_board[sq], sq);
+    }
+    key ^= Zobrist::castling(_castling);
+    if (_epSquare != kNoSquare) key ^= Zobrist::epFile(_epSquare & 7);
+    if (_sideToMove == Black) key ^= Zobrist::side();
+    return key;
+}
+
+bool Position::setFen(const std::string& fen)
+{
+    clear();
+
+    std::istringstream in(fen);
+    std::string placement, side = "w", castling = "-", ep = "-";
+    int halfmove = 0, fullmove = 1;
+    in >> placement >> side >> castling >> ep >> halfmove >> fullmove;
+    if (placement.empty()) return false;
+
+    // FEN starts at rank 8
+    int file = 0, rank = 7;
+    for (char c : placement) {
+        if (c == '/') {
+            rank--;
+            file = 0;
+        } else if (std::isdigit((unsigned char)c)) {
+            file += c - '0';
+        } else {
+            const char* pieces = "pnbrqk";
+            const char* p = std::strchr(pieces, std::tolower((unsigned char)c));
+            if (!p || file > 7 || rank < 0) return false;
+            ChessPiece piece = (ChessPiece)(Pawn + (p - pieces));
+            putPiece(rank * 8 + file, pieceTag(std::isupper((unsigned char)c) ? White : Black, piece));
+            file++;
+        }
+    }
+
+    _sideToMove = (side == "b") ? Black : White;
+    for (char c : castling) {
+        if (c == 'K') _castling |= kCastleWhiteKing;
+        if (c == 'Q') _castling |= kCastleWhiteQueen;
+        if (c == 'k') _castling |= kCastleBlackKing;
+        if (c == 'q') _castling |= kCastleBlackQueen;
+    }
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] >= '1' && ep[1] <= '8') {
+        int sq = (ep[1] - '1') * 8 + (ep[0] - 'a');
+        // only keep it if a pawn can actually take, so transpositions hash the same
+        if (Attacks::kPawn[_sideToMove ^ 1][sq] & pieces(_sideToMove, Pawn)) {
+            _epSquare = (uint8_t)sq;
+        }
+    }
+    _halfmoveClock = (uint8_t)std::clamp(halfmove, 0, 255);
+    _fullmoveNumber = (uint16_t)std::clamp(fullmove, 1, 65535);
+    bool valid = checkSetup();
+    _key = computeKey();
+
+    return valid;
+}
+
+bool Position::setBoard(const uint8_t board[64], bool whiteToMove, uint8_t castling, int epSquare,
+                        int halfmoveClock, int fullmoveNumber)
+{
+    clear();
+    for (int sq = 0; sq < 64; sq++) {
+        if (board[sq]) putPiece(sq, board[sq]);
+    }
+    _sideToMove = whiteToMove ? White : Black;
+    _castling = castling & 15;
+    if (epSquare >= 0 && epSquare < 64 && (Attacks::kPawn[_sideToMove ^ 1][epSquare] & pieces(_sideToMove, Pawn))) {
+        _epSquare = (uint8_t)epSquare;
+    }
+    _halfmoveClock = (uint8_t)std::clamp(halfmoveClock, 0, 255);
+    _fullmoveNumber = (uint16_t)std::clamp(fullmoveNumber, 1, 65535);
+    bool valid = checkSetup();
+    _key = computeKey();
+
+    return valid;
+}
+
+std::string Position::fen() const
+{
+    std::string s;
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            uint8_t tag = _board[rank * 8 + file];
+            if (!tag) {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                s += (char)('0' + empty);
+                empty = 0;
+            }
+            char c = " pnbrqk"[tagPiece(tag)];
+            s += tagColour(tag) == White ? (char)std::toupper((unsigned char)c) : c;
+        }
+        if (empty) s += (char)('0' + empty);
+        if (rank) s += '/';
+    }
+
+    s += _sideToMove == White ? " w " : " b ";
+    if (!_castling) s += '-';
+    if (_castling & kCastleWhiteKing) s += 'K';
+    if (_castling & kCastleWhiteQueen) s += 'Q';
+    if (_castling & kCastleBlackKing) s += 'k';
+    if (_castling & kCastleBlackQueen) s += 'q';
+    s += ' ';
+    if (_epSquare == kNoSquare) {
+        s += '-';
+    } else {
+        s += (char)('a' + (_epSquare & 7));
+        s += (char)('1' + (_epSquare >> 3));
+    }
+    s += ' ';
+    s += std::to_string(_halfmoveClock);
+    s += ' ';
+    s += std::to_string(_fullmoveNumber);
+    return s;
+}
+
+bool Position::insufficientMaterial() const
+{
+    if (_sets[kPawnSet] | _sets[kStraightSet]) return false;
+    uint64_t minors = _sets[kKnightSet] | _sets[kDiagonalSet];
+    if (popCount(minors) <= 1) return true;
+    // any knight next to another minor can help a mate, as can opposite bishops
+    constexpr uint64_t kDarkSquares = 0xAA55AA55AA55AA55ull;
+    uint64_t bishops = _sets[kDiagonalSet];
+    return !_sets[kKnightSet] && (!(bishops & kDarkSquares) || !(bishops & ~kDarkSquares));
+}
+
+uint64_t Position::attackersTo(int sq, uint64_t occupied) const
+{
+    uint64_t diagonal = _sets[kDiagonalSet];
+    uint64_t straight = _sets[kStraightSet];
+    return (Attacks::kPawn[White][sq] & pieces(Black, Pawn)) |
+           (Attacks::kPawn[Black][sq] & pieces(White, Pawn)) |
+           (Attacks::kKnight[sq] & _sets[kKnightSet]) |
+           (Attacks::kKing[sq] & pieces(King)) |
+           (Attacks::bishop(sq, occupied) & diagonal) |
+           (Attacks::rook(sq, occupied) & straight);
+}
+
+static void addPromotions(MoveList& list, int from, int to, bool capture)
+{
+    int base = kPromotionFlag | (capture ? kCaptureFlag : 0);
+    list.push(Move(from, to, base + 3));
+    list.push(Move(from, to, base + 0));
+    list.push(Move(from, to, base + 2));
+    list.push(Move(from, to, base + 1));
+}
+
+//
+// the side to move, as constants for the code templated on it: pawn
+// direction, promotion and double push ranks and castling squares fold
+// into the instructions instead of being picked at run time
+//
+template <int Us>
+struct SideConstants
+{
+    static constexpr int kThem = Us ^ 1;
+    static constexpr int kUp = Us == White ? 8 : -8;
+    static constexpr uint64_t kPromotionRank = Us == White ? Attacks::kRank8 : Attacks::kRank1;
+    static constexpr uint64_t kDoublePushRank = Us == White ? (Attacks::kRank1 << 24) : (Attacks::kRank1 << 32);
+    static constexpr int kBackRank = Us == White ? 0 : 56;
+    static constexpr uint8_t kKingSide = Us == White ? kCastleWhiteKing : kCastleBlackKing;
+    static constexpr uint8_t kQueenSide = Us == White ? kCastleWhiteQueen : kCastleBlackQueen;
+
+    static constexpr uint64_t forward(uint64_t bb) { return Us == White ? bb << 8 : bb >> 8; }
+};
+
+// castling is fully checked here, the king may not pass through attacked
+// squares; the result is the king's destination squares
+template <int Us, typename Attacked>
+uint64_t Position::castlingTargets(Attacked attacked) const
+{
+    using Side = SideConstants<Us>;
+    constexpr int rank = Side::kBackRank;
+    if ((_castling & (Side::kKingSide | Side::kQueenSide)) == 0 || attacked(rank + 4)) return 0;
+
+    uint64_t occ = occupied();
+    uint64_t rooks = pieces(Us, Rook);
+    uint64_t targets = 0;
+    if ((_castling & Side::kKingSide) && (rooks & Attacks::squareBB(rank + 7)) && !(occ & (Attacks::squareBB(rank + 5) | Attacks::squareBB(rank + 6))) &&
+        !attacked(rank + 5) && !attacked(rank + 6)) {
+        targets |= Attacks::squareBB(rank + 6);
+    }
+    if ((_castling & Side::kQueenSide) && (rooks & Attacks::squareBB(rank)) &&
+        !(occ & (Attacks::squareBB(rank + 1) | Attacks::squareBB(rank + 2) | Attacks::squareBB(rank + 3))) &&
+        !attacked(rank + 3) && !attacked(rank + 2)) {
+        targets |= Attacks::squareBB(rank + 2);
+    }
+    return targets;
+}
+
+template <int Us>
+static void addCastling(MoveList& list, uint64_t targets)
+{
+    constexpr int rank = SideConstants<Us>::kBackRank;
+    if (targets & Attacks::squareBB(rank + 6)) list.push(Move(rank + 4, rank + 6, kKingCastle));
+    if (targets & Attacks::squareBB(rank + 2)) list.push(Move(rank + 4, rank + 2, kQueenCastle));
+}
+
+void Position::generateMoves(MoveList& list, bool capturesOnly) const
+{
+    if (_sideToMove == White) generateMoves<White>(list, capturesOnly);
+    else generateMoves<Black>(list, capturesOnly);
+}
+
+void Position::generateMoves(MoveList& list, bool capturesOnly, AttackInfo& info) const
+{
+    if (_sideToMove == White) generateMoves<White>(list, capturesOnly, info);
+    else generateMoves<Black>(list, capturesOnly, info);
+}
+
+template <int Us>
+void Position::generateMoves(MoveList& list, bool capturesOnly) const
+{
+    if (capturesOnly) {
+        generatePieceMoves<Us, true>(list);
+        return;
+    }
+    generatePieceMoves<Us, false>(list);
+    addCastling<Us>(list, castlingTargets<Us>([&](int sq) { return isAttacked(sq, Us ^ 1); }));
+}
+
+template <int Us>
+void Position::generateMoves(MoveList& list, bool capturesOnly, AttackInfo& info) const
+{
+    if (capturesOnly) {
+        generatePieceMoves<Us, true>(list);
+        return;
+    }
+    generatePieceMoves<Us, false>(list);
+    addCastling<Us>(list, castlingTargets<Us>([&](int sq) { return (info.kingDanger() & Attacks::squareBB(sq)) != 0; }));
+}
+
+template <int Us, bool CapturesOnly>
+void Position::generatePieceMoves(MoveList& list) const
+{
+    using Side = SideConstants<Us>;
+    uint64_t own = pieces(Us), enemy = pieces(Side::kThem), occ = own | enemy;
+    uint64_t targets = CapturesOnly ? enemy : ~own;
+
+    //  PAWNS
+    uint64_t pawns = pieces(Us, Pawn);
+    uint64_t single = Side::forward(pawns) & ~occ;
+    uint64_t pushes = CapturesOnly ? (single & Side::kPromotionRank) : single;
+    while (pushes) {
+        int to = popLsb(pushes);
+        if (Attacks::squareBB(to) & Side::kPromotionRank) addPromotions(list, to - Side::kUp, to, false);
+        else list.push(Move(to - Side::kUp, to, kQuietMove));
+    }
+    if (!CapturesOnly) {
+        uint64_t doubles = Side::forward(single) & ~occ & Side::kDoublePushRank;
+        while (doubles) {
+            int to = popLsb(doubles);
+            list.push(Move(to - 2 * Side::kUp, to, kDoublePawnPush));
+        }
+    }
+    uint64_t attackers = pawns;
+    while (attackers) {
+        int from = popLsb(attackers);
+        uint64_t caps = Attacks::kPawn[Us][from] & enemy;
+        while (caps) {
+            int to = popLsb(caps);
+            if (Attacks::squareBB(to) & Side::kPromotionRank) addPromotions(list, from, to, true);
+            else list.push(Move(from, to, kCaptureFlag));
+        }
+        if (_epSquare != kNoSquare && (Attacks::kPawn[Us][from] & Attacks::squareBB(_epSquare))) {
+            list.push(Move(from, _epSquare, kEnPassant));
+        }
+    }
+
+    //  PIECES
+    for (int piece = Knight; piece <= King; piece++) {
+        uint64_t bb = pieces(Us, (ChessPiece)piece);
+        while (bb) {
+            int from = popLsb(bb);
+            uint64_t attacks = 0;
+            switch (piece) {
+                case Knight: attacks = Attacks::kKnight[from]; break;
+                case Bishop: attacks = Attacks::bishop(from, occ); break;
+                case Rook:   attacks = Attacks::rook(from, occ); break;
+                case Queen:  attacks = Attacks::queen(from, occ); break;
+                case King:   attacks = Attacks::kKing[from]; break;
+            }
+            attacks &= targets;
+            while (attacks) {
+                int to = popLsb(attacks);
+                list.push(Move(from, to, (enemy & Attacks::squareBB(to)) ? kCaptureFlag : kQuietMove));
+            }
+        }
+    }
+}
+
+bool Position::isLegal(Move m) const
+{
+    if (m.isCastle()) return true;
+
+    int us = _sideToMove, them = us ^ 1;
+    int from = m.from(), to = m.to();
+    uint64_t occ = occupied();
+
+    if (from == kingSquare(us)) {
+        // take the king off the board so sliders see through its old square
+        return (attackersTo(to, occ ^ Attacks::squareBB(from)) & pieces(them)) == 0;
+    }
+
+    uint64_t captured = Attacks::squareBB(to);
+    if (m.flags() == kEnPassant) {
+        int capSq = to + (us == White ? -8 : 8);
+        captured = Attacks::squareBB(capSq);
+        occ ^= captured;
+    }
+    occ = (occ ^ Attacks::squareBB(from)) | Attacks::squareBB(to);
+    return (attackersTo(kingSquare(us), occ) & pieces(them) & ~captured) == 0;
+}
+
+void Position::generateLegalMoves(MoveList& list) const
+{
+    MoveList pseudo;
+    generateMoves(pseudo);
+    list.count = 0;
+    for (Move m : pseudo) {
+        if (isLegal(m)) list.push(m);
+    }
+}
+
+uint64_t Position::pinnedPieces(int colour) const
+{
+    int them = colour ^ 1;
+    int king = kingSquare(colour);
+    uint64_t occ = occupied();
+    uint64_t pinned = 0;
+    uint64_t snipers = ((Attacks::rook(king, 0) & straightSliders()) | (Attacks::bishop(king, 0) & diagonalSliders())) &
+                       pieces(them);
+    while (snipers) {
+        uint64_t blockers = Attacks::between(king, popLsb(snipers)) & occ;
+        if ((blockers & pieces(colour)) && !(blockers & (blockers - 1))) pinned |= blockers;
+    }
+    return pinned;
+}
+
+// the ray from the king through a pinned piece, the only squares it may move to
+static uint64_t pinRay(int king, int sq)
+{
+    for (int dir = 0; dir < 8; dir++) {
+        if (Attacks::kRays[dir][king] & Attacks::squareBB(sq)) return Attacks::kRays[dir][king];
+    }
+    return 0;
+}
+
+//
+// the cheap moves are tried first: a king step only needs its square to be
+// safe. after that a double check leaves nothing, a single check narrows the
+// targets to taking or blocking the checker, and any move of a piece that is
+// not pinned to the king is legal. pinned pieces and en passant, both rare,
+// go through isLegal(). castling is never needed: it can only be legal when
+// the step to the square next to the king is
+//
+bool Position::hasLegalMove() const
+{
+    int us = _sideToMove, them = us ^ 1;
+    int king = kingSquare(us);
+    uint64_t own = pieces(us), enemy = pieces(them), occ = own | enemy;
+
+    uint64_t steps = Attacks::kKing[king] & ~own;
+    while (steps) {
+        if (!(attackersTo(popLsb(steps), occ ^ Attacks::squareBB(king)) & enemy)) return true;
+    }
+
+    uint64_t checks = checkers();
+    if (checks & (checks - 1)) return false;
+    uint64_t targets = checks ? (Attacks::between(king, lsb(checks)) | checks) : ~own;
+    uint64_t pinned = pinnedPieces(us);
+
+    auto anyLegal = [&](int from, uint64_t moves) {
+        if (!(pinned & Attacks::squareBB(from))) return moves != 0;
+        return (moves & pinRay(king, from)) != 0;
+    };
+
+    for (int piece = Knight; piece <= Queen; piece++) {
+        uint64_t bb = pieces(us, (ChessPiece)piece);
+        while (bb) {
+            int from = popLsb(bb);
+            uint64_t attacks = 0;
+            switch (piece) {
+                case Knight: attacks = Attacks::kKnight[from]; break;
+                case Bishop: attacks = Attacks::bishop(from, occ); break;
+                case Rook:   attacks = Attacks::rook(from, occ); break;
+                case Queen:  attacks = Attacks::queen(from, occ); break;
+            }
+            if (anyLegal(from, attacks & targets)) return true;
+        }
+    }
+
+    uint64_t pawns = pieces(us, Pawn);
+    int up = us == White ? 8 : -8;
+    uint64_t doubleRank = us == White ? (Attacks::kRank1 << 24) : (Attacks::kRank1 << 32);
+    uint64_t single = (us == White ? pawns << 8 : pawns >> 8) & ~occ;
+    uint64_t doubles = (us == White ? single << 8 : single >> 8) & ~occ & doubleRank;
+    for (uint64_t b = single & targets; b;) {
+        int to = popLsb(b);
+        if (anyLegal(to - up, Attacks::squareBB(to))) return true;
+    }
+    for (uint64_t b = doubles & targets; b;) {
+        int to = popLsb(b);
+        if (anyLegal(to - 2 * up, Attacks::squareBB(to))) return true;
+    }
+    while (pawns) {
+        int from = popLsb(pawns);
+        if (anyLegal(from, Attacks::kPawn[us][from] & enemy & targets)) return true;
+        if (_epSquare != kNoSquare && (Attacks::kPawn[us][from] & Attacks::squareBB(_epSquare)) &&
+            isLegal(Move(from, _epSquare, kEnPassant))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// the same steps as hasLegalMove(), collecting instead of stopping. a
+// pinned piece keeps the squares on its pin ray; en passant still goes
+// through isLegal() since it takes two pieces off one rank
+//
+void Position::legalTargets(TargetList& list) const
+{
+    if (_sideToMove == White) legalTargets<White>(list);
+    else legalTargets<Black>(list);
+}
+
+template <int Us>
+void Position::legalTargets(TargetList& list) const
+{
+    using Side = SideConstants<Us>;
+    int king = kingSquare(Us);
+    uint64_t own = pieces(Us), enemy = pieces(Side::kThem), occ = own | enemy;
+    list.count = 0;
+    list.moves = 0;
+
+    uint64_t kingTargets = 0;
+    for (uint64_t steps = Attacks::kKing[king] & ~own; steps;) {
+        int to = popLsb(steps);
+        if (!(attackersTo(to, occ ^ Attacks::squareBB(king)) & enemy)) kingTargets |= Attacks::squareBB(to);
+    }
+
+    uint64_t checks = checkers();
+    if (!checks) kingTargets |= castlingTargets<Us>([&](int sq) { return isAttacked(sq, Side::kThem); });
+    if (kingTargets) {
+        list.push(king, kingTargets);
+        list.moves += popCount(kingTargets);
+    }
+    if (checks & (checks - 1)) return;
+
+    uint64_t targets = checks ? (Attacks::between(king, lsb(checks)) | checks) : ~own;
+    uint64_t pinned = pinnedPieces(Us);
+    auto add = [&](int from, uint64_t to) {
+        if (pinned & Attacks::squareBB(from)) to &= pinRay(king, from);
+        if (!to) return;
+        list.push(from, to);
+        list.moves += popCount(to);
+    };
+
+    for (int piece = Knight; piece <= Queen; piece++) {
+        uint64_t bb = pieces(Us, (ChessPiece)piece);
+        while (bb) {
+            int from = popLsb(bb);
+            uint64_t attacks = 0;
+            switch (piece) {
+                case Knight: attacks = Attacks::kKnight[from]; break;
+                case Bishop: attacks = Attacks::bishop(from, occ); break;
+                case Rook:   attacks = Attacks::rook(from, occ); break;
+                case Queen:  attacks = Attacks::queen(from, occ); break;
+            }
+            add(from, attacks & targets);
+        }
+    }
+
+    for (uint64_t pawns = pieces(Us, Pawn); pawns;) {
+        int from = popLsb(pawns);
+        uint64_t single = Side::forward(Attacks::squareBB(from)) & ~occ;
+        uint64_t to = single | (Attacks::kPawn[Us][from] & enemy);
+        to |= Side::forward(single) & Side::kDoublePushRank & ~occ;
+        to &= targets;
+        // en passant is tested whole, after the check mask: the pawn it takes may be the checker
+        if (_epSquare != kNoSquare && (Attacks::kPawn[Us][from] & Attacks::squareBB(_epSquare)) &&
+            isLegal(Move(from, _epSquare, kEnPassant))) {
+            to |= Attacks::squareBB(_epSquare);
+        }
+        int before = list.count;
+        add(from, to);
+        if (list.count > before) list.moves += 3 * popCount(list.pieces[before].to & Side::kPromotionRank);
+    }
+}
+
+int Position::countLegalMoves() const
+{
+    TargetList list;
+    legalTargets(list);
+    return list.moves;
+}
+
+Move Position::parseUciMove(const std::string& uci) const
+{
+    return parseLan(*this, uci);
+}
+
+void Position::makeMove(Move m, UndoInfo& undo)
+{
+    if (_sideToMove == White) makeMove<White>(m, undo);
+    else makeMove<Black>(m, undo);
+}
+
+void Position::unmakeMove(Move m, const UndoInfo& undo)
+{
+    if (_sideToMove == Black) unmakeMove<White>(m, undo);
+    else unmakeMove<Black>(m, undo);
+}
+
+template <int Us>
+void Position::makeMove(Move m, UndoInfo& undo)
+{
+    using Side = SideConstants<Us>;
+    int from = m.from(), to = m.to();
+    uint8_t moving = _board[from];
+
+    undo.key = _key;
+    undo.castling = _castling;
+    undo.epSquare = _epSquare;
+    undo.halfmoveClock = (uint8_t)_halfmoveClock;
+    undo.captured = 0;
+
+    if (_epSquare != kNoSquare) {
+        _key ^= Zobrist::epFile(_epSquare & 7);
+        _epSquare = kNoSquare;
+    }
+    if (_halfmoveClock < 255) ++_halfmoveClock;
+
+    if (m.flags() == kEnPassant) {
+        int capSq = to - Side::kUp;
+        undo.captured = _board[capSq];
+        removePiece(capSq);
+    } else if (m.isCapture()) {
+        undo.captured = _board[to];
+        removePiece(to);
+    }
+    if (undo.captured || tagPiece(moving) == Pawn) _halfmoveClock = 0;
+
+    movePiece(from, to);
+
+    if (m.isPromotion()) {
+        removePiece(to);
+        putPiece(to, pieceTag(Us, m.promotionPiece()));
+    } else if (m.flags() == kDoublePawnPush) {
+        int epSq = (from + to) / 2;
+        if (Attacks::kPawn[Us][epSq] & pieces(Side::kThem, Pawn)) {
+            _epSquare = (uint8_t)epSq;
+            _key ^= Zobrist::epFile(epSq & 7);
+        }
+    } else if (m.flags() == kKingCastle) {
+        movePiece(to + 1, to - 1);
+    } else if (m.flags() == kQueenCastle) {
+        movePiece(to - 2, to + 1);
+    }
+
+    uint8_t rights = _castling & kCastleMasks[from] & kCastleMasks[to];
+    if (rights != _castling) {
+        _key ^= Zobrist::castling(_castling) ^ Zobrist::castling(rights);
+        _castling = rights;
+    }
+
+    if (Us == Black) _fullmoveNumber++;
+    _sideToMove = Side::kThem;
+    _key ^= Zobrist::side();
+}
+
+template <int Us>
+void Position::unmakeMove(Move m, const UndoInfo& undo)
+{
+    using Side = SideConstants<Us>;
+    _sideToMove = Us;
+    int from = m.from(), to = m.to();
+    if (Us == Black) _fullmoveNumber--;
+
+    if (m.isPromotion()) {
+        removePiece(to);
+        putPiece(to, pieceTag(Us, Pawn));
+    } else if (m.flags() == kKingCastle) {
+        movePiece(to - 1, to + 1);
+    } else if (m.flags() == kQueenCastle) {
+        movePiece(to + 1, to - 2);
+    }
+    movePiece(to, from);
+
+    if (m.flags() == kEnPassant) {
+        putPiece(to - Side::kUp, undo.captured);
+    } else if (undo.captured) {
+        putPiece(to, undo.captured);
+    }
+
+    _castling = undo.castling;
+    _epSquare = undo.epSquare;
+    _halfmoveClock = undo.halfmoveClock;
+    _key = undo.key;
+}
+
+void Position::makeNullMove(UndoInfo& undo)
+{
+    undo.key = _key;
+    undo.castling = _castling;
+    undo.epSquare = _epSquare;
+    undo.halfmoveClock = (uint8_t)_halfmoveClock;
+    undo.captured = 0;
+
+    if (_epSquare != kNoSquare) {
+        _key ^= Zobrist::epFile(_epSquare & 7);
+        _epSquare = kNoSquare;
+    }
+    if (_halfmoveClock < 255) ++_halfmoveClock;
+    _sideToMove ^= 1;
+    _key ^= Zobrist::side();
+}
+
+void Position::unmakeNullMove(const UndoInfo& undo)
+{
+    _sideToMove ^= 1;
+    _epSquare = undo.epSquare;
+    _halfmoveClock = undo.halfmoveClock;
+    _key = undo.key;
+}
+
+template void Position::generateMoves<White>(MoveList&, bool, AttackInfo&) const;
+template void Position::generateMoves<Black>(MoveList&, bool, AttackInfo&) const;
+template void Position::makeMove<White>(Move, UndoInfo&);
+template void Position::makeMove<Black>(Move, UndoInfo&);
+template void Position::unmakeMove<White>(Move, const UndoInfo&);
+template void Position::unmakeMove<Black>(Move, const UndoInfo&);
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "Attacks.h"
+#include "Move.h"
+#include <string>
+
+//
+// headless chess position used by the search and the command line tools
+//
+// squares are a1 = 0 .. h8 = 63 (the GUI grid has y = 0 at the top, so
+// GUI index (y * 8 + x) maps to square ((7 - y) * 8 + x))
+// pieces on the mailbox use the same tags as the GUI bits:
+// ChessPiece for white, 128 + ChessPiece for black
+//
+
+enum Colour { White = 0, Black = 1 };
+
+constexpr uint8_t pieceTag(int colour, ChessPiece piece) { return (uint8_t)(piece | (colour ? 128 : 0)); }
+constexpr ChessPiece tagPiece(uint8_t tag) { return (ChessPiece)(tag & 127); }
+constexpr int tagColour(uint8_t tag) { return (tag & 128) ? Black : White; }
+
+constexpr const char* kStartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// everything makeMove() overwrites that unmakeMove() cannot recompute
+class AttackInfo;
+
+struct UndoInfo
+{
+    uint64_t key;
+    uint8_t  captured;
+    uint8_t  castling;
+    uint8_t  epSquare;
+    uint8_t  halfmoveClock;
+};
+
+//
+// a position is two cache lines, aligned to them: the first holds the
+// bitboards, the hash key and the game state, the second the mailbox. a
+// queen sits in both slider sets, so the three slider types take two
+// bitboards, and the kings are kept as squares. that keeps copying a
+// position as cheap as undoing a move (see "perft bench" in the UCI tool)
+//
+class alignas(64) Position
+{
+public:
+    Position();
+
+    // both return false for a placement no game can reach (see checkSetup),
+    // and the position must not be searched then
+    bool setFen(const std::string& fen);
+    std::string fen() const;
+    // set up from a mailbox of piece tags, e.g. an unpacked training record
+    bool setBoard(const uint8_t board[64], bool whiteToMove, uint8_t castling, int epSquare,
+                  int halfmoveClock = 0, int fullmoveNumber = 1);
+
+    // board access
+    uint8_t pieceOn(int sq) const { return _board[sq]; }
+    const uint8_t* board() const { return _board; }
+    uint64_t pieces(int colour) const { return _byColour[colour]; }
+    uint64_t pieces(ChessPiece piece) const
+    {
+        switch (piece) {
+            case Pawn:   return _sets[kPawnSet];
+            case Knight: return _sets[kKnightSet];
+            case Bishop: return _sets[kDiagonalSet] & ~_sets[kStraightSet];
+            case Rook:   return _sets[kStraightSet] & ~_sets[kDiagonalSet];
+            case Queen:  return _sets[kDiagonalSet] & _sets[kStraightSet];
+            case King:   return Attacks::squareBB(_kingSquare[White]) | Attacks::squareBB(_kingSquare[Black]);
+            default:     return 0;
+        }
+    }
+    uint64_t pieces(int colour, ChessPiece piece) const
+    {
+        return piece == King ? Attacks::squareBB(_kingSquare[colour]) : _byColour[colour] & pieces(piece);
+    }
+    // bishops and queens, rooks and queens
+    uint64_t diagonalSliders() const { return _sets[kDiagonalSet]; }
+    uint64_t straightSliders() const { return _sets[kStraightSet]; }
+    uint64_t occupied() const { return _byColour[White] | _byColour[Black]; }
+    int kingSquare(int colour) const { return _kingSquare[colour]; }
+
+    // state
+    int sideToMove() const { return _sideToMove; }
+    bool whiteToMove() const { return _sideToMove == White; }
+    uint8_t castling() const { return _castling; }
+    int epSquare() const { return _epSquare; }
+    int halfmoveClock() const { return _halfmoveClock; }
+    int fullmoveNumber() const { return _fullmoveNumber; }
+    uint64_t key() const { return _key; }
+
+    // attacks
+    uint64_t attackersTo(int sq, uint64_t occupied) const;
+    bool isAttacked(int sq, int byColour) const { return (attackersTo(sq, occupied()) & pieces(byColour)) != 0; }
+    bool inCheck() const { return isAttacked(kingSquare(_sideToMove), _sideToMove ^ 1); }
+    // pieces giving check to the side to move
+    uint64_t checkers() const { return attackersTo(kingSquare(_sideToMove), occupied()) & pieces(_sideToMove ^ 1); }
+    // pieces of this colour that are the only thing between their king and an enemy slider
+    uint64_t pinnedPieces(int colour) const;
+
+    // move generation, pseudo-legal moves need isLegal() before they are played
+    void generateMoves(MoveList& list, bool capturesOnly = false) const;
+    // the same, testing the castling squares against the node's cached attacks
+    void generateMoves(MoveList& list, bool capturesOnly, AttackInfo& info) const;
+    void generateLegalMoves(MoveList& list) const;
+    bool isLegal(Move m) const;
+    // stops at the first legal move found, for telling mate and stalemate apart from play
+    bool hasLegalMove() const;
+    // legal destinations of every piece as bitboards, check and pins already applied;
+    // counting from these is much cheaper than generating and testing a MoveList
+    void legalTargets(TargetList& list) const;
+    int countLegalMoves() const;
+    Move parseUciMove(const std::string& uci) const;
+
+    void makeMove(Move m, UndoInfo& undo);
+    void unmakeMove(Move m, const UndoInfo& undo);
+
+    // the same with the side to move fixed at compile time, Us has to be it
+    // (for unmakeMove, the side that made the move); the calls above pick one
+    // of these, a search that knows the side already can skip that branch
+    template <int Us> void generateMoves(MoveList& list, bool capturesOnly, AttackInfo& info) const;
+    template <int Us> void makeMove(Move m, UndoInfo& undo);
+    template <int Us> void unmakeMove(Move m, const UndoInfo& undo);
+    void makeNullMove(UndoInfo& undo);
+    void unmakeNullMove(const UndoInfo& undo);
+
+    // material left on the board apart from kings and pawns, used to avoid null moves in zugzwang
+    bool hasNonPawnMaterial(int colour) const
+    {
+        return (pieces(colour) & ~pieces(colour, Pawn) & ~pieces(colour, King)) != 0;
+    }
+    // neither side can ever mate: bare kings, a single minor piece, or only
+    // bishops that all stand on squares of one colour
+    bool insufficientMaterial() const;
+
+private:
+    template <int Us> void generateMoves(MoveList& list, bool capturesOnly) const;
+    template <int Us, bool CapturesOnly> void generatePieceMoves(MoveList& list) const;
+    template <int Us, typename Attacked> uint64_t castlingTargets(Attacked attacked) const;
+    template <int Us> void legalTargets(TargetList& list) const;
+    void clear();
+    void putPiece(int sq, uint8_t tag);
+    void removePiece(int sq);
+    void movePiece(int from, int to);
+    void toggleSets(ChessPiece piece, uint64_t bb);
+    bool checkSetup();
+    uint64_t computeKey() const;
+
+    enum { kPawnSet, kKnightSet, kDiagonalSet, kStraightSet };
+
+    // bitboards, key and state
+    uint64_t _sets[4];          // pawns, knights, bishops + queens, rooks + queens
+    uint64_t _byColour[2];
+    uint64_t _key;
+    uint8_t  _kingSquare[2];    // kings are not in _sets, a square is all they need
+    uint8_t  _sideToMove;
+    uint8_t  _castling;         // kCastle* bits
+    uint8_t  _epSquare;         // kNoSquare if none
+    uint8_t  _halfmoveClock;    // stops at 255, well past the fifty move draw
+    uint16_t _fullmoveNumber;
+    // mailbox
+    uint8_t  _board[64];
+};
+
+static_assert(sizeof(Position) == 128, "a position is meant to be exactly two cache lines");
+
+// zobrist keys, exposed so other tables can hash incrementally the same way
+namespace Zobrist {
+    uint64_t piece(uint8_t tag, int sq);
+    uint64_t castling(uint8_t rights);
+    uint64_t epFile(int file);
+    uint64_t side();
+}
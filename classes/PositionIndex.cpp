@@ -0,0 +1,344 @@
+#include "PositionIndex.h"
+#include "Notation.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+static constexpr char kMagic[8] = { 'C', 'H', 'P', 'I', 'D', 'X', '0', '1' };
+static constexpr size_t kHeaderSize = 16;
+static constexpr size_t kEntrySize = 16;
+static constexpr int kMaxIndexedPly = (1 << 14) - 1;
+static constexpr size_t kIoEntries = 1 << 14;
+
+static uint64_t readLittleEndian(const uint8_t* p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void writeLittleEndian(uint8_t* p, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static void writeEntry(uint8_t* out, const PositionEntry& e)
+{
+    writeLittleEndian(out, e.key, 8);
+    writeLittleEndian(out + 8, e.game, 4);
+    writeLittleEndian(out + 12, (uint16_t)(e.ply | ((e.result + 1) << 14)), 2);
+    writeLittleEndian(out + 14, e.next.raw(), 2);
+}
+
+static PositionEntry readEntry(const uint8_t* in)
+{
+    PositionEntry e;
+    e.key = readLittleEndian(in, 8);
+    e.game = (uint32_t)readLittleEndian(in + 8, 4);
+    uint16_t plyResult = (uint16_t)readLittleEndian(in + 12, 2);
+    e.ply = plyResult & kMaxIndexedPly;
+    e.result = (int8_t)((plyResult >> 14) - 1);
+    e.next = Move((uint16_t)readLittleEndian(in + 14, 2));
+    return e;
+}
+
+static bool entryBefore(const PositionEntry& a, const PositionEntry& b)
+{
+    if (a.key != b.key) return a.key < b.key;
+    if (a.game != b.game) return a.game < b.game;
+    return a.ply < b.ply;
+}
+
+// buffered sequential writer for entry files
+class EntryWriter
+{
+public:
+    bool open(const std::string& path, bool withHeader)
+    {
+        _out.open(path, std::ios::binary | std::ios::trunc);
+        if (withHeader) {
+            uint8_t header[kHeaderSize] = {};
+            _out.write((const char*)header, kHeaderSize);
+        }
+        _buffer.clear();
+        _count = 0;
+        return (bool)_out;
+    }
+
+    void add(const PositionEntry& e)
+    {
+        uint8_t bytes[kEntrySize];
+        writeEntry(bytes, e);
+        _buffer.insert(_buffer.end(), bytes, bytes + kEntrySize);
+        _count++;
+        if (_buffer.size() >= kIoEntries * kEntrySize) flush();
+    }
+
+    // fills in the header when there is one
+    bool finish(bool withHeader)
+    {
+        flush();
+        if (withHeader) {
+            uint8_t header[kHeaderSize];
+            std::memcpy(header, kMagic, 8);
+            writeLittleEndian(header + 8, _count, 8);
+            _out.seekp(0);
+            _out.write((const char*)header, kHeaderSize);
+        }
+        bool ok = (bool)_out;
+        _out.close();
+        return ok;
+    }
+
+private:
+    void flush()
+    {
+        _out.write((const char*)_buffer.data(), (std::streamsize)_buffer.size());
+        _buffer.clear();
+    }
+
+    std::ofstream _out;
+    std::vector<uint8_t> _buffer;
+    uint64_t _count = 0;
+};
+
+// buffered sequential reader for run files
+class RunReader
+{
+public:
+    bool open(const std::string& path)
+    {
+        _in.open(path, std::ios::binary);
+        return (bool)_in;
+    }
+
+    bool next(PositionEntry& e)
+    {
+        if (_pos >= _size) {
+            _buffer.resize(kIoEntries * kEntrySize);
+            _in.read((char*)_buffer.data(), (std::streamsize)_buffer.size());
+            _size = (size_t)_in.gcount() / kEntrySize * kEntrySize;
+            _pos = 0;
+            if (_size == 0) return false;
+        }
+        e = readEntry(_buffer.data() + _pos);
+        _pos += kEntrySize;
+        return true;
+    }
+
+private:
+    std::ifstream _in;
+    std::vector<uint8_t> _buffer;
+    size_t _pos = 0;
+    size_t _size = 0;
+};
+
+static std::string runPath(const std::string& path, int run)
+{
+    return path + ".run" + std::to_string(run);
+}
+
+// k-way merge of the sorted runs into the final index
+static bool mergeRuns(const std::string& path, int runs)
+{
+    std::vector<std::unique_ptr<RunReader>> readers;
+    for (int r = 0; r < runs; r++) {
+        readers.push_back(std::make_unique<RunReader>());
+        if (!readers.back()->open(runPath(path, r))) return false;
+    }
+
+    using Head = std::pair<PositionEntry, int>;
+    auto later = [](const Head& a, const Head& b) { return entryBefore(b.first, a.first); };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+    for (int r = 0; r < runs; r++) {
+        PositionEntry e;
+        if (readers[r]->next(e)) heads.push({ e, r });
+    }
+
+    EntryWriter writer;
+    if (!writer.open(path, true)) return false;
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        writer.add(head.first);
+        PositionEntry e;
+        if (readers[head.second]->next(e)) heads.push({ e, head.second });
+    }
+    return writer.finish(true);
+}
+
+bool buildPositionIndex(const GameArchive& archive, const std::string& path, const IndexBuildOptions& options,
+                        IndexBuildStats& stats)
+{
+    stats = IndexBuildStats();
+    if (!archive.isOpen() || archive.games() > UINT32_MAX) return false;
+
+    int maxPlies = options.maxPlies > 0 ? std::min(options.maxPlies, kMaxIndexedPly) : kMaxIndexedPly;
+    size_t runEntries = std::max<size_t>(options.memoryBytes / sizeof(PositionEntry), 1024);
+
+    std::mutex mutex;
+    std::vector<PositionEntry> pending;
+    bool ok = true;
+    // sorts and writes one run; the caller has already taken its number, so
+    // workers only hold the mutex to hand entries over, not for the disk
+    auto writeRun = [&](std::vector<PositionEntry>& entries, int index) {
+        std::sort(entries.begin(), entries.end(), entryBefore);
+        EntryWriter run;
+        bool written = run.open(runPath(path, index), false);
+        if (written) {
+            for (const PositionEntry& e : entries) run.add(e);
+            written = run.finish(false);
+        }
+        entries.clear();
+        return written;
+    };
+
+    std::atomic<size_t> nextBlock(0);
+    auto work = [&]() {
+        std::vector<PgnGame> games;
+        std::vector<PositionEntry> entries, run;
+        for (size_t b = nextBlock++; b < archive.blocks(); b = nextBlock++) {
+            if (!archive.readBlock(b, games)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ok = false;
+                continue;
+            }
+            entries.clear();
+            uint64_t firstGame = archive.block(b).firstGame;
+            for (size_t g = 0; g < games.size(); g++) {
+                const PgnGame& game = games[g];
+                Position pos;
+                pos.setFen(game.startFen);
+                int plies = std::min<int>(maxPlies, (int)game.moves.size());
+                for (int ply = 0; ply <= plies; ply++) {
+                    PositionEntry e;
+                    e.key = pos.key();
+                    e.game = (uint32_t)(firstGame + g);
+                    e.ply = (uint16_t)ply;
+                    e.result = game.result;
+                    e.next = ply < (int)game.moves.size() ? game.moves[ply] : Move::none();
+                    entries.push_back(e);
+                    if (ply == plies) break;
+                    UndoInfo undo;
+                    pos.makeMove(game.moves[ply], undo);
+                }
+            }
+
+            int index = -1;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.games += games.size();
+                stats.entries += entries.size();
+                pending.insert(pending.end(), entries.begin(), entries.end());
+                if (pending.size() >= runEntries) {
+                    run.swap(pending);
+                    index = stats.runs++;
+                }
+            }
+            if (index >= 0 && !writeRun(run, index)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ok = false;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < options.threads; t++) threads.emplace_back(work);
+    work();
+    for (auto& t : threads) t.join();
+
+    if (ok && (!pending.empty() || stats.runs == 0)) ok = writeRun(pending, stats.runs++);
+    ok = ok && mergeRuns(path, stats.runs);
+    for (int r = 0; r < stats.runs; r++) std::remove(runPath(path, r).c_str());
+    return ok;
+}
+
+bool PositionIndex::open(const std::string& path)
+{
+    close();
+    if (!_file.open(path)) return false;
+    if (_file.size() < kHeaderSize || std::memcmp(_file.data(), kMagic, 8) != 0) {
+        close();
+        return false;
+    }
+    _entries = readLittleEndian(_file.data() + 8, 8);
+    if (_entries > (_file.size() - kHeaderSize) / kEntrySize) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+uint64_t PositionIndex::keyAt(uint64_t index) const
+{
+    return readLittleEndian(_file.data() + kHeaderSize + index * kEntrySize, 8);
+}
+
+PositionEntry PositionIndex::entryAt(uint64_t index) const
+{
+    return readEntry(_file.data() + kHeaderSize + index * kEntrySize);
+}
+
+uint64_t PositionIndex::lowerBound(uint64_t key) const
+{
+    uint64_t low = 0, high = _entries;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (keyAt(mid) < key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+uint64_t PositionIndex::count(uint64_t key) const
+{
+    if (!isOpen()) return 0;
+    uint64_t first = lowerBound(key);
+    uint64_t last = key == UINT64_MAX ? _entries : lowerBound(key + 1);
+    return last - first;
+}
+
+std::vector<PositionEntry> PositionIndex::find(uint64_t key, size_t limit) const
+{
+    std::vector<PositionEntry> found;
+    if (!isOpen()) return found;
+    for (uint64_t i = lowerBound(key); i < _entries && found.size() < limit && keyAt(i) == key; i++) {
+        found.push_back(entryAt(i));
+    }
+    return found;
+}
+
+std::vector<ExplorerMove> PositionIndex::explore(const Position& pos) const
+{
+    std::vector<ExplorerMove> moves;
+    if (!isOpen()) return moves;
+    for (uint64_t i = lowerBound(pos.key()); i < _entries && keyAt(i) == pos.key(); i++) {
+        PositionEntry e = entryAt(i);
+        if (!e.next) continue;
+        auto it = std::find_if(moves.begin(), moves.end(), [&](const ExplorerMove& m) { return m.move == e.next; });
+        if (it == moves.end()) {
+            moves.push_back(ExplorerMove());
+            it = moves.end() - 1;
+            it->move = e.next;
+        }
+        it->games++;
+        if (e.result == kPgnWhiteWins) it->whiteWins++;
+        else if (e.result == kPgnDraw) it->draws++;
+        else if (e.result == kPgnBlackWins) it->blackWins++;
+    }
+    // a key collision could bring in moves from another position
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [&](const ExplorerMove& m) { return parseLan(pos, m.move.toUci()) != m.move; }),
+                moves.end());
+    std::sort(moves.begin(), moves.end(), [](const ExplorerMove& a, const ExplorerMove& b) { return a.games > b.games; });
+    return moves;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "GameArchive.h"
+#include "MappedFile.h"
+#include "Position.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// index from position keys to the games of a GameArchive that reached them
+//
+// one 16 byte entry per (game, ply), sorted by key so a lookup is a binary
+// search in the memory map:
+//   key (8), game (4), ply and result (2), move played next (2)
+// the result rides in the top two bits of the ply field (result + 1) and the
+// next move is Move::raw(), 0 at the end of a game, so the explorer can count
+// moves and results without touching the archive
+//
+// building is an external sort: entries are collected until the memory
+// budget is used, sorted and written as a run file, and the runs are merged
+// into the final index at the end
+//
+//   header   magic "CHPIDX01", entry count (8)
+//   entries  sorted by key, then game, then ply
+//
+
+struct PositionEntry
+{
+    uint64_t key = 0;
+    uint32_t game = 0;
+    uint16_t ply = 0;
+    int8_t   result = kPgnUnknown;
+    Move     next;
+};
+
+struct ExplorerMove
+{
+    Move     move;
+    uint64_t games = 0;
+    uint64_t whiteWins = 0;
+    uint64_t draws = 0;
+    uint64_t blackWins = 0;
+};
+
+struct IndexBuildOptions
+{
+    int maxPlies = 40;                      // 0 indexes every ply
+    size_t memoryBytes = size_t(512) << 20; // entries held before a run is written
+    int threads = 1;
+};
+
+struct IndexBuildStats
+{
+    uint64_t games = 0;
+    uint64_t entries = 0;
+    int runs = 0;
+};
+
+// false if the archive could not be read or a file could not be written
+bool buildPositionIndex(const GameArchive& archive, const std::string& path, const IndexBuildOptions& options,
+                        IndexBuildStats& stats);
+
+class PositionIndex
+{
+public:
+    bool open(const std::string& path);
+    void close() { _file.close(); _entries = 0; }
+    bool isOpen() const { return _file.isOpen(); }
+    uint64_t entries() const { return _entries; }
+
+    // number of (game, ply) entries with this key
+    uint64_t count(uint64_t key) const;
+    // up to limit entries with this key, in game order
+    std::vector<PositionEntry> find(uint64_t key, size_t limit = SIZE_MAX) const;
+    // moves played from the position with their results, most played first
+    std::vector<ExplorerMove> explore(const Position& pos) const;
+
+private:
+    uint64_t lowerBound(uint64_t key) const;
+    uint64_t keyAt(uint64_t index) const;
+    PositionEntry entryAt(uint64_t index) const;
+
+    MappedFile _file;
+    uint64_t _entries = 0;
+};
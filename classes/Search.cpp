@@ -0,0 +1,363 @@
+#include "Search.h"
+#include "Evaluate.h"
+#include "EvalParams.h"
+#include "Syzygy.h"
+#include "Tablebase.h"
+#include <algorithm>
+#include <cstring>
+
+// mate scores are stored relative to the node, not the root
+static int scoreToTT(int score, int ply)
+{
+    if (score >= kMateBound) return score + ply;
+    if (score <= -kMateBound) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+    if (score >= kMateBound) return score - ply;
+    if (score <= -kMateBound) return score + ply;
+    return score;
+}
+
+Search::Search(TranspositionTable& tt)
+    : _tt(tt), _stop(false), _abort(nullptr), _nodes(0), _rootDepth(0), _excludedCount(0), _tbExcludedCount(0)
+{
+    std::memset(_history, 0, sizeof(_history));
+    std::memset(_pvLength, 0, sizeof(_pvLength));
+}
+
+bool Search::shouldStop()
+{
+    // always finish depth 1 so there is a move to play
+    if (_rootDepth <= 1) return false;
+    if (_stop.load(std::memory_order_relaxed)) return true;
+    if (_abort && _abort->load(std::memory_order_relaxed)) {
+        _stop = true;
+    } else if (_limits.nodes && nodes() >= _limits.nodes) {
+        _stop = true;
+    } else if (_limits.timeMs && (nodes() & 1023) == 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start);
+        if (elapsed.count() >= _limits.timeMs) _stop = true;
+    }
+    return _stop.load(std::memory_order_relaxed);
+}
+
+SearchResult Search::think(Position& pos, const SearchLimits& limits)
+{
+    _limits = limits;
+    _start = std::chrono::steady_clock::now();
+    _stop = false;
+    _nodes.store(0, std::memory_order_relaxed);
+    _attackStats = AttackStats();
+    std::memset(_killers, 0, sizeof(_killers));
+    for (auto& side : _history) {
+        for (auto& from : side) {
+            for (int& h : from) h /= 8;
+        }
+    }
+    SearchResult result;
+    MoveList legal;
+    pos.generateLegalMoves(legal);
+    if (legal.empty()) {
+        result.score = pos.inCheck() ? -kMateScore : 0;
+        return result;
+    }
+    result.bestMove = legal[0];
+    _keys = _gameKeys;
+    _keys.reserve(_keys.size() + kMaxPly);
+
+    // in a Syzygy ending only the moves that keep the result with the shortest
+    // way to a zeroing move are searched, so the win gets converted
+    _tbExcludedCount = 0;
+    const SyzygyTablebases* syzygy = activeSyzygyTablebases();
+    std::vector<Move> tbMoves;
+    if (syzygy && popCount(pos.occupied()) <= syzygy->maxPieces() && syzygy->rankRootMoves(pos, tbMoves)) {
+        for (Move m : legal) {
+            if (std::find(tbMoves.begin(), tbMoves.end(), m) == tbMoves.end()) _excluded[_tbExcludedCount++] = m;
+        }
+        result.bestMove = tbMoves[0];
+    }
+
+    int maxDepth = std::clamp(limits.depth, 1, kMaxPly - 1);
+    int lineCount = std::clamp(limits.multiPv, 1, legal.size() - _tbExcludedCount);
+    std::vector<RootLine> lines;
+    for (_rootDepth = 1; _rootDepth <= maxDepth; _rootDepth++) {
+        // each further line is a full search with the better root moves taken out
+        lines.clear();
+        _excludedCount = _tbExcludedCount;
+        for (int i = 0; i < lineCount; i++) {
+            RootLine line;
+            line.score = negamax(pos, _rootDepth, -kInfinity, kInfinity, 0, false);
+            if (_stop.load(std::memory_order_relaxed) && _rootDepth > 1) break;
+            line.pv.assign(_pv[0], _pv[0] + _pvLength[0]);
+            if (line.pv.empty()) break;
+            _excluded[_excludedCount++] = line.pv[0];
+            lines.push_back(std::move(line));
+        }
+        _excludedCount = 0;
+        if (_stop.load(std::memory_order_relaxed) && _rootDepth > 1) break;
+
+        // a later line can outscore an earlier one when the tree changed in between
+        std::stable_sort(lines.begin(), lines.end(), [](const RootLine& a, const RootLine& b) { return a.score > b.score; });
+        result.score = lines[0].score;
+        result.depth = _rootDepth;
+        result.pv = lines[0].pv;
+        result.bestMove = result.pv[0];
+        result.lines = lines;
+        result.nodes = nodes();
+        if (_onIteration) _onIteration(result);
+
+        // a forced mate won't get any shorter by searching deeper
+        int score = result.score;
+        if (lineCount == 1 && std::abs(score) >= kMateBound && _rootDepth > 2 * (kMateScore - std::abs(score))) break;
+    }
+    result.nodes = nodes();
+    return result;
+}
+
+SearchResult Search::quiescence(Position& pos)
+{
+    _limits = SearchLimits();
+    _stop = false;
+    _nodes.store(0, std::memory_order_relaxed);
+    _attackStats = AttackStats();
+    _rootDepth = 1;
+
+    SearchResult result;
+    result.score = quiesce(pos, -kInfinity, kInfinity, 0);
+    result.pv.assign(_pv[0], _pv[0] + _pvLength[0]);
+    if (!result.pv.empty()) result.bestMove = result.pv[0];
+    result.nodes = nodes();
+    return result;
+}
+
+void Search::scoreMoves(const Position& pos, const MoveList& list, int* scores, Move ttMove, int ply) const
+{
+    for (int i = 0; i < list.size(); i++) {
+        Move m = list[i];
+        if (m == ttMove) {
+            scores[i] = 1000000;
+        } else if (m.isCapture()) {
+            // most valuable victim, least valuable attacker
+            int victim = m.flags() == kEnPassant ? Pawn : tagPiece(pos.pieceOn(m.to()));
+            int attacker = tagPiece(pos.pieceOn(m.from()));
+            scores[i] = 100000 + kPieceValueMg[victim] * 10 - kPieceValueMg[attacker] / 10;
+            if (m.isPromotion()) scores[i] += kPieceValueMg[m.promotionPiece()];
+        } else if (m.isPromotion()) {
+            scores[i] = 95000 + kPieceValueMg[m.promotionPiece()];
+        } else if (ply < kMaxPly && m == _killers[ply][0]) {
+            scores[i] = 90000;
+        } else if (ply < kMaxPly && m == _killers[ply][1]) {
+            scores[i] = 80000;
+        } else {
+            scores[i] = _history[pos.sideToMove()][m.from()][m.to()];
+        }
+    }
+}
+
+// selection sort one step at a time, most nodes cut off after a move or two
+static Move pickNext(MoveList& list, int* scores, int index)
+{
+    int best = index;
+    for (int i = index + 1; i < list.size(); i++) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    std::swap(list[index], list[best]);
+    std::swap(scores[index], scores[best]);
+    return list[index];
+}
+
+int Search::negamax(Position& pos, int depth, int alpha, int beta, int ply, bool allowNull)
+{
+    _pvLength[ply] = 0;
+    AttackInfo& attacks = _attacks[ply];
+    attacks.reset(pos, _attackStats);
+    bool inCheck = attacks.inCheck();
+    if (inCheck) depth++;
+    if (depth <= 0) return quiesce(pos, alpha, beta, ply);
+
+    countNode();
+    if (shouldStop()) return 0;
+    if (ply >= kMaxPly - 1) return evaluate(pos);
+    if (ply > 0 && pos.halfmoveClock() >= 100) return 0;
+    if (ply > 0 && (pos.insufficientMaterial() || _keys.isRepetition(pos.key(), pos.halfmoveClock(), ply))) return 0;
+
+    // if the side to move can go back to an earlier position it can hold the
+    // draw, so a bound below zero is not worth searching against
+    if (ply > 0 && alpha < 0 && _keys.hasUpcomingRepetition(pos, ply)) {
+        alpha = 0;
+        if (alpha >= beta) return alpha;
+    }
+
+    // with few enough pieces the endgame tables know the exact distance to mate
+    // (mates too long for kMaxPly come out just below kMateBound, still ordered)
+    const Tablebases* tables = activeTablebases();
+    TbProbe tb;
+    if (ply > 0 && tables && popCount(pos.occupied()) <= tables->maxPieces() && tables->probe(pos, tb)) {
+        if (tb.wdl == 0) return 0;
+        return tb.wdl > 0 ? kMateScore - ply - tb.dtm : -kMateScore + ply + tb.dtm;
+    }
+
+    // Syzygy tables only know won, drawn or lost, and only while the 50 move
+    // counter is zero; a win scores just below the mates so a real mate still wins
+    const SyzygyTablebases* syzygy = activeSyzygyTablebases();
+    int wdl;
+    if (ply > 0 && syzygy && pos.halfmoveClock() == 0 && popCount(pos.occupied()) <= syzygy->maxPieces() &&
+        syzygy->probeWdl(pos, wdl)) {
+        if (wdl == kSyzygyWin) return kMateBound - 1 - ply;
+        if (wdl == kSyzygyLoss) return -kMateBound + 1 + ply;
+        return 2 * wdl;
+    }
+
+    bool pvNode = beta - alpha > 1;
+    TTHit hit;
+    Move ttMove;
+    if (_tt.probe(pos.key(), hit)) {
+        ttMove = hit.move;
+        int ttScore = scoreFromTT(hit.score, ply);
+        if (!pvNode && ply > 0 && hit.depth >= depth &&
+            (hit.bound == kBoundExact ||
+             (hit.bound == kBoundLower && ttScore >= beta) ||
+             (hit.bound == kBoundUpper && ttScore <= alpha))) {
+            return ttScore;
+        }
+    }
+
+    // null move: if passing still beats beta, a real move will too
+    if (allowNull && !pvNode && !inCheck && depth >= 3 && std::abs(beta) < kMateBound &&
+        pos.hasNonPawnMaterial(pos.sideToMove()) && evaluate(pos) >= beta) {
+        UndoInfo undo;
+        _keys.pushNull(pos.key());
+        pos.makeNullMove(undo);
+        int score = -negamax(pos, depth - 3 - depth / 4, -beta, -beta + 1, ply + 1, false);
+        pos.unmakeNullMove(undo);
+        _keys.pop();
+        if (_stop.load(std::memory_order_relaxed)) return 0;
+        if (score >= beta) return score >= kMateBound ? beta : score;
+    }
+
+    MoveList list;
+    pos.generateMoves(list, false, attacks);
+    int scores[kMaxMoves];
+    scoreMoves(pos, list, scores, ttMove, ply);
+
+    int bestScore = -kInfinity;
+    Move bestMove;
+    int originalAlpha = alpha;
+    int played = 0;
+
+    for (int i = 0; i < list.size(); i++) {
+        Move m = pickNext(list, scores, i);
+        if (!attacks.isLegal(m)) continue;
+        if (ply == 0 && std::find(_excluded, _excluded + _excludedCount, m) != _excluded + _excludedCount) continue;
+
+        UndoInfo undo;
+        _keys.push(pos.key());
+        pos.makeMove(m, undo);
+        played++;
+
+        int score;
+        bool quiet = !m.isCapture() && !m.isPromotion();
+        if (played == 1) {
+            score = -negamax(pos, depth - 1, -beta, -alpha, ply + 1, true);
+        } else {
+            // late quiet moves get a reduced null-window look first
+            int reduction = (quiet && !inCheck && depth >= 3 && played > 4) ? 1 + (played > 12) : 0;
+            score = -negamax(pos, depth - 1 - reduction, -alpha - 1, -alpha, ply + 1, true);
+            if (score > alpha && reduction) {
+                score = -negamax(pos, depth - 1, -alpha - 1, -alpha, ply + 1, true);
+            }
+            if (score > alpha && score < beta) {
+                score = -negamax(pos, depth - 1, -beta, -alpha, ply + 1, true);
+            }
+        }
+        pos.unmakeMove(m, undo);
+        _keys.pop();
+
+        if (_stop.load(std::memory_order_relaxed)) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = m;
+            if (score > alpha) {
+                alpha = score;
+                _pv[ply][0] = m;
+                std::memcpy(&_pv[ply][1], _pv[ply + 1], _pvLength[ply + 1] * sizeof(Move));
+                _pvLength[ply] = _pvLength[ply + 1] + 1;
+            }
+        }
+        if (alpha >= beta) {
+            if (quiet) {
+                if (_killers[ply][0] != m) {
+                    _killers[ply][1] = _killers[ply][0];
+                    _killers[ply][0] = m;
+                }
+                _history[pos.sideToMove()][m.from()][m.to()] += depth * depth;
+            }
+            break;
+        }
+    }
+
+    if (played == 0) {
+        return inCheck ? -kMateScore + ply : 0;
+    }
+
+    // with root moves left out the root score is not the position's score
+    if (ply == 0 && _excludedCount) return bestScore;
+
+    Bound bound = bestScore >= beta ? kBoundLower : (bestScore > originalAlpha ? kBoundExact : kBoundUpper);
+    _tt.store(pos.key(), bestMove, scoreToTT(bestScore, ply), depth, bound);
+    return bestScore;
+}
+
+int Search::quiesce(Position& pos, int alpha, int beta, int ply)
+{
+    return pos.whiteToMove() ? quiesce<White>(pos, alpha, beta, ply) : quiesce<Black>(pos, alpha, beta, ply);
+}
+
+// captures only, so the side to move alternates strictly and can be a template argument
+template <int Us>
+int Search::quiesce(Position& pos, int alpha, int beta, int ply)
+{
+    countNode();
+    _pvLength[ply] = 0;
+    if (shouldStop()) return 0;
+    AttackInfo& attacks = _attacks[ply];
+    attacks.reset(pos, _attackStats);
+
+    int standPat = evaluate(pos);
+    if (ply >= kMaxPly - 1) return standPat;
+    if (standPat >= beta) return standPat;
+    if (standPat > alpha) alpha = standPat;
+
+    MoveList list;
+    pos.generateMoves<Us>(list, true, attacks);
+    int scores[kMaxMoves];
+    scoreMoves(pos, list, scores, Move::none(), kMaxPly);
+
+    int bestScore = standPat;
+    for (int i = 0; i < list.size(); i++) {
+        Move m = pickNext(list, scores, i);
+        if (!attacks.isLegal(m)) continue;
+
+        UndoInfo undo;
+        pos.makeMove<Us>(m, undo);
+        int score = -quiesce<Us ^ 1>(pos, -beta, -alpha, ply + 1);
+        pos.unmakeMove<Us>(m, undo);
+
+        if (_stop.load(std::memory_order_relaxed)) return 0;
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                _pv[ply][0] = m;
+                std::memcpy(&_pv[ply][1], _pv[ply + 1], _pvLength[ply + 1] * sizeof(Move));
+                _pvLength[ply] = _pvLength[ply + 1] + 1;
+            }
+        }
+        if (alpha >= beta) break;
+    }
+    return bestScore;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "AttackInfo.h"
+#include "KeyHistory.h"
+#include "Position.h"
+#include "TranspositionTable.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+//
+// alpha-beta searcher for the headless engine
+//
+// one Search per thread; several searches may share one TranspositionTable
+//
+
+constexpr int kMaxPly = 128;
+constexpr int kMateScore = 32000;
+constexpr int kInfinity = 32001;
+// scores beyond this are mate-in-n
+constexpr int kMateBound = kMateScore - kMaxPly;
+
+struct SearchLimits
+{
+    int      depth = kMaxPly - 1;
+    uint64_t nodes = 0;         // 0 = no node limit
+    int64_t  timeMs = 0;        // 0 = no time limit
+    int      multiPv = 1;       // number of best root moves to report
+};
+
+// one principal variation, score from the side to move
+struct RootLine
+{
+    int               score = 0;
+    std::vector<Move> pv;
+};
+
+struct SearchResult
+{
+    Move              bestMove;
+    int               score = 0;
+    int               depth = 0;
+    uint64_t          nodes = 0;
+    std::vector<Move> pv;
+    // all multiPv lines of the last completed iteration, best first
+    std::vector<RootLine> lines;
+};
+
+class Search
+{
+public:
+    explicit Search(TranspositionTable& tt);
+
+    SearchResult think(Position& pos, const SearchLimits& limits);
+    // captures-only search from the root, the pv leads to a quiet position
+    SearchResult quiescence(Position& pos);
+
+    // safe to call from another thread
+    void stop() { _stop.store(true, std::memory_order_relaxed); }
+    uint64_t nodes() const { return _nodes.load(std::memory_order_relaxed); }
+    // attack sets worked out and reused by the nodes of the last search
+    const AttackStats& attackStats() const { return _attackStats; }
+
+    // an external flag that stops this search too, e.g. shared by all threads of one go
+    // unlike stop(), think() never clears it, so it can be raised before the search starts
+    void setAbortFlag(const std::atomic<bool>* flag) { _abort = flag; }
+
+    // the positions the game went through before the one given to think(),
+    // for the repetition rules; empty by default
+    void setGameHistory(const KeyHistory& history) { _gameKeys = history; }
+
+    // called after every completed iteration of think()
+    void setIterationCallback(std::function<void(const SearchResult&)> callback) { _onIteration = std::move(callback); }
+
+private:
+    int negamax(Position& pos, int depth, int alpha, int beta, int ply, bool allowNull);
+    int quiesce(Position& pos, int alpha, int beta, int ply);
+    template <int Us> int quiesce(Position& pos, int alpha, int beta, int ply);
+    void scoreMoves(const Position& pos, const MoveList& list, int* scores, Move ttMove, int ply) const;
+    bool shouldStop();
+    void countNode() { _nodes.store(_nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    TranspositionTable& _tt;
+    SearchLimits _limits;
+    std::chrono::steady_clock::time_point _start;
+    std::atomic<bool> _stop;
+    const std::atomic<bool>* _abort;
+    // only this search writes it, the atomic is so other threads can read the count
+    std::atomic<uint64_t> _nodes;
+    int _rootDepth;
+    // root moves already reported at this depth, skipped when looking for the next pv
+    // the first _tbExcludedCount of them are the moves the Syzygy tables rule out
+    Move _excluded[256];
+    int _excludedCount;
+    int _tbExcludedCount;
+    std::function<void(const SearchResult&)> _onIteration;
+    KeyHistory _gameKeys;
+    KeyHistory _keys;           // _gameKeys plus the current search line
+
+    Move _killers[kMaxPly][2];
+    int _history[2][64][64];
+    Move _pv[kMaxPly][kMaxPly];
+    int _pvLength[kMaxPly];
+    AttackInfo _attacks[kMaxPly];
+    AttackStats _attackStats;
+};
@@ -0,0 +1,853 @@
+#include "Syzygy.h"
+#include "Attacks.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+
+//
+// the file layout and the index encoding follow the Syzygy generator: a
+// table is split by the file of the leading pawn (a-d) or not at all, each
+// part holds the pieces' order and grouping, then Huffman coded blocks of
+// "recursive pairing" symbols that expand into runs of values
+//
+
+static constexpr int kMaxPieces = 7;
+static constexpr uint8_t kWdlMagic[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+static constexpr uint8_t kDtzMagic[4] = { 0x71, 0xE8, 0x23, 0x5D };
+static constexpr const char* kPieceLetters = "PNBRQK";   // by ChessPiece - 1
+static constexpr int kMaxDtz = 1 << 18;
+
+// flags of a table part
+enum : uint8_t
+{
+    kFlagStm = 1,
+    kFlagMapped = 2,
+    kFlagWinPlies = 4,
+    kFlagLossPlies = 8,
+    kFlagWide = 16,
+    kFlagSingleValue = 128,
+};
+
+// Syzygy piece codes: ChessPiece, + 8 for black
+static int syzygyPiece(uint8_t tag) { return tagPiece(tag) | (tagColour(tag) == Black ? 8 : 0); }
+
+static uint16_t readLe16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t readLe32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint32_t readBe32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+static uint64_t readBe64(const uint8_t* p) { return ((uint64_t)readBe32(p) << 32) | readBe32(p + 4); }
+
+//
+// encoding tables
+//
+
+static int offA1H8(int sq) { return (sq >> 3) - (sq & 7); }
+static int flipFile(int sq) { return sq ^ 7; }
+
+struct EncodingTables
+{
+    int mapB1H1H7[64] = {};
+    int mapA1D1D4[64] = {};
+    int mapKK[10][64] = {};
+    uint64_t binomial[6][64] = {};
+    int mapPawns[64] = {};
+    int leadPawnIdx[6][64] = {};
+    int leadPawnsSize[6][4] = {};
+
+    EncodingTables()
+    {
+        int code = 0;
+        for (int sq = 0; sq < 64; sq++) {
+            if (offA1H8(sq) < 0) mapB1H1H7[sq] = code++;
+        }
+
+        std::vector<int> diagonal;
+        code = 0;
+        for (int sq = 0; sq <= 27; sq++) {
+            if (offA1H8(sq) < 0 && (sq & 7) <= 3) mapA1D1D4[sq] = code++;
+            else if (!offA1H8(sq) && (sq & 7) <= 3) diagonal.push_back(sq);
+        }
+        for (int sq : diagonal) mapA1D1D4[sq] = code++;
+
+        // the 462 king pairs with the first king in a1-d1-d4, the second not
+        // above the diagonal when the first is on it; both on it come last
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; idx++) {
+            for (int s1 = 0; s1 <= 27; s1++) {
+                if (mapA1D1D4[s1] != idx || (!idx && s1 != 1)) continue;
+                for (int s2 = 0; s2 < 64; s2++) {
+                    if ((Attacks::kKing[s1] | Attacks::squareBB(s1)) & Attacks::squareBB(s2)) continue;
+                    if (!offA1H8(s1) && offA1H8(s2) > 0) continue;
+                    if (!offA1H8(s1) && !offA1H8(s2)) bothOnDiagonal.emplace_back(idx, s2);
+                    else mapKK[idx][s2] = code++;
+                }
+            }
+        }
+        for (auto& p : bothOnDiagonal) mapKK[p.first][p.second] = code++;
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; n++) {
+            for (int k = 0; k < 6 && k <= n; k++) {
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+            }
+        }
+
+        // mapPawns runs a2-h7 from the edges inwards, so the leading pawn (the
+        // highest value) is the one nearest the edge, lowest rank first
+        int available = 47;
+        for (int leadPawns = 1; leadPawns <= 5; leadPawns++) {
+            for (int file = 0; file < 4; file++) {
+                int idx = 0;
+                for (int rank = 1; rank <= 6; rank++) {
+                    int sq = rank * 8 + file;
+                    if (leadPawns == 1) {
+                        mapPawns[sq] = available--;
+                        mapPawns[flipFile(sq)] = available--;
+                    }
+                    leadPawnIdx[leadPawns][sq] = idx;
+                    idx += (int)binomial[leadPawns - 1][mapPawns[sq]];
+                }
+                leadPawnsSize[leadPawns][file] = idx;
+            }
+        }
+    }
+};
+
+static const EncodingTables& encoding()
+{
+    static const EncodingTables tables;
+    return tables;
+}
+
+//
+// tables
+//
+
+struct PairsData
+{
+    uint8_t flags = 0;
+    uint64_t sizeofBlock = 0;
+    uint64_t span = 0;
+    uint32_t blocksNum = 0;
+    int maxSymLen = 0;
+    int minSymLen = 0;                  // the value itself for kFlagSingleValue
+    const uint8_t* lowestSym = nullptr; // 16 bit symbols
+    const uint8_t* btree = nullptr;     // 3 bytes per symbol: left and right child, 12 bits each
+    const uint8_t* blockLength = nullptr;
+    uint64_t blockLengthSize = 0;
+    const uint8_t* sparseIndex = nullptr; // 4 byte block, 2 byte offset
+    uint64_t sparseIndexSize = 0;
+    const uint8_t* data = nullptr;
+    std::vector<uint64_t> base64;
+    std::vector<uint8_t> symlen;        // values a symbol expands to, - 1
+    int pieces[kMaxPieces] = {};
+    uint64_t groupIdx[kMaxPieces + 1] = {};
+    int groupLen[kMaxPieces + 1] = {};
+    uint16_t mapIdx[4] = {};            // dtz: where the values of each result start in the map
+
+    int left(int sym) const { const uint8_t* lr = btree + 3 * sym; return ((lr[1] & 0xF) << 8) | lr[0]; }
+    int right(int sym) const { const uint8_t* lr = btree + 3 * sym; return (lr[2] << 4) | (lr[1] >> 4); }
+};
+
+struct SyzygyFile
+{
+    std::atomic<bool> ready{ false };
+    MappedFile file;
+    const uint8_t* map = nullptr;       // dtz value map
+    PairsData items[2][4];              // [side to move, one side for dtz][leading pawn file or 0]
+};
+
+struct SyzygyTable
+{
+    std::string name;
+    uint64_t key = 0;                   // signature with the first side of the name as white
+    uint64_t key2 = 0;                  // and as black
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;
+    uint8_t pawnCount[2] = {};          // leading colour, other colour
+    SyzygyFile wdl;
+    SyzygyFile dtz;
+};
+
+// piece counts packed 4 bits each, white's pawns .. queens then black's
+static uint64_t signature(const Position& pos, bool flipColours)
+{
+    uint64_t sig = 0;
+    for (int colour = White; colour <= Black; colour++) {
+        for (int piece = Pawn; piece <= Queen; piece++) {
+            int slot = (colour ^ (int)flipColours) * 5 + piece - 1;
+            sig |= (uint64_t)popCount(pos.pieces(colour, (ChessPiece)piece)) << (4 * slot);
+        }
+    }
+    return sig;
+}
+
+// piece counts per colour from a name like "KRPvKR", false if it is not one
+static bool parseName(const std::string& name, int counts[2][7])
+{
+    std::memset(counts, 0, sizeof(int) * 14);
+    size_t v = name.find('v');
+    if (v == std::string::npos || name.find('v', v + 1) != std::string::npos) return false;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (i == v) continue;
+        const char* p = std::strchr(kPieceLetters, name[i]);
+        if (!p || !name[i]) return false;
+        counts[i < v ? White : Black][p - kPieceLetters + 1]++;
+    }
+    return counts[White][King] == 1 && counts[Black][King] == 1;
+}
+
+static uint64_t countsSignature(const int counts[2][7], bool flipColours)
+{
+    uint64_t sig = 0;
+    for (int colour = White; colour <= Black; colour++) {
+        for (int piece = Pawn; piece <= Queen; piece++) {
+            sig |= (uint64_t)counts[colour][piece] << (4 * ((colour ^ (int)flipColours) * 5 + piece - 1));
+        }
+    }
+    return sig;
+}
+
+static int setSymlen(PairsData& d, int sym, std::vector<bool>& visited)
+{
+    visited[sym] = true;
+    int sr = d.right(sym);
+    if (sr == 0xFFF) return 0;
+    int sl = d.left(sym);
+    if (!visited[sl]) d.symlen[sl] = (uint8_t)setSymlen(d, sl, visited);
+    if (!visited[sr]) d.symlen[sr] = (uint8_t)setSymlen(d, sr, visited);
+    return d.symlen[sl] + d.symlen[sr] + 1;
+}
+
+// groupLen holds the size of each group of pieces encoded together, groupIdx
+// the multiplier of each group in the index, in the order the file gives.
+// without pawns the first group is the leading three pieces (or the two
+// kings), so KRvKN is (3, 1); after that equal pieces share a group
+static void setGroups(const SyzygyTable& e, PairsData& d, const int order[2], int file)
+{
+    const EncodingTables& enc = encoding();
+    int n = 0, firstLen = e.hasPawns ? 0 : e.hasUniquePieces ? 3 : 2;
+    d.groupLen[n] = 1;
+    for (int i = 1; i < e.pieceCount; i++) {
+        if (--firstLen > 0 || d.pieces[i] == d.pieces[i - 1]) d.groupLen[n]++;
+        else d.groupLen[++n] = 1;
+    }
+    d.groupLen[++n] = 0;
+
+    bool pp = e.hasPawns && e.pawnCount[1];
+    int next = pp ? 2 : 1;
+    int freeSquares = 64 - d.groupLen[0] - (pp ? d.groupLen[1] : 0);
+    uint64_t idx = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            d.groupIdx[0] = idx;
+            idx *= e.hasPawns ? (uint64_t)enc.leadPawnsSize[d.groupLen[0]][file] : e.hasUniquePieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            d.groupIdx[1] = idx;
+            idx *= enc.binomial[d.groupLen[1]][48 - d.groupLen[0]];
+        } else {
+            d.groupIdx[next] = idx;
+            idx *= enc.binomial[d.groupLen[next]][freeSquares];
+            freeSquares -= d.groupLen[next++];
+        }
+    }
+    d.groupIdx[n] = idx;
+}
+
+static const uint8_t* setSizes(PairsData& d, const uint8_t* data)
+{
+    d.flags = *data++;
+    if (d.flags & kFlagSingleValue) {
+        d.blocksNum = 0;
+        d.blockLengthSize = 0;
+        d.span = 0;
+        d.sparseIndexSize = 0;
+        d.minSymLen = *data++;
+        return data;
+    }
+
+    int groups = 0;
+    while (d.groupLen[groups]) groups++;
+    uint64_t tbSize = d.groupIdx[groups];
+
+    d.sizeofBlock = 1ULL << *data++;
+    d.span = 1ULL << *data++;
+    d.sparseIndexSize = (tbSize + d.span - 1) / d.span;
+    uint8_t padding = *data++;
+    d.blocksNum = readLe32(data);
+    data += 4;
+    d.blockLengthSize = (uint64_t)d.blocksNum + padding;
+    d.maxSymLen = *data++;
+    d.minSymLen = *data++;
+    d.lowestSym = data;
+    d.base64.assign((size_t)(d.maxSymLen - d.minSymLen + 1), 0);
+
+    // canonical Huffman code: longer codes have lower values, so base64[len]
+    // (left aligned to 64 bits) decreases with the length
+    for (int i = (int)d.base64.size() - 2; i >= 0; i--) {
+        d.base64[i] = (d.base64[i + 1] + readLe16(d.lowestSym + 2 * i) - readLe16(d.lowestSym + 2 * (i + 1))) / 2;
+    }
+    for (size_t i = 0; i < d.base64.size(); i++) d.base64[i] <<= 64 - i - d.minSymLen;
+
+    data += d.base64.size() * 2;
+    d.symlen.assign(readLe16(data), 0);
+    data += 2;
+    d.btree = data;
+
+    std::vector<bool> visited(d.symlen.size());
+    for (size_t sym = 0; sym < d.symlen.size(); sym++) {
+        if (!visited[sym]) d.symlen[sym] = (uint8_t)setSymlen(d, (int)sym, visited);
+    }
+    return data + d.symlen.size() * 3 + (d.symlen.size() & 1);
+}
+
+static const uint8_t* setDtzMap(SyzygyTable& e, const uint8_t* data, int maxFile)
+{
+    e.dtz.map = data;
+    for (int f = 0; f <= maxFile; f++) {
+        PairsData& d = e.dtz.items[0][f];
+        if (!(d.flags & kFlagMapped)) continue;
+        if (d.flags & kFlagWide) {
+            data += (uintptr_t)data & 1;
+            for (int i = 0; i < 4; i++) {
+                d.mapIdx[i] = (uint16_t)((data - e.dtz.map) / 2 + 1);
+                data += 2 * readLe16(data) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; i++) {
+                d.mapIdx[i] = (uint16_t)(data - e.dtz.map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+    return data + ((uintptr_t)data & 1);
+}
+
+// reads the layout of a freshly mapped file
+static void setup(SyzygyTable& e, SyzygyFile& f, bool isDtz)
+{
+    const uint8_t* data = f.file.data() + 4;
+    data++;     // split and pawn flags, already known from the name
+
+    int sides = !isDtz && e.key != e.key2 ? 2 : 1;
+    int maxFile = e.hasPawns ? 3 : 0;
+    bool pp = e.hasPawns && e.pawnCount[1];
+
+    for (int file = 0; file <= maxFile; file++) {
+        for (int i = 0; i < sides; i++) f.items[i][file] = PairsData();
+        int order[2][2] = { { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+                            { *data >> 4, pp ? *(data + 1) >> 4 : 0xF } };
+        data += 1 + pp;
+        for (int k = 0; k < e.pieceCount; k++, data++) {
+            for (int i = 0; i < sides; i++) f.items[i][file].pieces[k] = i ? *data >> 4 : *data & 0xF;
+        }
+        for (int i = 0; i < sides; i++) setGroups(e, f.items[i][file], order[i], file);
+    }
+    data += (uintptr_t)data & 1;
+
+    for (int file = 0; file <= maxFile; file++) {
+        for (int i = 0; i < sides; i++) data = setSizes(f.items[i][file], data);
+    }
+    if (isDtz) data = setDtzMap(e, data, maxFile);
+
+    for (int file = 0; file <= maxFile; file++) {
+        for (int i = 0; i < sides; i++) {
+            f.items[i][file].sparseIndex = data;
+            data += f.items[i][file].sparseIndexSize * 6;
+        }
+    }
+    for (int file = 0; file <= maxFile; file++) {
+        for (int i = 0; i < sides; i++) {
+            f.items[i][file].blockLength = data;
+            data += f.items[i][file].blockLengthSize * 2;
+        }
+    }
+    for (int file = 0; file <= maxFile; file++) {
+        for (int i = 0; i < sides; i++) {
+            data = (const uint8_t*)(((uintptr_t)data + 0x3F) & ~(uintptr_t)0x3F);
+            f.items[i][file].data = data;
+            data += (uint64_t)f.items[i][file].blocksNum * f.items[i][file].sizeofBlock;
+        }
+    }
+}
+
+// the value stored at idx
+static int decompressPairs(const PairsData& d, uint64_t idx)
+{
+    if (d.flags & kFlagSingleValue) return d.minSymLen;
+
+    // the sparse index points into the block list every span values, from
+    // there walk the block lengths to the block holding idx
+    uint32_t k = (uint32_t)(idx / d.span);
+    uint32_t block = readLe32(d.sparseIndex + 6 * k);
+    int offset = readLe16(d.sparseIndex + 6 * k + 4);
+    offset += (int)(idx % d.span) - (int)(d.span / 2);
+    while (offset < 0) offset += readLe16(d.blockLength + 2 * --block) + 1;
+    while (offset > readLe16(d.blockLength + 2 * block)) offset -= readLe16(d.blockLength + 2 * block++) + 1;
+
+    const uint8_t* ptr = d.data + (uint64_t)block * d.sizeofBlock;
+    uint64_t buf64 = readBe64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+    for (;;) {
+        int len = 0;
+        while (buf64 < d.base64[len]) len++;
+        sym = (int)((buf64 - d.base64[len]) >> (64 - len - d.minSymLen));
+        sym += readLe16(d.lowestSym + 2 * len);
+        if (offset < d.symlen[sym] + 1) break;
+        offset -= d.symlen[sym] + 1;
+        len += d.minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32) {
+            buf64Size += 32;
+            buf64 |= (uint64_t)readBe32(ptr) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // the symbol stands for a run of values, descend its pairs to the one we want
+    while (d.symlen[sym]) {
+        int left = d.left(sym);
+        if (offset < d.symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d.symlen[left] + 1;
+            sym = d.right(sym);
+        }
+    }
+    return d.left(sym);
+}
+
+//
+// probing
+//
+
+enum ProbeState
+{
+    kProbeFail = 0,
+    kProbeOk = 1,
+    kProbeChangeStm = -1,       // dtz only stores the other side to move
+    kProbeZeroingBestMove = 2,  // the best move zeroes the 50 move counter
+};
+
+static int dtzBeforeZeroing(int wdl)
+{
+    return wdl == kSyzygyWin ? 1 : wdl == kSyzygyCursedWin ? 101 : wdl == kSyzygyBlessedLoss ? -101 : wdl == kSyzygyLoss ? -1 : 0;
+}
+
+static int signOf(int v) { return (v > 0) - (v < 0); }
+
+static bool pawnsBefore(int a, int b) { return encoding().mapPawns[a] < encoding().mapPawns[b]; }
+
+static int mapDtzScore(const SyzygyTable& e, int file, int value, int wdl)
+{
+    static constexpr int kWdlMap[] = { 1, 3, 0, 2, 0 };
+    const PairsData& d = e.dtz.items[0][file];
+    if (d.flags & kFlagMapped) {
+        int at = d.mapIdx[kWdlMap[wdl + 2]] + value;
+        value = (d.flags & kFlagWide) ? readLe16(e.dtz.map + 2 * at) : e.dtz.map[at];
+    }
+    // stored in moves unless the flags say plies
+    if ((wdl == kSyzygyWin && !(d.flags & kFlagWinPlies)) || (wdl == kSyzygyLoss && !(d.flags & kFlagLossPlies)) ||
+        wdl == kSyzygyCursedWin || wdl == kSyzygyBlessedLoss) {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+// the stored value of a position, wdl - 2 for a WDL table, DTZ (given the wdl) for a DTZ table
+static int probeTable(const Position& pos, SyzygyTable& e, bool isDtz, int wdl, ProbeState& state)
+{
+    const EncodingTables& enc = encoding();
+    SyzygyFile& f = isDtz ? e.dtz : e.wdl;
+    int squares[kMaxPieces];
+    int pieces[kMaxPieces];
+    int size = 0, leadPawnsCount = 0;
+    uint64_t leadPawns = 0;
+    int tbFile = 0;
+
+    // tables are stored with the stronger side as white, and symmetric ones
+    // with white to move only
+    bool symmetricBlackToMove = e.key == e.key2 && pos.sideToMove() == Black;
+    bool blackStronger = signature(pos, false) != e.key;
+    bool flip = symmetricBlackToMove || blackStronger;
+    int flipColour = flip ? 8 : 0;
+    int flipSquares = flip ? 56 : 0;
+    int stm = (int)flip ^ pos.sideToMove();
+
+    if (e.hasPawns) {
+        int pc = f.items[0][0].pieces[0] ^ flipColour;
+        leadPawns = pos.pieces(pc >> 3 ? Black : White, Pawn);
+        for (uint64_t b = leadPawns; b;) squares[size++] = popLsb(b) ^ flipSquares;
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsBefore));
+        tbFile = std::min(squares[0] & 7, 7 - (squares[0] & 7));
+    }
+
+    if (isDtz) {
+        uint8_t flags = e.dtz.items[0][tbFile].flags;
+        if ((flags & kFlagStm) != stm && !(e.key == e.key2 && !e.hasPawns)) {
+            state = kProbeChangeStm;
+            return 0;
+        }
+    }
+
+    for (uint64_t b = pos.occupied() ^ leadPawns; b;) {
+        int sq = popLsb(b);
+        squares[size] = sq ^ flipSquares;
+        pieces[size++] = syzygyPiece(pos.pieceOn(sq)) ^ flipColour;
+    }
+
+    const PairsData& d = f.items[isDtz ? 0 : stm][e.hasPawns ? tbFile : 0];
+
+    // put the pieces in the order the table lists them
+    for (int i = leadPawnsCount; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (d.pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // the leading piece goes to files a-d
+    if ((squares[0] & 7) > 3) {
+        for (int i = 0; i < size; i++) squares[i] = flipFile(squares[i]);
+    }
+
+    uint64_t idx;
+    if (e.hasPawns) {
+        idx = (uint64_t)enc.leadPawnIdx[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsBefore);
+        for (int i = 1; i < leadPawnsCount; i++) idx += enc.binomial[i][enc.mapPawns[squares[i]]];
+    } else {
+        // then to ranks 1-4, then below the a1-h8 diagonal
+        if ((squares[0] >> 3) > 3) {
+            for (int i = 0; i < size; i++) squares[i] ^= 56;
+        }
+        for (int i = 0; i < d.groupLen[0]; i++) {
+            if (!offA1H8(squares[i])) continue;
+            if (offA1H8(squares[i]) > 0) {
+                for (int j = i; j < size; j++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (e.hasUniquePieces) {
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offA1H8(squares[0])) {
+                idx = ((uint64_t)enc.mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            } else if (offA1H8(squares[1])) {
+                idx = (6 * 63 + (uint64_t)(squares[0] >> 3) * 28 + enc.mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            } else if (offA1H8(squares[2])) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + (uint64_t)(squares[0] >> 3) * 7 * 28 +
+                      (uint64_t)((squares[1] >> 3) - adjust1) * 28 + enc.mapB1H1H7[squares[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (uint64_t)(squares[0] >> 3) * 7 * 6 +
+                      (uint64_t)((squares[1] >> 3) - adjust1) * 6 + ((squares[2] >> 3) - adjust2);
+            }
+        } else {
+            idx = (uint64_t)enc.mapKK[enc.mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // the other groups: squares in ascending order, each counted down past
+    // the squares of the groups before it
+    idx *= d.groupIdx[0];
+    int* groupSq = squares + d.groupLen[0];
+    bool remainingPawns = e.hasPawns && e.pawnCount[1];
+    for (int next = 1; d.groupLen[next]; next++) {
+        std::stable_sort(groupSq, groupSq + d.groupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < d.groupLen[next]; i++) {
+            int adjust = (int)std::count_if(squares, groupSq, [&](int s) { return groupSq[i] > s; });
+            n += enc.binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d.groupIdx[next];
+        groupSq += d.groupLen[next];
+    }
+
+    int value = decompressPairs(d, idx);
+    return isDtz ? mapDtzScore(e, tbFile, value, wdl) : value - 2;
+}
+
+struct SyzygyProbe
+{
+    const SyzygyTablebases& tables;
+
+    int table(const Position& pos, bool isDtz, ProbeState& state, int wdl = kSyzygyDraw)
+    {
+        if (popCount(pos.occupied()) == 2) return kSyzygyDraw;
+        SyzygyTable* e = tables.find(signature(pos, false));
+        if (!e || !tables.map(*e) || (isDtz && !e->dtz.file.isOpen())) {
+            state = kProbeFail;
+            return 0;
+        }
+        return probeTable(pos, *e, isDtz, wdl, state);
+    }
+
+    // the tables know nothing of en passant and store "don't care" values
+    // where a capture is best, so captures (and pawn moves, for dtz) are
+    // searched first and the table only decides the rest
+    int search(Position& pos, bool checkZeroingMoves, ProbeState& state)
+    {
+        int bestValue = kSyzygyLoss;
+        MoveList moves;
+        pos.generateLegalMoves(moves);
+        int moveCount = 0;
+        for (Move m : moves) {
+            if (!m.isCapture() && (!checkZeroingMoves || tagPiece(pos.pieceOn(m.from())) != Pawn)) continue;
+            moveCount++;
+            UndoInfo undo;
+            pos.makeMove(m, undo);
+            int value = -search(pos, false, state);
+            pos.unmakeMove(m, undo);
+            if (state == kProbeFail) return kSyzygyDraw;
+            if (value > bestValue) {
+                bestValue = value;
+                if (value >= kSyzygyWin) {
+                    state = kProbeZeroingBestMove;
+                    return value;
+                }
+            }
+        }
+
+        bool noMoreMoves = moveCount && moveCount == moves.size();
+        int value;
+        if (noMoreMoves) {
+            value = bestValue;
+        } else {
+            value = table(pos, false, state);
+            if (state == kProbeFail) return kSyzygyDraw;
+        }
+        if (bestValue >= value) {
+            state = bestValue > kSyzygyDraw || noMoreMoves ? kProbeZeroingBestMove : kProbeOk;
+            return bestValue;
+        }
+        state = kProbeOk;
+        return value;
+    }
+
+    int wdl(Position& pos, ProbeState& state)
+    {
+        state = kProbeOk;
+        return search(pos, false, state);
+    }
+
+    int dtz(Position& pos, ProbeState& state)
+    {
+        state = kProbeOk;
+        int wdlValue = search(pos, true, state);
+        if (state == kProbeFail || wdlValue == kSyzygyDraw) return 0;
+        if (state == kProbeZeroingBestMove) return dtzBeforeZeroing(wdlValue);
+
+        int value = table(pos, true, state, wdlValue);
+        if (state == kProbeFail) return 0;
+        if (state != kProbeChangeStm) {
+            return (value + 100 * (wdlValue == kSyzygyBlessedLoss || wdlValue == kSyzygyCursedWin)) * signOf(wdlValue);
+        }
+
+        // the table has the other side to move: one ply of search for the
+        // best dtz among the moves that keep the result
+        int minDtz = 0xFFFF;
+        MoveList moves;
+        pos.generateLegalMoves(moves);
+        for (Move m : moves) {
+            bool zeroing = m.isCapture() || tagPiece(pos.pieceOn(m.from())) == Pawn;
+            UndoInfo undo;
+            pos.makeMove(m, undo);
+            int moveDtz = zeroing ? -dtzBeforeZeroing(search(pos, false, state)) : -dtz(pos, state);
+            if (moveDtz == 1 && pos.inCheck() && !hasLegalMove(pos)) minDtz = 1;
+            if (!zeroing) moveDtz += signOf(moveDtz);
+            if (moveDtz < minDtz && signOf(moveDtz) == signOf(wdlValue)) minDtz = moveDtz;
+            pos.unmakeMove(m, undo);
+            if (state == kProbeFail) return 0;
+        }
+        return minDtz == 0xFFFF ? -1 : minDtz;
+    }
+
+    static bool hasLegalMove(const Position& pos)
+    {
+        MoveList moves;
+        pos.generateLegalMoves(moves);
+        return !moves.empty();
+    }
+};
+
+//
+// SyzygyTablebases
+//
+
+SyzygyTablebases::SyzygyTablebases() = default;
+SyzygyTablebases::~SyzygyTablebases() = default;
+
+void SyzygyTablebases::close()
+{
+    _bySignature.clear();
+    _tables.clear();
+    _directories.clear();
+    _maxPieces = 0;
+}
+
+int SyzygyTablebases::open(const std::string& paths)
+{
+    close();
+#if defined(_WIN32)
+    const char separator = ';';
+#else
+    const char separator = ':';
+#endif
+    size_t start = 0;
+    while (start <= paths.size()) {
+        size_t end = paths.find(separator, start);
+        if (end == std::string::npos) end = paths.size();
+        if (end > start) _directories.push_back(paths.substr(start, end - start));
+        start = end + 1;
+    }
+
+    for (const std::string& directory : _directories) {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            if (entry.path().extension() != ".rtbw") continue;
+            std::string name = entry.path().stem().string();
+            int counts[2][7];
+            if (!parseName(name, counts)) continue;
+            uint64_t key = countsSignature(counts, false);
+            if (_bySignature.count(key)) continue;
+
+            auto table = std::make_unique<SyzygyTable>();
+            table->name = name;
+            table->key = key;
+            table->key2 = countsSignature(counts, true);
+            for (int colour = White; colour <= Black; colour++) {
+                for (int piece = Pawn; piece <= King; piece++) {
+                    table->pieceCount += counts[colour][piece];
+                    if (piece != King && counts[colour][piece] == 1) table->hasUniquePieces = true;
+                }
+            }
+            if (table->pieceCount > kMaxPieces) continue;
+            table->hasPawns = counts[White][Pawn] + counts[Black][Pawn] > 0;
+            // the leading colour is the one with fewer pawns, but at least one
+            bool whiteLeads = !counts[Black][Pawn] || (counts[White][Pawn] && counts[Black][Pawn] >= counts[White][Pawn]);
+            table->pawnCount[0] = (uint8_t)counts[whiteLeads ? White : Black][Pawn];
+            table->pawnCount[1] = (uint8_t)counts[whiteLeads ? Black : White][Pawn];
+
+            _maxPieces = std::max(_maxPieces, table->pieceCount);
+            _bySignature[table->key] = table.get();
+            _bySignature[table->key2] = table.get();
+            _tables.push_back(std::move(table));
+        }
+    }
+    return (int)_tables.size();
+}
+
+SyzygyTable* SyzygyTablebases::find(uint64_t signature) const
+{
+    auto it = _bySignature.find(signature);
+    return it == _bySignature.end() ? nullptr : it->second;
+}
+
+// maps the WDL and DTZ files the first time the table is used
+bool SyzygyTablebases::map(SyzygyTable& table) const
+{
+    if (table.wdl.ready.load(std::memory_order_acquire)) return table.wdl.file.isOpen();
+
+    std::lock_guard<std::mutex> lock(_mapMutex);
+    if (table.wdl.ready.load(std::memory_order_relaxed)) return table.wdl.file.isOpen();
+
+    auto mapFile = [&](SyzygyFile& f, const char* extension, const uint8_t (&magic)[4], bool isDtz) {
+        for (const std::string& directory : _directories) {
+            std::string path = (std::filesystem::path(directory) / (table.name + extension)).string();
+            if (!f.file.open(path)) continue;
+            if (f.file.size() % 64 == 16 && std::memcmp(f.file.data(), magic, 4) == 0) {
+                setup(table, f, isDtz);
+                return;
+            }
+            f.file.close();
+        }
+    };
+    mapFile(table.wdl, ".rtbw", kWdlMagic, false);
+    mapFile(table.dtz, ".rtbz", kDtzMagic, true);
+    table.dtz.ready.store(true, std::memory_order_release);
+    table.wdl.ready.store(true, std::memory_order_release);
+    return table.wdl.file.isOpen();
+}
+
+bool SyzygyTablebases::probeWdl(const Position& pos, int& wdl) const
+{
+    if (pos.castling() || popCount(pos.occupied()) > _maxPieces) return false;
+    Position copy = pos;
+    ProbeState state;
+    wdl = SyzygyProbe{ *this }.wdl(copy, state);
+    return state != kProbeFail;
+}
+
+bool SyzygyTablebases::probeDtz(const Position& pos, int& dtz) const
+{
+    if (pos.castling() || popCount(pos.occupied()) > _maxPieces) return false;
+    Position copy = pos;
+    ProbeState state;
+    dtz = SyzygyProbe{ *this }.dtz(copy, state);
+    return state != kProbeFail;
+}
+
+bool SyzygyTablebases::rankRootMoves(const Position& pos, std::vector<Move>& best) const
+{
+    best.clear();
+    if (pos.castling() || popCount(pos.occupied()) > _maxPieces) return false;
+
+    SyzygyProbe probe{ *this };
+    Position copy = pos;
+    MoveList moves;
+    copy.generateLegalMoves(moves);
+    int cnt50 = pos.halfmoveClock();
+    std::vector<int> ranks;
+    for (Move m : moves) {
+        UndoInfo undo;
+        copy.makeMove(m, undo);
+        ProbeState state = kProbeOk;
+        int dtz;
+        if (copy.halfmoveClock() == 0) {
+            dtz = dtzBeforeZeroing(-probe.wdl(copy, state));
+        } else {
+            dtz = -probe.dtz(copy, state);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+        if (copy.inCheck() && dtz == 2 && !SyzygyProbe::hasLegalMove(copy)) dtz = 1;
+        copy.unmakeMove(m, undo);
+        if (state == kProbeFail) return false;
+
+        // wins inside the 50 move rule rank by dtz, the rest by how close the draw is
+        int rank = dtz > 0 ? (dtz + cnt50 <= 99 ? kMaxDtz - dtz : kMaxDtz / 2 - (dtz + cnt50))
+                 : dtz < 0 ? (-dtz * 2 + cnt50 < 100 ? -kMaxDtz - dtz : -kMaxDtz / 2 + (-dtz + cnt50))
+                 : 0;
+        ranks.push_back(rank);
+    }
+    if (ranks.empty()) return false;
+
+    int top = *std::max_element(ranks.begin(), ranks.end());
+    for (int i = 0; i < moves.size(); i++) {
+        if (ranks[i] == top) best.push_back(moves[i]);
+    }
+    return true;
+}
+
+static const SyzygyTablebases* s_syzygy = nullptr;
+
+void setSyzygyTablebases(const SyzygyTablebases* tables)
+{
+    s_syzygy = (tables && tables->maxPieces() > 0) ? tables : nullptr;
+}
+
+const SyzygyTablebases* activeSyzygyTablebases()
+{
+    return s_syzygy;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Position.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// probing of Syzygy endgame tables, the standard .rtbw (win/draw/loss) and
+// .rtbz (distance to zeroing move) files of up to 7 pieces
+//
+// open() only lists the files; a table is memory mapped the first time a
+// position with its material is probed, so a 150 GB set costs nothing until
+// it is used. after open() the table list never changes and the mapping is
+// guarded per table, so any number of search threads can probe at once
+//
+// results are from the side to move's point of view and assume the 50 move
+// counter is zero: a cursed win is a win the 50 move rule turns into a
+// draw, a blessed loss the same for the losing side. the search probes WDL
+// right after captures and pawn moves, and the root ranks its moves by DTZ
+// so a won ending is actually converted
+//
+
+enum SyzygyWdl
+{
+    kSyzygyLoss = -2,
+    kSyzygyBlessedLoss = -1,
+    kSyzygyDraw = 0,
+    kSyzygyCursedWin = 1,
+    kSyzygyWin = 2,
+};
+
+struct SyzygyTable;
+
+class SyzygyTablebases
+{
+public:
+    SyzygyTablebases();
+    ~SyzygyTablebases();
+
+    // lists the tables in the directories (separated by ':', ';' on Windows),
+    // returns how many WDL tables there are
+    int open(const std::string& paths);
+    void close();
+    int maxPieces() const { return _maxPieces; }
+
+    // false when a table is missing or the position has castling rights
+    bool probeWdl(const Position& pos, int& wdl) const;
+    // plies to the next capture or pawn move with best play, positive when
+    // the side to move wins, 0 for a draw (mates count as a zeroing move)
+    bool probeDtz(const Position& pos, int& dtz) const;
+    // the legal moves that keep the best result with the shortest DTZ,
+    // taking the 50 move counter of the position into account
+    bool rankRootMoves(const Position& pos, std::vector<Move>& best) const;
+
+private:
+    friend struct SyzygyProbe;
+
+    SyzygyTable* find(uint64_t signature) const;
+    bool map(SyzygyTable& table) const;
+
+    std::vector<std::unique_ptr<SyzygyTable>> _tables;
+    std::unordered_map<uint64_t, SyzygyTable*> _bySignature;
+    std::vector<std::string> _directories;
+    mutable std::mutex _mapMutex;
+    int _maxPieces = 0;
+};
+
+// the tables the search probes, nullptr for none
+// only change this while no search is running
+void setSyzygyTablebases(const SyzygyTablebases* tables);
+const SyzygyTablebases* activeSyzygyTablebases();
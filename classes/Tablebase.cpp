@@ -0,0 +1,830 @@
+#include "Tablebase.h"
+#include "Lz.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+
+static constexpr char kMagic[8] = { 'C', 'H', 'T', 'B', 'D', 'T', 'M', '1' };
+static constexpr size_t kHeaderSize = 48;
+static constexpr size_t kNameSize = 16;
+static constexpr uint32_t kBlockValues = 4096;
+static constexpr const char* kPieceLetters = "QRBNP";
+
+static uint64_t readLittleEndian(const uint8_t* p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void writeLittleEndian(uint8_t* p, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+//
+// symmetry
+//
+// the 8 symmetries of the board: the mirrors are xor masks on the square,
+// the last four swap files and ranks first. with pawns only the first two apply
+//
+static constexpr int kAllSymmetries = 8;
+static constexpr int kPawnSymmetries = 2;
+
+static int transformSquare(int t, int sq)
+{
+    static constexpr int kMasks[4] = { 0, 7, 56, 63 };
+    if (t >= 4) sq = ((sq & 7) << 3) | (sq >> 3);
+    return sq ^ kMasks[t & 3];
+}
+
+struct KingPairs
+{
+    int16_t index[2][64 * 64];              // [pawns][white king * 64 + black king], -1 if not canonical
+    std::vector<uint16_t> pairs[2];         // white king * 64 + black king of each index
+};
+
+static const KingPairs& kingPairs()
+{
+    static const KingPairs table = [] {
+        KingPairs t;
+        for (int pawns = 0; pawns < 2; pawns++) {
+            int symmetries = pawns ? kPawnSymmetries : kAllSymmetries;
+            for (int code = 0; code < 64 * 64; code++) {
+                int wk = code >> 6, bk = code & 63;
+                t.index[pawns][code] = -1;
+                if (wk == bk || (Attacks::kKing[wk] & Attacks::squareBB(bk))) continue;
+                int best = code;
+                for (int s = 1; s < symmetries; s++) {
+                    best = std::min(best, transformSquare(s, wk) * 64 + transformSquare(s, bk));
+                }
+                if (best != code) continue;
+                t.index[pawns][code] = (int16_t)t.pairs[pawns].size();
+                t.pairs[pawns].push_back((uint16_t)code);
+            }
+        }
+        return t;
+    }();
+    return table;
+}
+
+//
+// material names
+//
+
+static int pieceRank(char c)
+{
+    const char* p = std::strchr(kPieceLetters, c);
+    return p && c ? (int)(p - kPieceLetters) : -1;
+}
+
+static ChessPiece letterPiece(char c)
+{
+    static constexpr ChessPiece kPieces[5] = { Queen, Rook, Bishop, Knight, Pawn };
+    return kPieces[pieceRank(c)];
+}
+
+// stronger first: more pieces, then the better pieces
+static bool strongerSide(const std::string& a, const std::string& b)
+{
+    if (a.size() != b.size()) return a.size() > b.size();
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i]) return pieceRank(a[i]) < pieceRank(b[i]);
+    }
+    return false;
+}
+
+static std::string sortPieces(std::string side)
+{
+    std::sort(side.begin(), side.end(), [](char a, char b) { return pieceRank(a) < pieceRank(b); });
+    return side;
+}
+
+// "KRvK" style name with the stronger side first, "" if it is not one
+static std::string canonicalName(const std::string& name)
+{
+    size_t v = name.find('v');
+    if (v == std::string::npos || v == 0 || v + 1 >= name.size()) return "";
+    std::string white = name.substr(0, v), black = name.substr(v + 1);
+    if (white[0] != 'K' || black[0] != 'K') return "";
+    white = white.substr(1);
+    black = black.substr(1);
+    for (char c : white + black) {
+        if (pieceRank(c) < 0) return "";
+    }
+    if (white.size() + black.size() + 2 > (size_t)kTbMaxPieces) return "";
+    // generation does not model en passant, so no pawns on both sides
+    if (white.find('P') != std::string::npos && black.find('P') != std::string::npos) return "";
+    white = sortPieces(white);
+    black = sortPieces(black);
+    if (strongerSide(black, white)) std::swap(white, black);
+    return "K" + white + "vK" + black;
+}
+
+// pieces of one side of the board as letters, strongest first
+static std::string sideLetters(const Position& pos, int colour)
+{
+    std::string side;
+    for (int i = 0; i < 5; i++) {
+        side.append((size_t)popCount(pos.pieces(colour, letterPiece(kPieceLetters[i]))), kPieceLetters[i]);
+    }
+    return side;
+}
+
+// material of the board with white first, not canonical
+static std::string boardName(const Position& pos)
+{
+    std::string name = "K";
+    name += sideLetters(pos, White);
+    name += "vK";
+    name += sideLetters(pos, Black);
+    return name;
+}
+
+// the same position with the colours swapped and the board upside down
+static void flipColours(const Position& pos, Position& flipped)
+{
+    uint8_t board[64] = {};
+    for (int sq = 0; sq < 64; sq++) {
+        uint8_t tag = pos.pieceOn(sq);
+        if (tag) board[sq ^ 56] = pieceTag(tagColour(tag) ^ 1, tagPiece(tag));
+    }
+    flipped.setBoard(board, !pos.whiteToMove(), 0, pos.epSquare() == kNoSquare ? -1 : pos.epSquare() ^ 56,
+                     pos.halfmoveClock());
+}
+
+std::string EndgameTable::materialName(const Position& pos)
+{
+    if (popCount(pos.occupied()) > kTbMaxPieces) return "";
+    return canonicalName(boardName(pos));
+}
+
+// 4 bits of count for each piece type of each colour
+static int materialShift(int colour, int piece)
+{
+    return 4 * (colour * 5 + piece - Pawn);
+}
+
+uint64_t EndgameTable::materialKey(const Position& pos)
+{
+    uint64_t key = 0;
+    for (int colour = White; colour <= Black; colour++) {
+        for (int piece = Pawn; piece <= Queen; piece++) {
+            key += (uint64_t)popCount(pos.pieces(colour, (ChessPiece)piece)) << materialShift(colour, piece);
+        }
+    }
+    return key;
+}
+
+uint64_t EndgameTable::materialKey(bool flipped) const
+{
+    uint64_t key = 0;
+    for (uint8_t tag : _pieces) key += 1ULL << materialShift(tagColour(tag) ^ (flipped ? 1 : 0), tagPiece(tag));
+    return key;
+}
+
+bool EndgameTable::setMaterial(const std::string& name)
+{
+    std::string canonical = canonicalName(name);
+    if (canonical.empty()) return false;
+    _name = canonical;
+    _pieces.clear();
+    size_t v = canonical.find('v');
+    for (size_t i = 1; i < canonical.size(); i++) {
+        if (i == v || i == v + 1) continue;
+        _pieces.push_back(pieceTag(i < v ? White : Black, letterPiece(canonical[i])));
+    }
+    _pawns = canonical.find('P') != std::string::npos;
+    _positions = kingPairs().pairs[_pawns].size();
+    for (size_t i = 0; i < _pieces.size(); i++) _positions *= 64;
+    return true;
+}
+
+//
+// indexing
+//
+
+uint64_t EndgameTable::index(const Position& pos) const
+{
+    int squares[kTbMaxPieces];
+    int count = 0;
+    squares[count++] = pos.kingSquare(White);
+    squares[count++] = pos.kingSquare(Black);
+    uint64_t left = 0;
+    for (size_t i = 0; i < _pieces.size(); i++) {
+        if (i == 0 || _pieces[i] != _pieces[i - 1]) left = pos.pieces(tagColour(_pieces[i]), tagPiece(_pieces[i]));
+        squares[count++] = left ? popLsb(left) : 0;
+    }
+
+    // the smallest image of the position under the symmetries, comparing the
+    // kings first and then the other pieces (equal pieces sorted)
+    int best[kTbMaxPieces];
+    int symmetries = _pawns ? kPawnSymmetries : kAllSymmetries;
+    for (int s = 0; s < symmetries; s++) {
+        int image[kTbMaxPieces];
+        for (int i = 0; i < count; i++) image[i] = transformSquare(s, squares[i]);
+        if (image[0] * 64 + image[1] > (s ? best[0] * 64 + best[1] : INT32_MAX)) continue;
+        for (int i = 2; i < count;) {
+            int j = i + 1;
+            while (j < count && _pieces[j - 2] == _pieces[i - 2]) j++;
+            for (int a = i + 1; a < j; a++) {
+                for (int b = a; b > i && image[b] < image[b - 1]; b--) std::swap(image[b], image[b - 1]);
+            }
+            i = j;
+        }
+        if (s == 0 || std::lexicographical_compare(image, image + count, best, best + count)) {
+            std::copy(image, image + count, best);
+        }
+    }
+
+    uint64_t index = (uint64_t)kingPairs().index[_pawns][best[0] * 64 + best[1]];
+    for (int i = 2; i < count; i++) index = index * 64 + (uint64_t)best[i];
+    return index;
+}
+
+bool EndgameTable::position(uint64_t index, int sideToMove, Position& pos) const
+{
+    if (index >= _positions) return false;
+    int squares[kTbMaxPieces];
+    int count = (int)_pieces.size();
+    for (int i = count - 1; i >= 0; i--) {
+        squares[i] = (int)(index & 63);
+        index >>= 6;
+    }
+    uint16_t kings = kingPairs().pairs[_pawns][index];
+
+    uint8_t board[64] = {};
+    board[kings >> 6] = pieceTag(White, King);
+    board[kings & 63] = pieceTag(Black, King);
+    for (int i = 0; i < count; i++) {
+        int sq = squares[i];
+        if (board[sq]) return false;
+        if (tagPiece(_pieces[i]) == Pawn && (sq < 8 || sq >= 56)) return false;
+        board[sq] = _pieces[i];
+    }
+    pos.setBoard(board, sideToMove == White, 0, -1);
+    // the side that just moved cannot be in check
+    return !pos.isAttacked(pos.kingSquare(sideToMove ^ 1), sideToMove);
+}
+
+//
+// table files
+//
+
+uint16_t EndgameTable::value(int sideToMove, uint64_t index) const
+{
+    uint64_t slot = (uint64_t)sideToMove * _positions + index;
+    return _values.empty() ? fileValue(slot) : _values[slot];
+}
+
+// one decompressed block per thread, enough for the search probing the
+// same few tables over and over
+uint16_t EndgameTable::fileValue(uint64_t slot) const
+{
+    struct BlockCache
+    {
+        uint64_t serial = 0;
+        uint32_t block = UINT32_MAX;
+        std::vector<uint8_t> raw;
+    };
+    thread_local BlockCache cache;
+
+    uint32_t block = (uint32_t)(slot / _blockValues);
+    const uint8_t* offsets = _file.data() + kHeaderSize;
+    if (cache.serial != _serial || cache.block != block) {
+        uint64_t begin = readLittleEndian(offsets + block * 8, 8);
+        uint64_t end = readLittleEndian(offsets + (block + 1) * 8, 8);
+        uint64_t values = std::min<uint64_t>(_blockValues, _positions * 2 - (uint64_t)block * _blockValues);
+        cache.raw.resize(values * 2);
+        cache.serial = 0;
+        if (!lzDecompress(_file.data() + begin, (size_t)(end - begin), cache.raw.data(), cache.raw.size())) return 0;
+        cache.serial = _serial;
+        cache.block = block;
+    }
+    return (uint16_t)readLittleEndian(cache.raw.data() + (slot % _blockValues) * 2, 2);
+}
+
+bool EndgameTable::readHeader()
+{
+    if (_file.size() < kHeaderSize || std::memcmp(_file.data(), kMagic, 8) != 0) return false;
+    char name[kNameSize + 1] = {};
+    std::memcpy(name, _file.data() + 8, kNameSize);
+    if (!setMaterial(name) || _name != name) return false;
+    if (readLittleEndian(_file.data() + 24, 8) != _positions) return false;
+    _blockValues = (uint32_t)readLittleEndian(_file.data() + 32, 4);
+    _blocks = (uint32_t)readLittleEndian(_file.data() + 36, 4);
+    _longestMate = (int)readLittleEndian(_file.data() + 40, 4);
+    if (_blockValues == 0 || _blocks != (_positions * 2 + _blockValues - 1) / _blockValues) return false;
+    if (_file.size() < kHeaderSize + ((size_t)_blocks + 1) * 8) return false;
+
+    const uint8_t* offsets = _file.data() + kHeaderSize;
+    for (uint32_t b = 0; b < _blocks; b++) {
+        uint64_t begin = readLittleEndian(offsets + b * 8, 8);
+        uint64_t end = readLittleEndian(offsets + (b + 1) * 8, 8);
+        if (begin > end || end > _file.size()) return false;
+    }
+    return true;
+}
+
+bool EndgameTable::open(const std::string& path)
+{
+    _values.clear();
+    if (!_file.open(path)) return false;
+    if (!readHeader()) {
+        _file.close();
+        return false;
+    }
+    static std::atomic<uint64_t> s_serial(0);
+    _serial = ++s_serial;
+    return true;
+}
+
+bool EndgameTable::load(const std::string& path)
+{
+    if (!open(path)) return false;
+    std::vector<uint16_t> values((size_t)_positions * 2);
+    std::vector<uint8_t> raw;
+    const uint8_t* offsets = _file.data() + kHeaderSize;
+    for (uint32_t b = 0; b < _blocks; b++) {
+        uint64_t begin = readLittleEndian(offsets + b * 8, 8);
+        uint64_t end = readLittleEndian(offsets + (b + 1) * 8, 8);
+        uint64_t first = (uint64_t)b * _blockValues;
+        raw.resize((size_t)std::min<uint64_t>(_blockValues, values.size() - first) * 2);
+        if (!lzDecompress(_file.data() + begin, (size_t)(end - begin), raw.data(), raw.size())) {
+            _file.close();
+            return false;
+        }
+        for (size_t i = 0; i < raw.size() / 2; i++) values[first + i] = (uint16_t)readLittleEndian(raw.data() + i * 2, 2);
+    }
+    _file.close();
+    _values = std::move(values);
+    return true;
+}
+
+bool EndgameTable::save(const std::string& path) const
+{
+    if (_values.empty()) return false;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    uint32_t blocks = (uint32_t)((_values.size() + kBlockValues - 1) / kBlockValues);
+    uint8_t header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, 8);
+    std::memcpy(header + 8, _name.data(), std::min(_name.size(), kNameSize));
+    writeLittleEndian(header + 24, _positions, 8);
+    writeLittleEndian(header + 32, kBlockValues, 4);
+    writeLittleEndian(header + 36, blocks, 4);
+    writeLittleEndian(header + 40, (uint64_t)_longestMate, 4);
+    out.write((const char*)header, kHeaderSize);
+
+    std::vector<uint8_t> offsets(((size_t)blocks + 1) * 8);
+    out.write((const char*)offsets.data(), (std::streamsize)offsets.size());
+    uint64_t offset = kHeaderSize + offsets.size();
+    std::vector<uint8_t> raw, packed;
+    for (uint32_t b = 0; b < blocks; b++) {
+        size_t first = (size_t)b * kBlockValues;
+        size_t count = std::min<size_t>(kBlockValues, _values.size() - first);
+        raw.resize(count * 2);
+        for (size_t i = 0; i < count; i++) writeLittleEndian(raw.data() + i * 2, _values[first + i], 2);
+        lzCompress(raw.data(), raw.size(), packed);
+        out.write((const char*)packed.data(), (std::streamsize)packed.size());
+        writeLittleEndian(offsets.data() + b * 8, offset, 8);
+        offset += packed.size();
+    }
+    writeLittleEndian(offsets.data() + (size_t)blocks * 8, offset, 8);
+    out.seekp(kHeaderSize);
+    out.write((const char*)offsets.data(), (std::streamsize)offsets.size());
+    return (bool)out;
+}
+
+//
+// probing
+//
+
+static TbProbe probeFromValue(uint16_t value)
+{
+    TbProbe result;
+    if (value) {
+        result.dtm = value - 1;
+        result.wdl = (result.dtm & 1) ? 1 : -1;
+    }
+    return result;
+}
+
+// what a move is worth to the side that plays it, given the probe of the position after it
+static TbProbe afterMove(const TbProbe& child)
+{
+    TbProbe result;
+    result.wdl = -child.wdl;
+    result.dtm = child.wdl ? child.dtm + 1 : 0;
+    return result;
+}
+
+static bool betterForMover(const TbProbe& a, const TbProbe& b)
+{
+    if (a.wdl != b.wdl) return a.wdl > b.wdl;
+    if (a.wdl > 0) return a.dtm < b.dtm;
+    return a.wdl < 0 && a.dtm > b.dtm;
+}
+
+int Tablebases::open(const std::string& directory)
+{
+    int opened = 0;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() != ".ctb") continue;
+        auto table = std::make_unique<EndgameTable>();
+        if (!table->open(entry.path().string())) continue;
+        add(std::move(table));
+        opened++;
+    }
+    return opened;
+}
+
+void Tablebases::add(std::unique_ptr<EndgameTable> table)
+{
+    _maxPieces = std::max(_maxPieces, table->pieceCount());
+    // the colour swapped material finds the table too, unless it is the same
+    _byMaterial[table->materialKey(true)] = { table.get(), true };
+    _byMaterial[table->materialKey(false)] = { table.get(), false };
+    std::string name = table->name();
+    _tables[name] = std::move(table);
+}
+
+const EndgameTable* Tablebases::find(const std::string& name) const
+{
+    auto it = _tables.find(name);
+    return it == _tables.end() ? nullptr : it->second.get();
+}
+
+bool Tablebases::probeNoEp(const Position& pos, TbProbe& result) const
+{
+    auto found = _byMaterial.find(EndgameTable::materialKey(pos));
+    if (found == _byMaterial.end()) return false;
+    const EndgameTable* table = found->second.table;
+    // the table has the stronger side as white
+    if (!found->second.flipped) {
+        result = probeFromValue(table->value(pos.sideToMove(), table->index(pos)));
+    } else {
+        // a Position is not cheap to construct, keep one per thread
+        thread_local Position flipped;
+        flipColours(pos, flipped);
+        result = probeFromValue(table->value(flipped.sideToMove(), table->index(flipped)));
+    }
+    return true;
+}
+
+bool Tablebases::probe(const Position& pos, TbProbe& result) const
+{
+    if (pos.castling() || popCount(pos.occupied()) > _maxPieces) return false;
+    if (pos.epSquare() == kNoSquare) return probeNoEp(pos, result);
+
+    // the tables have no en passant rights, so look at every move instead
+    MoveList moves;
+    pos.generateLegalMoves(moves);
+    if (moves.empty()) {
+        result = TbProbe();
+        if (pos.inCheck()) result.wdl = -1;
+        return true;
+    }
+    bool found = false;
+    for (Move m : moves) {
+        Position child = pos;
+        UndoInfo undo;
+        child.makeMove(m, undo);
+        TbProbe childResult;
+        if (!probe(child, childResult)) return false;
+        TbProbe score = afterMove(childResult);
+        if (!found || betterForMover(score, result)) result = score;
+        found = true;
+    }
+    return true;
+}
+
+Move Tablebases::bestMove(const Position& pos, TbProbe* result) const
+{
+    if (pos.castling() || popCount(pos.occupied()) > _maxPieces) return Move::none();
+    MoveList moves;
+    pos.generateLegalMoves(moves);
+    Move best;
+    TbProbe bestScore;
+    for (Move m : moves) {
+        Position child = pos;
+        UndoInfo undo;
+        child.makeMove(m, undo);
+        TbProbe childResult;
+        if (!probe(child, childResult)) return Move::none();
+        TbProbe score = afterMove(childResult);
+        if (!best || betterForMover(score, bestScore)) {
+            best = m;
+            bestScore = score;
+        }
+    }
+    if (best && result) *result = bestScore;
+    return best;
+}
+
+static const Tablebases* s_tablebases = nullptr;
+
+void setTablebases(const Tablebases* tables)
+{
+    s_tablebases = (tables && tables->maxPieces() > 0) ? tables : nullptr;
+}
+
+const Tablebases* activeTablebases()
+{
+    return s_tablebases;
+}
+
+//
+// generation
+//
+
+// runs work(begin, end) over [0, count) in chunks on every thread
+template<typename Work>
+static void parallelFor(uint64_t count, int threads, Work work)
+{
+    constexpr uint64_t kChunk = 1 << 14;
+    std::atomic<uint64_t> next(0);
+    auto run = [&]() {
+        for (uint64_t begin = next.fetch_add(kChunk); begin < count; begin = next.fetch_add(kChunk)) {
+            work(begin, std::min(count, begin + kChunk));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(run);
+    run();
+    for (auto& t : pool) t.join();
+}
+
+class TablebaseGenerator
+{
+public:
+    TablebaseGenerator(EndgameTable& table, const Tablebases& smaller, int threads)
+        : _table(table), _smaller(smaller), _threads(std::max(1, threads)),
+          _values((size_t)table._positions * 2), _longest(0)
+    {
+    }
+
+    void run()
+    {
+        parallelFor(_table._positions * 2, _threads, [&](uint64_t begin, uint64_t end) {
+            Position pos;
+            for (uint64_t slot = begin; slot < end; slot++) initialise(slot, pos);
+        });
+        for (int level = 0; level <= _longest.load(); level++) {
+            uint16_t resolved = (uint16_t)(level + 1);
+            if (level & 1) {
+                // wins through a capture or promotion start counting at their own distance
+                parallelFor(_values.size(), _threads, [&](uint64_t begin, uint64_t end) {
+                    for (uint64_t slot = begin; slot < end; slot++) {
+                        if (_values[slot].load(std::memory_order_relaxed) == (kCandidate | resolved)) _values[slot] = resolved;
+                    }
+                });
+            }
+            parallelFor(_values.size(), _threads, [&](uint64_t begin, uint64_t end) {
+                Position pos, before;
+                for (uint64_t slot = begin; slot < end; slot++) {
+                    if (_values[slot].load(std::memory_order_relaxed) == resolved) propagate(slot, level, pos, before);
+                }
+            });
+        }
+
+        _table._values.assign(_values.size(), 0);
+        int longest = 0;
+        for (size_t slot = 0; slot < _values.size(); slot++) {
+            uint16_t v = _values[slot].load(std::memory_order_relaxed);
+            if (v >= kUnknown) continue;
+            _table._values[slot] = v;
+            if (v) longest = std::max(longest, v - 1);
+        }
+        _table._longestMate = longest;
+    }
+
+private:
+    // working values besides draw (0) and distance + 1
+    static constexpr uint16_t kUnknown = 0x7FFE;
+    static constexpr uint16_t kIllegal = 0x7FFF;
+    static constexpr uint16_t kCandidate = 0x8000;     // | distance + 1 of a win by leaving the table
+
+    void raiseLongest(int dtm)
+    {
+        int seen = _longest.load();
+        while (dtm > seen && !_longest.compare_exchange_weak(seen, dtm)) {}
+    }
+
+    std::atomic<uint16_t>& at(int side, uint64_t index) { return _values[(size_t)side * _table._positions + index]; }
+
+    // moves that change the material are looked up in the smaller tables
+    static bool leavesTable(Move m) { return m.isCapture() || m.isPromotion(); }
+
+    void initialise(uint64_t slot, Position& pos)
+    {
+        int side = slot >= _table._positions ? Black : White;
+        uint64_t index = slot - (side == Black ? _table._positions : 0);
+        // symmetric copies that index() never returns are left out
+        if (!_table.position(index, side, pos) || _table.index(pos) != index) {
+            _values[slot] = kIllegal;
+            return;
+        }
+        MoveList moves;
+        pos.generateLegalMoves(moves);
+        if (moves.empty()) {
+            _values[slot] = pos.inCheck() ? 1 : 0;
+            return;
+        }
+        // a position whose moves all leave the table has no child here for
+        // propagate() to start from, so a loss has to be settled now
+        int win = INT32_MAX, loss = 0;
+        bool allLeave = true;
+        for (Move m : moves) {
+            if (!leavesTable(m)) {
+                allLeave = false;
+                continue;
+            }
+            UndoInfo undo;
+            pos.makeMove(m, undo);
+            TbProbe child;
+            if (!_smaller.probe(pos, child) || child.wdl <= 0) loss = -1;
+            else if (loss >= 0) loss = std::max(loss, child.dtm + 1);
+            if (child.wdl < 0) win = std::min(win, child.dtm + 1);
+            pos.unmakeMove(m, undo);
+        }
+        if (allLeave && loss >= 0) {
+            _values[slot] = (uint16_t)(loss + 1);
+            raiseLongest(loss);
+        } else if (win == INT32_MAX) {
+            _values[slot] = kUnknown;
+        } else {
+            _values[slot] = (uint16_t)(kCandidate | (win + 1));
+            raiseLongest(win);
+        }
+    }
+
+    // the position of slot has just been resolved at this distance, update
+    // the positions one move before it
+    void propagate(uint64_t slot, int level, Position& pos, Position& before)
+    {
+        int side = slot >= _table._positions ? Black : White;
+        uint64_t index = slot - (side == Black ? _table._positions : 0);
+        _table.position(index, side, pos);
+
+        int mover = side ^ 1;
+        uint64_t occupied = pos.occupied();
+        uint8_t board[64];
+        std::memcpy(board, pos.board(), 64);
+        for (uint64_t pieces = pos.pieces(mover); pieces;) {
+            int to = popLsb(pieces);
+            ChessPiece piece = tagPiece(board[to]);
+            uint64_t sources = 0;
+            switch (piece) {
+            case Pawn: {
+                int back = mover == White ? -8 : 8;
+                int from = to + back;
+                if (from >= 8 && from < 56 && !(occupied & Attacks::squareBB(from))) {
+                    sources |= Attacks::squareBB(from);
+                    int doubleRank = mover == White ? 3 : 4;
+                    int twice = from + back;
+                    if ((to >> 3) == doubleRank && !(occupied & Attacks::squareBB(twice))) sources |= Attacks::squareBB(twice);
+                }
+                break;
+            }
+            case Knight: sources = Attacks::kKnight[to]; break;
+            case Bishop: sources = Attacks::bishop(to, occupied); break;
+            case Rook:   sources = Attacks::rook(to, occupied); break;
+            case Queen:  sources = Attacks::queen(to, occupied); break;
+            case King:   sources = Attacks::kKing[to]; break;
+            default: break;
+            }
+            sources &= ~occupied;
+
+            while (sources) {
+                int from = popLsb(sources);
+                board[from] = board[to];
+                board[to] = 0;
+                before.setBoard(board, mover == White, 0, -1);
+                board[to] = board[from];
+                board[from] = 0;
+                if (before.isAttacked(before.kingSquare(side), mover)) continue;
+
+                std::atomic<uint16_t>& value = at(mover, _table.index(before));
+                uint16_t seen = value.load();
+                if (level % 2 == 0) {
+                    // a move into a loss wins
+                    uint16_t win = (uint16_t)(level + 2);
+                    while ((seen == kUnknown || ((seen & kCandidate) && (seen & ~kCandidate) > win)) &&
+                           !value.compare_exchange_weak(seen, win)) {}
+                    raiseLongest(level + 1);
+                } else if (seen == kUnknown) {
+                    int loss = lossDistance(before);
+                    if (loss >= 0 && value.compare_exchange_strong(seen, (uint16_t)(loss + 1))) raiseLongest(loss);
+                }
+            }
+        }
+    }
+
+    // plies to mate if every move of the position runs into a known win, -1 otherwise
+    int lossDistance(Position& pos)
+    {
+        MoveList moves;
+        pos.generateLegalMoves(moves);
+        int longest = -1;
+        for (Move m : moves) {
+            UndoInfo undo;
+            pos.makeMove(m, undo);
+            int dtm = -1;
+            if (leavesTable(m)) {
+                TbProbe child;
+                if (_smaller.probe(pos, child) && child.wdl > 0) dtm = child.dtm;
+            } else {
+                uint16_t v = at(pos.sideToMove(), _table.index(pos)).load(std::memory_order_relaxed);
+                if (v && v < kUnknown && ((v - 1) & 1)) dtm = v - 1;
+            }
+            pos.unmakeMove(m, undo);
+            if (dtm < 0) return -1;
+            longest = std::max(longest, dtm);
+        }
+        return longest + 1;
+    }
+
+    EndgameTable& _table;
+    const Tablebases& _smaller;
+    int _threads;
+    std::vector<std::atomic<uint16_t>> _values;
+    std::atomic<int> _longest;
+};
+
+// every material balance one capture or promotion away
+static std::set<std::string> conversions(const std::string& name)
+{
+    size_t v = name.find('v');
+    std::string sides[2] = { name.substr(1, v - 1), name.substr(v + 2) };
+    std::set<std::string> found;
+    auto add = [&](const std::string& white, const std::string& black) {
+        std::string converted = canonicalName("K" + white + "vK" + black);
+        if (!converted.empty() && converted != name) found.insert(converted);
+    };
+    for (int c = 0; c < 2; c++) {
+        const std::string& own = sides[c];
+        const std::string& other = sides[c ^ 1];
+        for (size_t i = 0; i < own.size(); i++) {
+            std::string captured = own.substr(0, i) + own.substr(i + 1);
+            c == 0 ? add(captured, other) : add(other, captured);
+        }
+        for (size_t i = 0; i < own.size(); i++) {
+            if (own[i] != 'P') continue;
+            for (char promoted : std::string("QRBN")) {
+                std::string after = own;
+                after[i] = promoted;
+                c == 0 ? add(after, other) : add(other, after);
+                for (size_t j = 0; j < other.size(); j++) {
+                    std::string captured = other.substr(0, j) + other.substr(j + 1);
+                    c == 0 ? add(after, captured) : add(captured, after);
+                }
+            }
+        }
+    }
+    return found;
+}
+
+static bool buildTable(const std::string& name, const TbGenerateOptions& options, Tablebases& tables)
+{
+    if (tables.find(name)) return true;
+    auto start = std::chrono::steady_clock::now();
+    auto table = std::make_unique<EndgameTable>();
+    if (!table->setMaterial(name)) return false;
+    std::string path = (std::filesystem::path(options.directory) / (name + ".ctb")).string();
+    auto seconds = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    if (table->load(path)) {
+        if (options.onTable) options.onTable(*table, false, seconds());
+        tables.add(std::move(table));
+        return true;
+    }
+    for (const std::string& smaller : conversions(name)) {
+        if (!buildTable(smaller, options, tables)) return false;
+    }
+    start = std::chrono::steady_clock::now();
+    TablebaseGenerator(*table, tables, options.threads).run();
+    if (!table->save(path)) return false;
+    if (options.onTable) options.onTable(*table, true, seconds());
+    tables.add(std::move(table));
+    return true;
+}
+
+bool generateTablebase(const std::string& name, const TbGenerateOptions& options)
+{
+    std::string canonical = canonicalName(name);
+    if (canonical.empty()) return false;
+    Tablebases tables;
+    return buildTable(canonical, options, tables);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Position.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// endgame tables built by retrograde analysis
+//
+// a table covers one material balance of up to 5 pieces, kings included,
+// named like "KRvK" or "KBNvK" with the stronger side first, and holds the
+// distance to mate in plies for every position with either side to move.
+// the tables know nothing of castling, en passant or the 50 move rule:
+// probe() answers positions with an en passant square by looking one ply
+// ahead, and a side that needs more than 100 plies may in practice only draw
+//
+// en passant would also change values inside a table, after a double push
+// that can be taken, and generation does not model it. so only material
+// where it cannot happen is built: pawns on one side at most (KPvK, KQvKP,
+// not KPvKP). captures and promotions never give the other side a pawn, so
+// every table such material converts into qualifies as well
+//
+// index: the two kings go through a table of the king pairs left after
+// symmetry (462 without pawns, where all 8 board symmetries apply, 1806
+// with pawns, where only the left-right mirror does), then every other piece
+// takes 6 bits of its square:
+//   index = kingPair * 64^(pieces - 2) + square of piece 1 * 64^(pieces - 3) + ...
+// white pieces come first, strongest first. squares that would put two
+// pieces together or a pawn on the back rank are wasted, not packed away
+//
+// values (16 bit): 0 draw (or an illegal position), otherwise plies to mate
+// + 1; odd distances are wins for the side to move, even ones losses
+//
+// generation works level by level: checkmates are distance 0, every
+// position one move before a loss at distance d is a win at d + 1, and a
+// position becomes a loss at d + 1 once all of its moves reach a win of at
+// most d. captures and promotions leave the table for a smaller one, so the
+// tables a table converts into are built (or loaded) first
+//
+// file (all integers little-endian):
+//   header   magic "CHTBDTM1", name (16 bytes, zero padded), positions per
+//            side (8), values per block (4), block count (4), longest mate (4)
+//   offsets  block count + 1 file offsets (8 each)
+//   blocks   LZ compressed values, white to move first, then black
+//
+
+constexpr int kTbMaxPieces = 5;
+
+// probe result from the side to move's point of view
+struct TbProbe
+{
+    int wdl = 0;        // 1 win, 0 draw, -1 loss
+    int dtm = 0;        // plies to mate, 0 when drawn
+};
+
+class EndgameTable
+{
+public:
+    // material balance, e.g. "KQvKR"; false if it is not a valid name
+    bool setMaterial(const std::string& name);
+    const std::string& name() const { return _name; }
+    int pieceCount() const { return (int)_pieces.size() + 2; }
+    uint64_t positions() const { return _positions; }
+    int longestMate() const { return _longestMate; }
+
+    // canonical name of the material on the board, "" with more than kTbMaxPieces
+    // or with pawns on both sides
+    static std::string materialName(const Position& pos);
+    // piece counts of the board, and of the table with or without the colours
+    // swapped; equal keys mean the same material the same way round
+    static uint64_t materialKey(const Position& pos);
+    uint64_t materialKey(bool flipped) const;
+
+    // the index of a position with this material, white being the first side of the name
+    uint64_t index(const Position& pos) const;
+    // sets up the position of an index, false if it is not a legal position
+    bool position(uint64_t index, int sideToMove, Position& pos) const;
+
+    // the table file: open() maps it and decompresses a block per lookup,
+    // load() decompresses all of it into memory
+    bool open(const std::string& path);
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+    bool isReady() const { return !_values.empty() || _file.isOpen(); }
+
+    // stored value of an index, see above
+    uint16_t value(int sideToMove, uint64_t index) const;
+
+private:
+    friend class TablebaseGenerator;
+
+    bool readHeader();
+    uint16_t fileValue(uint64_t slot) const;
+
+    std::string _name;
+    std::vector<uint8_t> _pieces;       // tags of everything but the kings
+    bool _pawns = false;
+    uint64_t _positions = 0;
+    int _longestMate = 0;
+
+    std::vector<uint16_t> _values;      // [side * positions + index] when loaded
+    MappedFile _file;
+    uint32_t _blockValues = 0;
+    uint32_t _blocks = 0;
+    uint64_t _serial = 0;               // tells the block caches apart
+};
+
+class Tablebases
+{
+public:
+    // opens every .ctb file in the directory, returns how many
+    int open(const std::string& directory);
+    void add(std::unique_ptr<EndgameTable> table);
+    void clear()
+    {
+        _tables.clear();
+        _byMaterial.clear();
+        _maxPieces = 0;
+    }
+    int maxPieces() const { return _maxPieces; }
+    const EndgameTable* find(const std::string& name) const;
+
+    // false if no table covers the position or it has castling rights
+    bool probe(const Position& pos, TbProbe& result) const;
+    // the move that keeps the best distance to mate, none if probe() fails
+    Move bestMove(const Position& pos, TbProbe* result = nullptr) const;
+
+private:
+    bool probeNoEp(const Position& pos, TbProbe& result) const;
+
+    struct MaterialSlot
+    {
+        const EndgameTable* table;
+        bool flipped;       // the board has the table's white pieces as black
+    };
+
+    std::map<std::string, std::unique_ptr<EndgameTable>> _tables;
+    std::unordered_map<uint64_t, MaterialSlot> _byMaterial;
+    int _maxPieces = 0;
+};
+
+// the tables the search probes, nullptr for none
+// only change this while no search is running
+void setTablebases(const Tablebases* tables);
+const Tablebases* activeTablebases();
+
+struct TbGenerateOptions
+{
+    int threads = 1;
+    std::string directory = ".";
+    // reports each table as it is finished (or found on disk)
+    std::function<void(const EndgameTable& table, bool generated, double seconds)> onTable;
+};
+
+// builds <directory>/<name>.ctb and every smaller table it needs that is
+// not there yet. false for a bad name or when a file could not be written
+bool generateTablebase(const std::string& name, const TbGenerateOptions& options);
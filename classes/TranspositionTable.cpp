@@ -0,0 +1,72 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+    : _mask(0), _age(0)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    // round down to a power of two so the index is a mask
+    size_t count = 1;
+    size_t wanted = (megabytes ? megabytes : 1) * 1024 * 1024 / sizeof(Entry);
+    while (count * 2 <= wanted) count *= 2;
+
+    _entries = std::vector<Entry>(count);
+    _mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (Entry& e : _entries) {
+        e.check.store(0, std::memory_order_relaxed);
+        e.data.store(0, std::memory_order_relaxed);
+    }
+    _age = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTHit& hit) const
+{
+    const Entry& e = _entries[key & _mask];
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    uint64_t check = e.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || !data) return false;
+
+    hit.move = Move((uint16_t)data);
+    hit.score = (int16_t)(data >> 16);
+    hit.depth = (uint8_t)(data >> 32);
+    hit.bound = (Bound)((data >> 40) & 3);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, Bound bound)
+{
+    Entry& e = _entries[key & _mask];
+    uint64_t old = e.data.load(std::memory_order_relaxed);
+    bool sameKey = (e.check.load(std::memory_order_relaxed) ^ old) == key;
+
+    // keep a deeper entry for the same position from this search
+    if (sameKey && old && bound != kBoundExact && (int)((old >> 42) & 63) == _age &&
+        depth + 2 < (int)(uint8_t)(old >> 32)) {
+        return;
+    }
+    // don't lose a known best move to a store that has none
+    if (sameKey && !move) move = Move((uint16_t)old);
+
+    uint64_t data = pack(move, score, depth < 0 ? 0 : depth, bound, _age);
+    e.data.store(data, std::memory_order_relaxed);
+    e.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    int used = 0;
+    size_t samples = _entries.size() < 1000 ? _entries.size() : 1000;
+    for (size_t i = 0; i < samples; i++) {
+        uint64_t data = _entries[i].data.load(std::memory_order_relaxed);
+        if (data && (int)((data >> 42) & 63) == _age) used++;
+    }
+    return samples ? (int)(used * 1000 / samples) : 0;
+}
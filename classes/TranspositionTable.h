@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Move.h"
+#include <atomic>
+#include <vector>
+
+//
+// shared transposition table
+//
+// each entry is two 64 bit words, the key is stored xor'ed with the data word
+// so several search threads can read and write without locks: a torn entry
+// simply fails the key check and is treated as a miss
+//
+
+enum Bound : uint8_t
+{
+    kBoundNone  = 0,
+    kBoundUpper = 1,
+    kBoundLower = 2,
+    kBoundExact = 3,
+};
+
+struct TTHit
+{
+    Move  move;
+    int   score;
+    int   depth;
+    Bound bound;
+};
+
+class TranspositionTable
+{
+public:
+    explicit TranspositionTable(size_t megabytes = 16);
+
+    void resize(size_t megabytes);
+    void clear();
+    // bumps the age so entries from older searches get replaced first
+    void newSearch() { _age = (_age + 1) & 63; }
+
+    bool probe(uint64_t key, TTHit& hit) const;
+    void store(uint64_t key, Move move, int score, int depth, Bound bound);
+
+    // per-mille of sampled entries written during the current search, for UCI "hashfull"
+    int hashfull() const;
+    size_t sizeInMegabytes() const { return _entries.size() * sizeof(Entry) / (1024 * 1024); }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check;    // key ^ data
+        std::atomic<uint64_t> data;     // move | score | depth | bound | age
+    };
+
+    static uint64_t pack(Move move, int score, int depth, Bound bound, int age)
+    {
+        return (uint64_t)move.raw() | ((uint64_t)(uint16_t)(int16_t)score << 16) |
+               ((uint64_t)(uint8_t)depth << 32) | ((uint64_t)bound << 40) | ((uint64_t)age << 42);
+    }
+
+    std::vector<Entry> _entries;
+    uint64_t _mask;
+    int _age;
+};
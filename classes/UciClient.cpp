@@ -0,0 +1,330 @@
+#include "UciClient.h"
+#include <chrono>
+#include <sstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+UciClient::UciClient()
+    : _running(false)
+#if defined(_WIN32)
+    , _process(nullptr), _toChild(nullptr), _fromChild(nullptr)
+#else
+    , _pid(-1), _toChild(-1), _fromChild(-1)
+#endif
+{
+}
+
+UciClient::~UciClient()
+{
+    quit();
+}
+
+#if defined(_WIN32)
+
+bool UciClient::start(const std::string& command)
+{
+    quit();
+
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), nullptr, TRUE };
+    HANDLE childIn = nullptr, childOut = nullptr;
+    HANDLE toChild = nullptr, fromChild = nullptr;
+    if (!CreatePipe(&childIn, &toChild, &sa, 0)) return false;
+    if (!CreatePipe(&fromChild, &childOut, &sa, 0)) {
+        CloseHandle(childIn);
+        CloseHandle(toChild);
+        return false;
+    }
+    // our ends must not leak into the child
+    SetHandleInformation(toChild, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(fromChild, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = childIn;
+    si.hStdOutput = childOut;
+    si.hStdError = childOut;
+    PROCESS_INFORMATION pi = {};
+    std::vector<char> cmdLine(command.begin(), command.end());
+    cmdLine.push_back('\0');
+
+    BOOL ok = CreateProcessA(nullptr, cmdLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+                             nullptr, nullptr, &si, &pi);
+    CloseHandle(childIn);
+    CloseHandle(childOut);
+    if (!ok) {
+        CloseHandle(toChild);
+        CloseHandle(fromChild);
+        return false;
+    }
+    CloseHandle(pi.hThread);
+
+    _process = pi.hProcess;
+    _toChild = toChild;
+    _fromChild = fromChild;
+    _running = true;
+    _reader = std::thread(&UciClient::readLoop, this);
+    return true;
+}
+
+void UciClient::quit()
+{
+    if (_process) {
+        send("quit");
+        if (WaitForSingleObject((HANDLE)_process, 500) == WAIT_TIMEOUT) {
+            TerminateProcess((HANDLE)_process, 1);
+        }
+    }
+    if (_reader.joinable()) _reader.join();
+    closeHandles();
+    _running = false;
+}
+
+void UciClient::send(const std::string& line)
+{
+    if (!_toChild) return;
+    std::string data = line + "\n";
+    DWORD written = 0;
+    WriteFile((HANDLE)_toChild, data.data(), (DWORD)data.size(), &written, nullptr);
+}
+
+void UciClient::readLoop()
+{
+    std::string partial;
+    char buffer[4096];
+    DWORD got = 0;
+    while (ReadFile((HANDLE)_fromChild, buffer, sizeof(buffer), &got, nullptr) && got > 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (DWORD i = 0; i < got; i++) {
+            if (buffer[i] == '\n') {
+                _pending.push_back(partial);
+                partial.clear();
+            } else if (buffer[i] != '\r') {
+                partial += buffer[i];
+            }
+        }
+    }
+    _running = false;
+}
+
+void UciClient::closeHandles()
+{
+    if (_toChild) CloseHandle((HANDLE)_toChild);
+    if (_fromChild) CloseHandle((HANDLE)_fromChild);
+    if (_process) CloseHandle((HANDLE)_process);
+    _toChild = _fromChild = _process = nullptr;
+}
+
+#else
+
+// every end is close-on-exec, so an engine started later does not inherit
+// another engine's pipes; dup2 clears the flag on the child's stdin and stdout
+static bool openPipe(int fds[2])
+{
+    if (pipe(fds) != 0) return false;
+    if (fcntl(fds[0], F_SETFD, FD_CLOEXEC) != 0 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) != 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    return true;
+}
+
+bool UciClient::start(const std::string& command)
+{
+    quit();
+
+    std::vector<std::string> args;
+    std::istringstream in(command);
+    std::string arg;
+    while (in >> arg) args.push_back(arg);
+    if (args.empty()) return false;
+    // built before fork(): the child of a threaded process may only make
+    // async-signal-safe calls, and allocating is not one of them
+    std::vector<char*> argv;
+    for (std::string& a : args) argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    // a dead engine must not take the GUI down with it on the next write
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int toChild[2], fromChild[2], execStatus[2];
+    if (!openPipe(toChild)) return false;
+    if (!openPipe(fromChild)) {
+        close(toChild[0]);
+        close(toChild[1]);
+        return false;
+    }
+    // closes on a successful exec, so a read of zero bytes means the engine started
+    if (!openPipe(execStatus)) {
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        dup2(fromChild[1], STDERR_FILENO);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        close(execStatus[0]);
+        execvp(argv[0], argv.data());
+
+        int error = errno;
+        ssize_t ignored = write(execStatus[1], &error, sizeof(error));
+        (void)ignored;
+        _exit(127);
+    }
+
+    close(toChild[0]);
+    close(fromChild[1]);
+    close(execStatus[1]);
+
+    int error = 0;
+    bool started = pid > 0 && read(execStatus[0], &error, sizeof(error)) == 0;
+    close(execStatus[0]);
+    if (!started) {
+        close(toChild[1]);
+        close(fromChild[0]);
+        if (pid > 0) waitpid(pid, nullptr, 0);
+        return false;
+    }
+
+    _pid = pid;
+    _toChild = toChild[1];
+    _fromChild = fromChild[0];
+    _running = true;
+    _reader = std::thread(&UciClient::readLoop, this);
+    return true;
+}
+
+void UciClient::quit()
+{
+    if (_pid > 0) {
+        send("quit");
+        close(_toChild);
+        _toChild = -1;
+
+        // give the engine half a second to exit on its own
+        bool exited = false;
+        for (int i = 0; i < 50 && !exited; i++) {
+            exited = waitpid(_pid, nullptr, WNOHANG) == _pid;
+            if (!exited) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!exited) {
+            kill(_pid, SIGKILL);
+            waitpid(_pid, nullptr, 0);
+        }
+        _pid = -1;
+    }
+    if (_reader.joinable()) _reader.join();
+    closeHandles();
+    _running = false;
+}
+
+void UciClient::send(const std::string& line)
+{
+    if (_toChild < 0) return;
+    std::string data = line + "\n";
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(_toChild, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        done += (size_t)n;
+    }
+}
+
+void UciClient::readLoop()
+{
+    std::string partial;
+    char buffer[4096];
+    for (;;) {
+        ssize_t got = read(_fromChild, buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (ssize_t i = 0; i < got; i++) {
+            if (buffer[i] == '\n') {
+                _pending.push_back(partial);
+                partial.clear();
+            } else if (buffer[i] != '\r') {
+                partial += buffer[i];
+            }
+        }
+    }
+    _running = false;
+}
+
+void UciClient::closeHandles()
+{
+    if (_toChild >= 0) close(_toChild);
+    if (_fromChild >= 0) close(_fromChild);
+    _toChild = _fromChild = -1;
+}
+
+#endif
+
+void UciClient::poll(std::vector<std::string>& lines)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (std::string& line : _pending) lines.push_back(std::move(line));
+    _pending.clear();
+}
+
+bool UciClient::parseInfo(const std::string& line, UciInfo& info)
+{
+    std::istringstream in(line);
+    std::string token;
+    if (!(in >> token) || token != "info") return false;
+
+    bool hasPv = false;
+    while (in >> token) {
+        if (token == "depth") in >> info.depth;
+        else if (token == "multipv") in >> info.multipv;
+        else if (token == "nodes") in >> info.nodes;
+        else if (token == "nps") in >> info.nps;
+        else if (token == "time") in >> info.timeMs;
+        else if (token == "score") {
+            std::string kind;
+            in >> kind >> info.score;
+            info.mate = kind == "mate";
+        } else if (token == "pv") {
+            // the pv runs to the end of the line
+            std::string move;
+            info.pv.clear();
+            while (in >> move) info.pv += (info.pv.empty() ? "" : " ") + move;
+            hasPv = true;
+        } else if (token == "string") {
+            return false;
+        }
+    }
+    return hasPv;
+}
+
+bool UciClient::parseBestMove(const std::string& line, std::string& best, std::string& ponder)
+{
+    std::istringstream in(line);
+    std::string token;
+    if (!(in >> token) || token != "bestmove") return false;
+    if (!(in >> best)) return false;
+    ponder.clear();
+    if (in >> token && token == "ponder") in >> ponder;
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// talks to an external UCI engine running as a child process
+//
+// a reader thread collects the engine's output into a line buffer, so the
+// render thread never blocks: it send()s commands and poll()s for whatever
+// lines have arrived since the last frame
+//
+
+// one parsed "info ... pv ..." line
+struct UciInfo
+{
+    int         depth = 0;
+    int         multipv = 1;
+    bool        mate = false;       // score is mate in n moves rather than centipawns
+    int         score = 0;
+    uint64_t    nodes = 0;
+    uint64_t    nps = 0;
+    int64_t     timeMs = 0;
+    std::string pv;                 // space separated uci moves
+};
+
+class UciClient
+{
+public:
+    UciClient();
+    ~UciClient();
+
+    // command is the executable path followed by optional space separated arguments
+    bool start(const std::string& command);
+    // asks the engine to quit, kills it if it does not exit promptly
+    void quit();
+    bool isRunning() const { return _running.load(); }
+
+    void send(const std::string& line);
+    // moves all lines received so far into lines, never blocks
+    void poll(std::vector<std::string>& lines);
+
+    // line parsers, return false if the line is something else
+    static bool parseInfo(const std::string& line, UciInfo& info);
+    static bool parseBestMove(const std::string& line, std::string& best, std::string& ponder);
+
+private:
+    void readLoop();
+    void closeHandles();
+
+    std::thread _reader;
+    std::mutex _mutex;
+    std::vector<std::string> _pending;
+    std::atomic<bool> _running;
+
+#if defined(_WIN32)
+    void* _process;
+    void* _toChild;
+    void* _fromChild;
+#else
+    int _pid;
+    int _toChild;
+    int _fromChild;
+#endif
+};
@@ -0,0 +1,377 @@
+// UCI front end for the headless chess engine
+// speaks the Universal Chess Interface over stdin/stdout so the engine can be
+// run from tournament managers and GUIs, see Engine.h for the search side
+
+#include "classes/Bench.h"
+#include "classes/Engine.h"
+#include "classes/Evaluate.h"
+#include "classes/LockFreeQueue.h"
+#include "classes/Nnue.h"
+#include "classes/Syzygy.h"
+#include "classes/Tablebase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(UCI_INTERFACE)
+#error "main_uci.cpp is the UCI_INTERFACE build, configure with -DUCI_INTERFACE=ON"
+#endif
+
+//
+// output goes through a queue to a writer thread, so a search thread
+// reporting an info line never waits on stdout or on another thread's lock
+//
+// the writer sleeps when the queue is empty; a producer only touches the
+// mutex when it sees the writer asleep, the fences make sure one of the two
+// notices the other (the producer sees the flag or the writer sees the line)
+//
+static MpscQueue<std::string> s_output(4096);
+static std::mutex s_writerMutex;
+static std::condition_variable s_writerWake;
+static std::atomic<bool> s_writerSleeping(false);
+static std::atomic<bool> s_outputClosed(false);
+
+static void wakeWriter()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (s_writerSleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(s_writerMutex);
+        s_writerSleeping.store(false, std::memory_order_relaxed);
+        s_writerWake.notify_one();
+    }
+}
+
+static void send(std::string line)
+{
+    while (!s_output.push(std::move(line))) std::this_thread::yield();
+    wakeWriter();
+}
+
+static void writeOutput()
+{
+    std::string line;
+    for (;;) {
+        bool wrote = false;
+        while (s_output.pop(line)) {
+            std::fwrite(line.data(), 1, line.size(), stdout);
+            std::fputc('\n', stdout);
+            wrote = true;
+        }
+        if (wrote) {
+            std::fflush(stdout);
+            continue;
+        }
+        if (s_outputClosed.load(std::memory_order_acquire)) break;
+
+        std::unique_lock<std::mutex> lock(s_writerMutex);
+        s_writerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (s_output.pop(line)) {
+            // a line slipped in before we went to sleep
+            s_writerSleeping.store(false, std::memory_order_relaxed);
+            lock.unlock();
+            std::fwrite(line.data(), 1, line.size(), stdout);
+            std::fputc('\n', stdout);
+            std::fflush(stdout);
+            continue;
+        }
+        if (s_outputClosed.load(std::memory_order_acquire)) break;
+        s_writerWake.wait(lock, [] { return !s_writerSleeping.load(std::memory_order_relaxed); });
+    }
+}
+
+static std::string scoreString(int score)
+{
+    if (score >= kMateBound) return "mate " + std::to_string((kMateScore - score + 1) / 2);
+    if (score <= -kMateBound) return "mate -" + std::to_string((kMateScore + score) / 2);
+    return "cp " + std::to_string(score);
+}
+
+// position [startpos | fen <fen>] [moves <m1> <m2> ...]
+static void handlePosition(Engine& engine, std::istringstream& in)
+{
+    std::string token, fen;
+    in >> token;
+    if (token == "startpos") {
+        fen = kStartFen;
+        in >> token;
+    } else if (token == "fen") {
+        while (in >> token && token != "moves") fen += token + " ";
+    } else {
+        return;
+    }
+
+    Position root;
+    if (!root.setFen(fen)) return;
+
+    // each move is parsed against the position it is played in
+    std::vector<Move> moves;
+    Position walk = root;
+    while (in >> token) {
+        Move m = walk.parseUciMove(token);
+        if (!m) break;
+        UndoInfo undo;
+        walk.makeMove(m, undo);
+        moves.push_back(m);
+    }
+    engine.setPosition(root, moves);
+}
+
+static void handleGo(Engine& engine, std::istringstream& in)
+{
+    GoParams params;
+    std::string token;
+    while (in >> token) {
+        if (token == "depth") in >> params.depth;
+        else if (token == "nodes") in >> params.nodes;
+        else if (token == "movetime") in >> params.movetime;
+        else if (token == "wtime") in >> params.wtime;
+        else if (token == "btime") in >> params.btime;
+        else if (token == "winc") in >> params.winc;
+        else if (token == "binc") in >> params.binc;
+        else if (token == "movestogo") in >> params.movestogo;
+        else if (token == "infinite") params.infinite = true;
+        else if (token == "ponder") params.ponder = true;
+    }
+    engine.go(params);
+}
+
+// setoption name <id> [value <x>]
+static void handleSetOption(Engine& engine, Nnue& net, OpeningBook& book, bool& ownBook, Tablebases& tables,
+                            SyzygyTablebases& syzygy, std::istringstream& in)
+{
+    std::string token, name, value;
+    in >> token;
+    while (in >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    while (in >> token) value += (value.empty() ? "" : " ") + token;
+
+    if (name == "Hash") {
+        engine.setHashSize((size_t)std::max(1, std::atoi(value.c_str())));
+    } else if (name == "Threads") {
+        engine.setThreads(std::max(1, std::atoi(value.c_str())));
+    } else if (name == "MultiPV") {
+        engine.wait();
+        engine.setMultiPv(std::atoi(value.c_str()));
+    } else if (name == "OwnBook") {
+        engine.wait();
+        ownBook = value == "true";
+        engine.setBook(ownBook && book.isOpen() ? &book : nullptr);
+    } else if (name == "BookFile") {
+        engine.wait();
+        engine.setBook(nullptr);
+        if (value.empty() || value == "<empty>") {
+            book.close();
+        } else if (book.open(value)) {
+            send("info string loaded book " + value + " with " + std::to_string(book.entries()) + " entries");
+        } else {
+            send("info string could not load book " + value + " (only book_builder books can be read)");
+        }
+        engine.setBook(ownBook && book.isOpen() ? &book : nullptr);
+    } else if (name == "EvalFile") {
+        engine.wait();
+        if (value.empty() || value == "<empty>") {
+            setEvalNetwork(nullptr);
+        } else if (net.load(value)) {
+            setEvalNetwork(&net);
+            send("info string loaded network " + value);
+        } else {
+            setEvalNetwork(nullptr);
+            send("info string could not load network " + value);
+        }
+    } else if (name == "TablebasePath") {
+        engine.wait();
+        setTablebases(nullptr);
+        tables.clear();
+        if (!value.empty() && value != "<empty>") {
+            int found = tables.open(value);
+            send("info string found " + std::to_string(found) + " endgame tables in " + value);
+        }
+        setTablebases(&tables);
+    } else if (name == "SyzygyPath") {
+        engine.wait();
+        setSyzygyTablebases(nullptr);
+        syzygy.close();
+        if (!value.empty() && value != "<empty>") {
+            int found = syzygy.open(value);
+            send("info string found " + std::to_string(found) + " syzygy tables up to " +
+                 std::to_string(syzygy.maxPieces()) + " pieces in " + value);
+        }
+        setSyzygyTablebases(&syzygy);
+    }
+}
+
+// bench [depth]: the fixed benchmark, the node count is the search's signature
+static void handleBench(std::istringstream& in)
+{
+    int depth = kBenchDepth;
+    in >> depth;
+    depth = std::max(1, depth);
+    BenchResult bench = runBench(depth, 16, [](int index, const SearchResult& result) {
+        send("info string bench position " + std::to_string(index + 1) + "/" + std::to_string(benchPositionCount()) +
+             " depth " + std::to_string(result.depth) + " nodes " + std::to_string(result.nodes) + " " + benchFen(index));
+    });
+    send("Positions       : " + std::to_string(bench.positions));
+    send("Depth           : " + std::to_string(depth));
+    send("Total time (ms) : " + std::to_string(bench.timeMs));
+    send("Nodes searched  : " + std::to_string(bench.nodes));
+    send("Nodes/second    : " + std::to_string(bench.nps));
+    send("Attack sets     : " + std::to_string(bench.attacks.computed) + " computed, " +
+         std::to_string(bench.attacks.reused) + " reused");
+}
+
+// "perft <depth>": leaf counts below each move of the current position, then the total
+// "perft bench": the perft suite through make/unmake, templated or not, and copy-make
+static void handlePerft(const Engine& engine, std::istringstream& in)
+{
+    std::string arg;
+    in >> arg;
+    if (arg == "bench") {
+        PerftBenchResult bench = runPerftBench();
+        auto nps = [&](int64_t ms) { return std::to_string(bench.nodes * 1000 / (uint64_t)std::max<int64_t>(1, ms)); };
+        send("Nodes per run   : " + std::to_string(bench.nodes) + (bench.correct ? "" : " (WRONG)"));
+        send("Templated side  : " + std::to_string(bench.templatedMs) + " ms, " + nps(bench.templatedMs) + " nps");
+        send("Run time side   : " + std::to_string(bench.runTimeMs) + " ms, " + nps(bench.runTimeMs) + " nps");
+        send("Copy-make       : " + std::to_string(bench.copyMakeMs) + " ms, " + nps(bench.copyMakeMs) + " nps");
+        return;
+    }
+    int depth = std::max(1, std::atoi(arg.c_str()));
+    Position pos = engine.position();
+    MoveList list;
+    pos.generateLegalMoves(list);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t total = 0;
+    for (Move m : list) {
+        UndoInfo undo;
+        pos.makeMove(m, undo);
+        uint64_t nodes = perft(pos, depth - 1);
+        pos.unmakeMove(m, undo);
+        total += nodes;
+        send(m.toUci() + ": " + std::to_string(nodes));
+    }
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    send("Nodes searched  : " + std::to_string(total));
+    send("Total time (ms) : " + std::to_string(ms));
+    send("Nodes/second    : " + std::to_string(total * 1000 / (uint64_t)std::max<int64_t>(1, ms)));
+}
+
+int main(int argc, char** argv)
+{
+    std::thread writer(writeOutput);
+    Engine engine;
+    Nnue net;
+    OpeningBook book;
+    Tablebases tables;
+    SyzygyTablebases syzygy;
+    bool ownBook = false;
+
+    engine.onInfo = [](const SearchInfo& info) {
+        std::string line = "info depth " + std::to_string(info.depth) +
+                           " multipv " + std::to_string(info.multipv) +
+                           " score " + scoreString(info.score) +
+                           " nodes " + std::to_string(info.nodes) +
+                           " nps " + std::to_string(info.nps) +
+                           " time " + std::to_string(info.timeMs) +
+                           " hashfull " + std::to_string(info.hashfull) + " pv";
+        for (Move m : info.pv) {
+            line += ' ';
+            line += m.toUci();
+        }
+        send(line);
+    };
+    engine.onBestMove = [](Move best, Move ponder) {
+        std::string line = "bestmove " + best.toUci();
+        if (ponder) line += " ponder " + ponder.toUci();
+        send(line);
+    };
+
+    // "chess_uci bench [depth]" runs the benchmark and exits, and so does
+    // "chess_uci perft <depth> [fen]" from the start position or the fen
+    std::vector<std::string> script;
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "bench") {
+        std::string bench = "bench";
+        for (int i = 2; i < argc; i++) bench += std::string(" ") + argv[i];
+        script.push_back(bench);
+    } else if (mode == "perft" && argc > 2) {
+        std::string fen;
+        for (int i = 3; i < argc; i++) fen += std::string(fen.empty() ? "" : " ") + argv[i];
+        script.push_back(fen.empty() ? "position startpos" : "position fen " + fen);
+        script.push_back(std::string("perft ") + argv[2]);
+    }
+    size_t scripted = 0;
+    auto readLine = [&](std::string& line) {
+        if (script.empty()) return (bool)std::getline(std::cin, line);
+        if (scripted == script.size()) return false;
+        line = script[scripted++];
+        return true;
+    };
+
+    std::string line;
+    while (readLine(line)) {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+
+        if (command == "uci") {
+            send("id name chess-123");
+            send("id author chess-123 contributors");
+            send("option name Hash type spin default 16 min 1 max 4096");
+            send("option name Threads type spin default 1 min 1 max 256");
+            send("option name MultiPV type spin default 1 min 1 max 64");
+            send("option name Ponder type check default false");
+            send("option name EvalFile type string default <empty>");
+            send("option name OwnBook type check default false");
+            send("option name BookFile type string default <empty>");
+            send("option name TablebasePath type string default <empty>");
+            send("option name SyzygyPath type string default <empty>");
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "ucinewgame") {
+            engine.stop();
+            engine.newGame();
+        } else if (command == "position") {
+            engine.stop();
+            handlePosition(engine, in);
+        } else if (command == "go") {
+            handleGo(engine, in);
+        } else if (command == "stop") {
+            engine.stop();
+        } else if (command == "ponderhit") {
+            engine.ponderhit();
+        } else if (command == "setoption") {
+            handleSetOption(engine, net, book, ownBook, tables, syzygy, in);
+        } else if (command == "d") {
+            send(engine.position().fen());
+        } else if (command == "bench") {
+            engine.stop();
+            engine.wait();
+            handleBench(in);
+        } else if (command == "perft") {
+            engine.stop();
+            engine.wait();
+            handlePerft(engine, in);
+        } else if (command == "quit") {
+            break;
+        }
+    }
+
+    engine.stop();
+    engine.wait();
+
+    s_outputClosed.store(true, std::memory_order_release);
+    wakeWriter();
+    writer.join();
+    return 0;
+}
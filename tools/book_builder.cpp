@@ -0,0 +1,271 @@
+//
+// book_builder: opening book from PGN collections
+//
+// PgnParser maps each PGN file and parses it on a pool of threads; every
+// worker replays the first plies of its games and adds (position, move)
+// statistics to sharded hash maps; the result is written as a key-sorted
+// book that OpeningBook maps straight into memory
+//
+// memory stays bounded: the parser only keeps a few chunks in flight, and
+// when the maps hold more than --max-entries the rarest moves are pruned
+//
+//   book_builder <out.bin> <games.pgn> [more.pgn ...] [--plies N]
+//                [--min-games N] [--threads N] [--max-entries N]
+//
+
+#include "../classes/OpeningBook.h"
+#include "../classes/Pgn.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr int kShardCount = 256;
+constexpr size_t kFlushRecords = 1 << 16;
+
+struct Options
+{
+    std::string outPath;
+    std::vector<std::string> inputs;
+    int plies = 30;
+    uint32_t minGames = 2;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t maxEntries = 50000000;
+};
+
+struct MoveKey
+{
+    uint64_t key;
+    uint16_t move;
+    bool operator==(const MoveKey& other) const { return key == other.key && move == other.move; }
+};
+
+struct MoveKeyHash
+{
+    size_t operator()(const MoveKey& k) const { return (size_t)(k.key ^ ((uint64_t)k.move * 0x9E3779B97F4A7C15ULL)); }
+};
+
+struct MoveStats
+{
+    uint32_t games = 0;
+    uint32_t score = 0;     // 2 per win and 1 per draw for the side that played the move
+};
+
+struct Record
+{
+    MoveKey key;
+    uint32_t score;
+};
+
+struct Shard
+{
+    std::mutex mutex;
+    std::unordered_map<MoveKey, MoveStats, MoveKeyHash> moves;
+};
+
+struct Shared
+{
+    Options options;
+    Shard shards[kShardCount];
+    std::atomic<size_t> entries{0};
+    std::atomic<uint64_t> positions{0};
+    std::mutex pruneMutex;
+    uint32_t pruneBelow = 2;
+};
+
+int shardOf(const MoveKey& k)
+{
+    return (int)(k.key >> 56);
+}
+
+// drops the moves seen fewer than pruneBelow times, raising the bar each time
+void prune(Shared& shared)
+{
+    std::lock_guard<std::mutex> pruneLock(shared.pruneMutex);
+    if (shared.entries.load() <= shared.options.maxEntries) return;
+
+    size_t removed = 0;
+    for (Shard& shard : shared.shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto it = shard.moves.begin(); it != shard.moves.end();) {
+            if (it->second.games < shared.pruneBelow) {
+                it = shard.moves.erase(it);
+                removed++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    shared.entries -= removed;
+    std::printf("pruned %zu moves seen fewer than %u times\n", removed, shared.pruneBelow);
+    shared.pruneBelow++;
+}
+
+// merges a thread's records, one lock per shard touched
+void flush(Shared& shared, std::vector<Record>& records)
+{
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) { return shardOf(a.key) < shardOf(b.key); });
+    size_t added = 0;
+    for (size_t i = 0; i < records.size();) {
+        int shardIndex = shardOf(records[i].key);
+        Shard& shard = shared.shards[shardIndex];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (; i < records.size() && shardOf(records[i].key) == shardIndex; i++) {
+            auto [it, inserted] = shard.moves.try_emplace(records[i].key);
+            it->second.games++;
+            it->second.score += records[i].score;
+            added += inserted;
+        }
+    }
+    records.clear();
+    if (shared.entries.fetch_add(added) + added > shared.options.maxEntries) prune(shared);
+}
+
+// called on the parser's worker threads, records is that worker's own buffer
+void addGame(Shared& shared, const PgnGame& game, std::vector<Record>& records)
+{
+    if (game.result == kPgnUnknown) return;
+
+    Position pos;
+    if (!pos.setFen(game.startFen)) return;
+    int plies = std::min<int>(shared.options.plies, (int)game.moves.size());
+    for (int ply = 0; ply < plies; ply++) {
+        Move m = game.moves[ply];
+        int mover = pos.whiteToMove() ? 1 : -1;
+        uint32_t score = game.result == kPgnDraw ? 1 : (game.result == mover ? 2 : 0);
+        records.push_back({ { bookKey(pos), OpeningBook::encodeMove(m) }, score });
+
+        UndoInfo undo;
+        pos.makeMove(m, undo);
+    }
+    shared.positions += plies;
+    if (records.size() >= kFlushRecords) flush(shared, records);
+}
+
+// everything that made the cut, sorted the way OpeningBook searches it
+std::vector<BookEntry> collectEntries(Shared& shared)
+{
+    std::vector<BookEntry> entries;
+    for (Shard& shard : shared.shards) {
+        for (const auto& [k, stats] : shard.moves) {
+            if (stats.games < shared.options.minGames || stats.score == 0) continue;
+            entries.push_back({ k.key, k.move, 0, stats.score });
+        }
+        shard.moves.clear();
+    }
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        if (a.key != b.key) return a.key < b.key;
+        return a.learn != b.learn ? a.learn > b.learn : a.move < b.move;
+    });
+
+    // the raw score rides in learn until here; weights are 16 bit, so scale each position's moves together
+    for (size_t i = 0; i < entries.size();) {
+        size_t end = i;
+        uint32_t best = entries[i].learn;
+        while (end < entries.size() && entries[end].key == entries[i].key) end++;
+        for (size_t j = i; j < end; j++) {
+            uint64_t weight = best > 65535 ? (uint64_t)entries[j].learn * 65535 / best : entries[j].learn;
+            entries[j].weight = (uint16_t)std::max<uint64_t>(1, weight);
+            entries[j].learn = 0;
+        }
+        i = end;
+    }
+    return entries;
+}
+
+bool writeBook(const std::string& path, const std::vector<BookEntry>& entries)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    std::vector<uint8_t> buffer;
+    buffer.reserve(kBookEntrySize * 65536);
+    for (const BookEntry& e : entries) {
+        uint8_t bytes[kBookEntrySize];
+        OpeningBook::writeEntry(bytes, e);
+        buffer.insert(buffer.end(), bytes, bytes + kBookEntrySize);
+        if (buffer.size() >= kBookEntrySize * 65536) {
+            out.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+    return (bool)out;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 3) return false;
+    opt.outPath = argv[1];
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            opt.inputs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--plies") opt.plies = std::max(1, std::atoi(value));
+        else if (arg == "--min-games") opt.minGames = (uint32_t)std::max(1, std::atoi(value));
+        else if (arg == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else if (arg == "--max-entries") opt.maxEntries = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return !opt.inputs.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Shared shared;
+    if (!parseOptions(argc, argv, shared.options)) {
+        std::fprintf(stderr, "usage: book_builder <out.bin> <games.pgn> [more.pgn ...] [--plies N] [--min-games N] [--threads N] [--max-entries N]\n");
+        return 1;
+    }
+    const Options& opt = shared.options;
+
+    auto start = std::chrono::steady_clock::now();
+    PgnParser parser(opt.threads);
+    std::vector<std::vector<Record>> records(parser.threads());
+    uint64_t games = 0, badGames = 0;
+
+    for (const std::string& path : opt.inputs) {
+        bool ok = parser.parseFile(path, [&](const PgnGame& game, int worker) {
+            addGame(shared, game, records[worker]);
+        }, false);
+        if (!ok) {
+            std::fprintf(stderr, "could not read %s\n", path.c_str());
+            continue;
+        }
+        for (std::vector<Record>& r : records) flush(shared, r);
+        games += parser.stats().games;
+        badGames += parser.stats().badGames;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%s: games %llu  positions %llu  moves %zu  %.0f games/s\n", path.c_str(),
+                    (unsigned long long)games, (unsigned long long)shared.positions.load(),
+                    shared.entries.load(), games / std::max(seconds, 1e-3));
+    }
+
+    std::vector<BookEntry> entries = collectEntries(shared);
+    if (!writeBook(opt.outPath, entries)) {
+        std::fprintf(stderr, "could not write %s\n", opt.outPath.c_str());
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%llu games (%llu with unreadable moves), %llu positions, %zu book entries, %.1f s\n",
+                (unsigned long long)games, (unsigned long long)badGames,
+                (unsigned long long)shared.positions.load(), entries.size(), seconds);
+    return 0;
+}
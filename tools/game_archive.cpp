@@ -0,0 +1,209 @@
+//
+// game_archive: pack PGN collections into the binary GameArchive format
+//
+//   game_archive pack <out.gar> <games.pgn> [more.pgn ...] [--threads N]
+//   game_archive unpack <in.gar> <out.pgn> [--first N] [--count N]
+//   game_archive replay <in.gar> [--threads N]
+//
+// pack parses and encodes on every core; with more than one thread the games
+// keep their file order only within a batch, --threads 1 keeps it exactly.
+// replay decodes every game (one move generation per ply) and reports the rate
+//
+
+#include "../classes/GameArchive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kBatchGames = 256;
+
+struct Options
+{
+    std::string command;
+    std::vector<std::string> paths;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    uint64_t first = 0;
+    uint64_t count = UINT64_MAX;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int pack(const Options& opt)
+{
+    GameArchiveWriter writer;
+    if (!writer.open(opt.paths[0])) {
+        std::fprintf(stderr, "could not write %s\n", opt.paths[0].c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PgnParser parser(opt.threads);
+    std::mutex writerMutex;
+    // records are encoded on the workers and handed to the writer a batch at a time
+    std::vector<std::vector<std::string>> batches(parser.threads());
+    std::atomic<uint64_t> rejected(0);
+    auto flush = [&](std::vector<std::string>& batch) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        for (const std::string& record : batch) writer.add(record);
+        batch.clear();
+    };
+
+    uint64_t pgnBytes = 0;
+    for (size_t i = 1; i < opt.paths.size(); i++) {
+        bool ok = parser.parseFile(opt.paths[i], [&](const PgnGame& game, int worker) {
+            std::vector<std::string>& batch = batches[worker];
+            batch.emplace_back();
+            if (!GameArchiveWriter::encodeGame(game, batch.back())) {
+                batch.pop_back();
+                rejected++;
+                return;
+            }
+            if (batch.size() >= kBatchGames) flush(batch);
+        }, opt.threads == 1);
+        if (!ok) {
+            std::fprintf(stderr, "could not read %s\n", opt.paths[i].c_str());
+            continue;
+        }
+        for (std::vector<std::string>& batch : batches) flush(batch);
+        pgnBytes += parser.stats().bytes;
+    }
+
+    uint64_t games = writer.games();
+    if (!writer.close()) {
+        std::fprintf(stderr, "could not write %s\n", opt.paths[0].c_str());
+        return 1;
+    }
+    std::ifstream packed(opt.paths[0], std::ios::binary | std::ios::ate);
+    uint64_t archiveBytes = (uint64_t)packed.tellg();
+    double seconds = secondsSince(start);
+    std::printf("%llu games (%llu rejected), %llu PGN bytes -> %llu bytes (%.1f bytes/game, %.1fx), %.1f s, %.0f games/s\n",
+                (unsigned long long)games, (unsigned long long)rejected.load(), (unsigned long long)pgnBytes,
+                (unsigned long long)archiveBytes, (double)archiveBytes / std::max<uint64_t>(1, games),
+                (double)pgnBytes / std::max<uint64_t>(1, archiveBytes), seconds, games / std::max(seconds, 1e-3));
+    return 0;
+}
+
+int unpack(const Options& opt)
+{
+    GameArchive archive;
+    if (!archive.open(opt.paths[0])) {
+        std::fprintf(stderr, "could not read %s\n", opt.paths[0].c_str());
+        return 1;
+    }
+    std::ofstream out(opt.paths[1], std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::fprintf(stderr, "could not write %s\n", opt.paths[1].c_str());
+        return 1;
+    }
+
+    uint64_t last = opt.first + std::min(opt.count, archive.games() - std::min(opt.first, archive.games()));
+    std::vector<PgnGame> games;
+    std::string text;
+    for (size_t b = 0; b < archive.blocks(); b++) {
+        const ArchiveBlock& block = archive.block(b);
+        if (block.firstGame + block.gameCount <= opt.first) continue;
+        if (block.firstGame >= last) break;
+        if (!archive.readBlock(b, games)) {
+            std::fprintf(stderr, "block %zu is damaged\n", b);
+            return 1;
+        }
+        for (uint32_t i = 0; i < block.gameCount; i++) {
+            uint64_t id = block.firstGame + i;
+            if (id < opt.first || id >= last) continue;
+            text.clear();
+            writePgnGame(games[i], text);
+            out.write(text.data(), (std::streamsize)text.size());
+        }
+    }
+    std::printf("wrote %llu games\n", (unsigned long long)(last - std::min(opt.first, last)));
+    return out ? 0 : 1;
+}
+
+int replay(const Options& opt)
+{
+    GameArchive archive;
+    if (!archive.open(opt.paths[0])) {
+        std::fprintf(stderr, "could not read %s\n", opt.paths[0].c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> nextBlock(0);
+    std::atomic<uint64_t> games(0), plies(0), damaged(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; t++) {
+        threads.emplace_back([&]() {
+            std::vector<PgnGame> block;
+            for (size_t b = nextBlock++; b < archive.blocks(); b = nextBlock++) {
+                if (!archive.readBlock(b, block)) {
+                    damaged++;
+                    continue;
+                }
+                uint64_t blockPlies = 0;
+                for (const PgnGame& game : block) blockPlies += game.moves.size();
+                games += block.size();
+                plies += blockPlies;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    double seconds = secondsSince(start);
+    std::printf("%llu games, %llu plies, %llu damaged blocks, %.2f s: %.0f games/s, %.1f M plies/s\n",
+                (unsigned long long)games.load(), (unsigned long long)plies.load(),
+                (unsigned long long)damaged.load(), seconds, games / std::max(seconds, 1e-3),
+                plies / std::max(seconds, 1e-3) / 1e6);
+    return damaged ? 1 : 0;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 3) return false;
+    opt.command = argv[1];
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            opt.paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else if (arg == "--first") opt.first = std::strtoull(value, nullptr, 10);
+        else if (arg == "--count") opt.count = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    if (opt.command == "pack") return opt.paths.size() >= 2;
+    if (opt.command == "unpack") return opt.paths.size() == 2;
+    if (opt.command == "replay") return opt.paths.size() == 1;
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: game_archive pack <out.gar> <games.pgn> [more.pgn ...] [--threads N]\n"
+                             "       game_archive unpack <in.gar> <out.pgn> [--first N] [--count N]\n"
+                             "       game_archive replay <in.gar> [--threads N]\n");
+        return 1;
+    }
+    if (opt.command == "pack") return pack(opt);
+    if (opt.command == "unpack") return unpack(opt);
+    return replay(opt);
+}
@@ -0,0 +1,476 @@
+//
+// game_cli: command line jobs on the headless engine
+//
+//   game_cli analyze <positions.epd> [--out results.jsonl] [--depth N] [--nodes N]
+//                    [--movetime MS] [--threads N] [--hash MB]
+//   game_cli mate <puzzles.epd> [--out results.jsonl] [--mate N] [--nodes N]
+//                 [--movetime MS] [--threads N] [--hash MB]
+//
+// analyze reads EPD or FEN lines (one position each, '#' starts a comment),
+// searches every position on a pool of workers, each with its own search
+// and transposition table, and writes one JSON object per line in input
+// order. when a line has bm or am opcodes the best move is checked against
+// them. the table is cleared for every position, so results do not depend
+// on which worker ran them
+//
+// mate runs the proof-number solver (MateSolver.h) on the same kind of file
+// and reports whether the side to move has a forced mate, the shortest one
+// and its line, and the time it took. a dm opcode sets the mate to look for
+// and is checked; otherwise --mate N (moves, default 16) bounds the search
+//
+
+#include "../classes/MateSolver.h"
+#include "../classes/Notation.h"
+#include "../classes/Search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    std::string command;
+    std::string inputPath;
+    std::string outPath;            // stdout when empty
+    SearchLimits limits;
+    MateLimits mateLimits;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMb = 16;
+};
+
+struct EpdLine
+{
+    Position position;
+    std::string fen;
+    std::string id;
+    std::vector<std::string> bestMoves;     // bm, as written
+    std::vector<std::string> avoidMoves;    // am, as written
+    int directMate = 0;                     // dm, mate in this many moves
+};
+
+// the first four fields are the position; FEN's two counters may follow, then "opcode operands;" pairs
+bool parseEpd(const std::string& line, EpdLine& epd, std::string& error)
+{
+    std::istringstream in(line);
+    std::string fields[4];
+    for (std::string& f : fields) {
+        if (!(in >> f)) {
+            error = "too few fields";
+            return false;
+        }
+    }
+    std::string rest;
+    std::getline(in, rest);
+
+    std::string clocks = " 0 1";
+    std::istringstream restIn(rest);
+    std::string halfmove, fullmove;
+    if (restIn >> halfmove >> fullmove && halfmove.find_first_not_of("0123456789") == std::string::npos &&
+        fullmove.find_first_not_of("0123456789") == std::string::npos) {
+        clocks = " " + halfmove + " " + fullmove;
+        std::getline(restIn, rest);
+    }
+
+    epd.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + clocks;
+    if (!epd.position.setFen(epd.fen)) {
+        error = "bad position";
+        return false;
+    }
+
+    size_t pos = 0;
+    while (pos < rest.size()) {
+        size_t end = pos;
+        bool quoted = false;
+        while (end < rest.size() && (quoted || rest[end] != ';')) {
+            if (rest[end] == '"') quoted = !quoted;
+            end++;
+        }
+        std::istringstream op(rest.substr(pos, end - pos));
+        pos = end + 1;
+
+        std::string opcode, operand;
+        if (!(op >> opcode)) continue;
+        if (opcode == "id") {
+            std::getline(op, operand);
+            size_t first = operand.find('"'), last = operand.rfind('"');
+            epd.id = first != std::string::npos && last > first ? operand.substr(first + 1, last - first - 1) : operand;
+        } else if (opcode == "bm" || opcode == "am") {
+            std::vector<std::string>& moves = opcode == "bm" ? epd.bestMoves : epd.avoidMoves;
+            while (op >> operand) moves.push_back(operand);
+        } else if (opcode == "dm") {
+            op >> epd.directMate;
+        }
+    }
+    return true;
+}
+
+void appendJsonString(std::string& out, const std::string& text)
+{
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendJsonMoves(std::string& out, const std::vector<std::string>& moves)
+{
+    out += '[';
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (i) out += ',';
+        appendJsonString(out, moves[i]);
+    }
+    out += ']';
+}
+
+// a move from an EPD operand, usually SAN but some suites use long algebraic
+Move parseEpdMove(const Position& pos, const std::string& text)
+{
+    Move m = parseSan(pos, text);
+    return m ? m : parseLan(pos, text);
+}
+
+struct Tally
+{
+    std::atomic<uint64_t> positions{0};
+    std::atomic<uint64_t> tested{0};
+    std::atomic<uint64_t> passed{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> nodes{0};
+    std::atomic<uint64_t> mates{0};
+};
+
+// the start of a result line; false (with the line finished) when it does not parse
+bool beginResult(uint64_t index, const std::string& line, EpdLine& epd, std::string& json, Tally& tally)
+{
+    json = "{\"index\":" + std::to_string(index);
+    std::string error;
+    if (!parseEpd(line, epd, error)) {
+        tally.errors++;
+        json += ",\"error\":";
+        appendJsonString(json, error);
+        json += ",\"line\":";
+        appendJsonString(json, line);
+        json += "}";
+        return false;
+    }
+    if (!epd.id.empty()) {
+        json += ",\"id\":";
+        appendJsonString(json, epd.id);
+    }
+    json += ",\"fen\":";
+    appendJsonString(json, epd.fen);
+    return true;
+}
+
+// moves in SAN from pos, up to the first one that is not legal
+std::string sanLine(const Position& pos, const std::vector<Move>& moves)
+{
+    std::string line;
+    Position walk = pos;
+    char san[kMaxMoveText];
+    for (Move m : moves) {
+        if (parseLan(walk, m.toUci()) != m) break;
+        writeSan(walk, m, san);
+        if (!line.empty()) line += ' ';
+        line += san;
+        UndoInfo undo;
+        walk.makeMove(m, undo);
+    }
+    return line;
+}
+
+std::string analyzeLine(uint64_t index, const std::string& line, const Options& opt, TranspositionTable& tt, Tally& tally)
+{
+    std::string json;
+    EpdLine epd;
+    if (!beginResult(index, line, epd, json, tally)) return json;
+
+    tt.clear();
+    auto search = std::make_unique<Search>(tt);
+    auto start = std::chrono::steady_clock::now();
+    Position pos = epd.position;
+    SearchResult result = search->think(pos, opt.limits);
+    int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    tally.positions++;
+    tally.nodes += result.nodes;
+
+    json += ",\"bestmove\":";
+    appendJsonString(json, result.bestMove ? toSan(epd.position, result.bestMove) : "");
+    json += ",\"uci\":";
+    appendJsonString(json, result.bestMove ? result.bestMove.toUci() : "");
+    if (std::abs(result.score) >= kMateBound) {
+        int mate = result.score > 0 ? (kMateScore - result.score + 1) / 2 : -(kMateScore + result.score) / 2;
+        json += ",\"mate\":" + std::to_string(mate);
+    } else {
+        json += ",\"cp\":" + std::to_string(result.score);
+    }
+    json += ",\"depth\":" + std::to_string(result.depth);
+    json += ",\"nodes\":" + std::to_string(result.nodes);
+    json += ",\"time_ms\":" + std::to_string(timeMs);
+
+    json += ",\"pv\":";
+    appendJsonString(json, sanLine(epd.position, result.pv));
+
+    if (!epd.bestMoves.empty() || !epd.avoidMoves.empty()) {
+        bool pass = true;
+        if (!epd.bestMoves.empty()) {
+            json += ",\"bm\":";
+            appendJsonMoves(json, epd.bestMoves);
+            pass = std::any_of(epd.bestMoves.begin(), epd.bestMoves.end(),
+                               [&](const std::string& m) { return parseEpdMove(epd.position, m) == result.bestMove; });
+        }
+        if (!epd.avoidMoves.empty()) {
+            json += ",\"am\":";
+            appendJsonMoves(json, epd.avoidMoves);
+            pass = pass && std::none_of(epd.avoidMoves.begin(), epd.avoidMoves.end(),
+                                        [&](const std::string& m) { return parseEpdMove(epd.position, m) == result.bestMove; });
+        }
+        json += pass ? ",\"pass\":true" : ",\"pass\":false";
+        tally.tested++;
+        if (pass) tally.passed++;
+    }
+    return json + "}";
+}
+
+std::string mateLine(uint64_t index, const std::string& line, const Options& opt, MateSolver& solver, Tally& tally)
+{
+    std::string json;
+    EpdLine epd;
+    if (!beginResult(index, line, epd, json, tally)) return json;
+
+    MateLimits limits = opt.mateLimits;
+    if (epd.directMate > 0) limits.maxPlies = 2 * epd.directMate - 1;
+    solver.clear();
+    auto start = std::chrono::steady_clock::now();
+    Position pos = epd.position;
+    MateResult result = solver.solve(pos, limits);
+    int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    tally.positions++;
+    tally.nodes += result.nodes;
+    if (result.mate) tally.mates++;
+
+    int moves = (result.plies + 1) / 2;
+    json += result.mate ? ",\"status\":\"mate\"" : result.noMate ? ",\"status\":\"none\"" : ",\"status\":\"unknown\"";
+    if (result.mate) {
+        json += ",\"mate\":" + std::to_string(moves);
+        json += result.shortest ? ",\"shortest\":true" : ",\"shortest\":false";
+        json += ",\"bestmove\":";
+        appendJsonString(json, result.pv.empty() ? "" : toSan(epd.position, result.pv[0]));
+        json += ",\"pv\":";
+        appendJsonString(json, sanLine(epd.position, result.pv));
+    }
+    json += ",\"nodes\":" + std::to_string(result.nodes);
+    json += ",\"time_ms\":" + std::to_string(timeMs);
+
+    if (epd.directMate > 0) {
+        bool pass = result.mate && moves == epd.directMate;
+        json += ",\"dm\":" + std::to_string(epd.directMate);
+        json += pass ? ",\"pass\":true" : ",\"pass\":false";
+        tally.tested++;
+        if (pass) tally.passed++;
+    }
+    return json + "}";
+}
+
+// handles one input line on a worker, owning whatever the worker keeps between lines
+using LineHandler = std::function<std::string(uint64_t index, const std::string& line)>;
+
+//
+// the main thread reads lines into a bounded job queue, workers search them
+// and park the results, and the main thread writes the results in input
+// order as they complete; at most a few jobs per worker are ever in flight.
+// returns -1 when the files can't be opened
+//
+int runJobs(const Options& opt, const std::function<LineHandler()>& newWorker)
+{
+    std::ifstream input(opt.inputPath);
+    if (!input) {
+        std::fprintf(stderr, "could not read %s\n", opt.inputPath.c_str());
+        return -1;
+    }
+    std::ofstream file;
+    if (!opt.outPath.empty()) {
+        file.open(opt.outPath, std::ios::trunc);
+        if (!file) {
+            std::fprintf(stderr, "could not write %s\n", opt.outPath.c_str());
+            return -1;
+        }
+    }
+    std::ostream& out = opt.outPath.empty() ? std::cout : file;
+
+    const uint64_t maxInFlight = (uint64_t)opt.threads * 4;
+    std::mutex mutex;
+    std::condition_variable jobReady, resultReady;
+    std::deque<std::pair<uint64_t, std::string>> jobs;
+    std::map<uint64_t, std::string> results;
+    bool inputDone = false;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < opt.threads; t++) {
+        workers.emplace_back([&, handle = newWorker()]() {
+            for (;;) {
+                std::pair<uint64_t, std::string> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    jobReady.wait(lock, [&] { return !jobs.empty() || inputDone; });
+                    if (jobs.empty()) return;
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                std::string json = handle(job.first, job.second);
+                std::lock_guard<std::mutex> lock(mutex);
+                results[job.first] = std::move(json);
+                resultReady.notify_one();
+            }
+        });
+    }
+
+    uint64_t queued = 0, written = 0;
+    // writes whatever is ready in order; with wait, blocks until the next one is
+    auto drain = [&](std::unique_lock<std::mutex>& lock, bool wait) {
+        if (wait) resultReady.wait(lock, [&] { return results.count(written) > 0; });
+        for (auto it = results.find(written); it != results.end(); it = results.find(written)) {
+            std::string json = std::move(it->second);
+            results.erase(it);
+            written++;
+            lock.unlock();
+            out << json << '\n';
+            lock.lock();
+        }
+    };
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (queued - written >= maxInFlight) drain(lock, true);
+        jobs.emplace_back(queued++, line);
+        jobReady.notify_one();
+        drain(lock, false);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        inputDone = true;
+        jobReady.notify_all();
+        while (written < queued) drain(lock, true);
+    }
+    for (auto& w : workers) w.join();
+    out.flush();
+    return out ? 0 : 1;
+}
+
+int analyze(const Options& opt)
+{
+    Tally tally;
+    auto start = std::chrono::steady_clock::now();
+    int status = runJobs(opt, [&]() -> LineHandler {
+        auto tt = std::make_shared<TranspositionTable>(opt.hashMb);
+        return [&, tt](uint64_t index, const std::string& line) { return analyzeLine(index, line, opt, *tt, tally); };
+    });
+    if (status < 0) return 1;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%llu positions, %llu errors, %llu nodes, %.1f s, %.0f nps",
+                 (unsigned long long)tally.positions.load(), (unsigned long long)tally.errors.load(),
+                 (unsigned long long)tally.nodes.load(), seconds, tally.nodes / std::max(seconds, 1e-3));
+    if (tally.tested) {
+        std::fprintf(stderr, ", solved %llu of %llu", (unsigned long long)tally.passed.load(),
+                     (unsigned long long)tally.tested.load());
+    }
+    std::fprintf(stderr, "\n");
+    return status;
+}
+
+int mate(const Options& opt)
+{
+    Tally tally;
+    auto start = std::chrono::steady_clock::now();
+    int status = runJobs(opt, [&]() -> LineHandler {
+        auto solver = std::make_shared<MateSolver>(opt.hashMb);
+        return [&, solver](uint64_t index, const std::string& line) { return mateLine(index, line, opt, *solver, tally); };
+    });
+    if (status < 0) return 1;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%llu positions, %llu errors, %llu mates, %llu nodes, %.1f s",
+                 (unsigned long long)tally.positions.load(), (unsigned long long)tally.errors.load(),
+                 (unsigned long long)tally.mates.load(), (unsigned long long)tally.nodes.load(), seconds);
+    if (tally.tested) {
+        std::fprintf(stderr, ", solved %llu of %llu", (unsigned long long)tally.passed.load(),
+                     (unsigned long long)tally.tested.load());
+    }
+    std::fprintf(stderr, "\n");
+    return status;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 3) return false;
+    opt.command = argv[1];
+    opt.limits.depth = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (!opt.inputPath.empty()) return false;
+            opt.inputPath = arg;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--out") opt.outPath = value;
+        else if (arg == "--depth") opt.limits.depth = std::max(1, std::atoi(value));
+        else if (arg == "--nodes") opt.limits.nodes = opt.mateLimits.nodes = std::strtoull(value, nullptr, 10);
+        else if (arg == "--movetime") opt.limits.timeMs = opt.mateLimits.timeMs = std::max(1, std::atoi(value));
+        else if (arg == "--mate") opt.mateLimits.maxPlies = 2 * std::clamp(std::atoi(value), 1, 128) - 1;
+        else if (arg == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else if (arg == "--hash") opt.hashMb = (size_t)std::max(1, std::atoi(value));
+        else return false;
+    }
+    // without any limit, a fixed depth keeps a run finite
+    if (!opt.limits.depth) opt.limits.depth = opt.limits.nodes || opt.limits.timeMs ? kMaxPly - 1 : 10;
+    return (opt.command == "analyze" || opt.command == "mate") && !opt.inputPath.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: game_cli analyze <positions.epd> [--out results.jsonl] [--depth N] [--nodes N]\n"
+                             "                        [--movetime MS] [--threads N] [--hash MB]\n"
+                             "       game_cli mate <puzzles.epd> [--out results.jsonl] [--mate N] [--nodes N]\n"
+                             "                     [--movetime MS] [--threads N] [--hash MB]\n");
+        return 1;
+    }
+    return opt.command == "mate" ? mate(opt) : analyze(opt);
+}
@@ -0,0 +1,121 @@
+//
+// kpk_gen: solve king and pawn against king and write the bitbase as C++
+//
+//   kpk_gen <output.inc>
+//
+// run by the build, the output is compiled into chesscore (see Kpk.h).
+// the solver starts from the positions that are settled on sight (illegal
+// ones, a safe promotion, stalemate, the pawn falling) and keeps passing
+// over the rest until nothing changes: white wins if one move wins, black
+// draws if one move draws. whatever is still open at the end is a draw
+//
+
+#include "../classes/Kpk.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// results combine as bits, so a side can collect what its moves reach
+enum : uint8_t { kInvalid = 0, kUnknown = 1, kDraw = 2, kWin = 4 };
+
+struct KpkPosition
+{
+    int whiteKing, blackKing, sideToMove, pawn;
+
+    explicit KpkPosition(int index)
+        : whiteKing(index & 63), blackKing((index >> 6) & 63), sideToMove((index >> 12) & 1),
+          pawn(((index >> 13) & 3) | ((6 - (index >> 15)) << 3))
+    {
+    }
+};
+
+int distance(int a, int b)
+{
+    return std::max(std::abs((a & 7) - (b & 7)), std::abs((a >> 3) - (b >> 3)));
+}
+
+uint8_t initialResult(const KpkPosition& p)
+{
+    uint64_t pawnAttacks = Attacks::kPawn[White][p.pawn];
+    if (distance(p.whiteKing, p.blackKing) <= 1 || p.whiteKing == p.pawn || p.blackKing == p.pawn ||
+        (p.sideToMove == White && (pawnAttacks & Attacks::squareBB(p.blackKing)))) {
+        return kInvalid;
+    }
+    // the pawn promotes and the new queen can't be taken
+    int queening = p.pawn + 8;
+    if (p.sideToMove == White && (p.pawn >> 3) == 6 && p.whiteKing != queening && p.blackKing != queening &&
+        (distance(p.blackKing, queening) > 1 || distance(p.whiteKing, queening) == 1)) {
+        return kWin;
+    }
+    // stalemate, or the black king takes an undefended pawn
+    uint64_t blackMoves = Attacks::kKing[p.blackKing] & ~Attacks::kKing[p.whiteKing];
+    if (p.sideToMove == Black && (!(blackMoves & ~pawnAttacks) || (blackMoves & Attacks::squareBB(p.pawn)))) {
+        return kDraw;
+    }
+    return kUnknown;
+}
+
+uint8_t classify(const std::vector<uint8_t>& db, const KpkPosition& p)
+{
+    uint8_t reached = kInvalid;
+    if (p.sideToMove == White) {
+        for (uint64_t b = Attacks::kKing[p.whiteKing]; b;) {
+            reached |= db[kpkIndex(Black, p.blackKing, popLsb(b), p.pawn)];
+        }
+        if ((p.pawn >> 3) < 6) reached |= db[kpkIndex(Black, p.blackKing, p.whiteKing, p.pawn + 8)];
+        if ((p.pawn >> 3) == 1 && p.pawn + 8 != p.whiteKing && p.pawn + 8 != p.blackKing) {
+            reached |= db[kpkIndex(Black, p.blackKing, p.whiteKing, p.pawn + 16)];
+        }
+        return (reached & kWin) ? kWin : (reached & kUnknown) ? kUnknown : kDraw;
+    }
+    for (uint64_t b = Attacks::kKing[p.blackKing]; b;) {
+        reached |= db[kpkIndex(White, popLsb(b), p.whiteKing, p.pawn)];
+    }
+    return (reached & kDraw) ? kDraw : (reached & kUnknown) ? kUnknown : kWin;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: kpk_gen <output.inc>\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> db(kKpkPositions);
+    for (int i = 0; i < kKpkPositions; i++) db[i] = initialResult(KpkPosition(i));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = 0; i < kKpkPositions; i++) {
+            if (db[i] != kUnknown) continue;
+            db[i] = classify(db, KpkPosition(i));
+            changed |= db[i] != kUnknown;
+        }
+    }
+
+    std::vector<uint32_t> bits(kKpkPositions / 32);
+    int wins = 0;
+    for (int i = 0; i < kKpkPositions; i++) {
+        if (db[i] != kWin) continue;
+        bits[i / 32] |= 1u << (i & 31);
+        wins++;
+    }
+
+    FILE* out = std::fopen(argv[1], "w");
+    if (!out) {
+        std::fprintf(stderr, "could not write %s\n", argv[1]);
+        return 1;
+    }
+    std::fprintf(out, "// generated by kpk_gen, %d winning positions\n", wins);
+    std::fprintf(out, "static const uint32_t kKpkBitbase[%d] = {\n", (int)bits.size());
+    for (size_t i = 0; i < bits.size(); i++) {
+        std::fprintf(out, "%s0x%08x,%s", i % 8 ? " " : "    ", bits[i], i % 8 == 7 ? "\n" : "");
+    }
+    std::fprintf(out, "};\n");
+    return std::fclose(out) == 0 ? 0 : 1;
+}
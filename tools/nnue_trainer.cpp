@@ -0,0 +1,351 @@
+//
+// nnue_trainer: offline CPU trainer for the Nnue evaluator
+//
+// reads PackedPosition records, trains the float network with Adam on all
+// cores and exports the quantized net that Nnue::load() reads
+//
+//   nnue_trainer <data.bin> <out.nnue> [--epochs N] [--batch N] [--threads N]
+//                [--lr F] [--lambda F]
+//
+// lambda blends the two targets: 1.0 trains on search scores only,
+// 0.0 on game results only
+//
+
+#include "../classes/Nnue.h"
+#include "../classes/PackedPosition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kL1Inputs = 2 * kNnueHidden;
+constexpr float kMaxDenseWeight = 127.0f / kNnueQB;
+constexpr int kMaxTrainingScore = 3000;
+
+//
+// one flat block of parameters, so gradients, Adam moments and thread
+// reductions are all simple loops over contiguous floats
+//
+struct Parameters
+{
+    std::vector<float> data;
+
+    float* ftWeights;   // [kNnueInputs][kNnueHidden]
+    float* ftBias;      // [kNnueHidden]
+    float* l1Weights;   // [kNnueL1][kL1Inputs]
+    float* l1Bias;      // [kNnueL1]
+    float* outWeights;  // [kNnueL1]
+    float* outBias;     // [1]
+
+    Parameters()
+        : data(kNnueInputs * kNnueHidden + kNnueHidden + kNnueL1 * kL1Inputs + kNnueL1 + kNnueL1 + 1, 0.0f)
+    {
+        float* p = data.data();
+        ftWeights = p;  p += kNnueInputs * kNnueHidden;
+        ftBias = p;     p += kNnueHidden;
+        l1Weights = p;  p += kNnueL1 * kL1Inputs;
+        l1Bias = p;     p += kNnueL1;
+        outWeights = p; p += kNnueL1;
+        outBias = p;
+    }
+
+    Parameters(const Parameters&) = delete;
+    Parameters& operator=(const Parameters&) = delete;
+
+    void zero() { std::fill(data.begin(), data.end(), 0.0f); }
+};
+
+struct Options
+{
+    std::string dataPath;
+    std::string outPath;
+    int epochs = 10;
+    int batchSize = 16384;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    float learningRate = 0.001f;
+    float lambda = 0.75f;
+};
+
+inline float sigmoid(float x)
+{
+    return 1.0f / (1.0f + std::exp(-x));
+}
+
+//
+// forward + backward for one position, gradients are accumulated into grad
+// returns the squared error
+//
+float trainSample(const Parameters& net, Parameters& grad, const PackedPosition& packed, float lambda)
+{
+    TrainingSample s = packed.unpack();
+
+    int features[2][32];
+    int count = 0;
+    for (int sq = 0; sq < 64 && count < 32; sq++) {
+        if (!s.board[sq]) continue;
+        features[0][count] = Nnue::featureIndex(0, s.board[sq], sq);
+        features[1][count] = Nnue::featureIndex(1, s.board[sq], sq);
+        count++;
+    }
+    int us = s.whiteToMove ? 0 : 1;
+
+    // feature transformer, side to move first
+    alignas(64) float acc[2][kNnueHidden];
+    alignas(64) float input[kL1Inputs];
+    for (int p = 0; p < 2; p++) {
+        int persp = p == 0 ? us : us ^ 1;
+        float* a = acc[p];
+        std::memcpy(a, net.ftBias, sizeof(float) * kNnueHidden);
+        for (int f = 0; f < count; f++) {
+            const float* w = net.ftWeights + features[persp][f] * kNnueHidden;
+            for (int i = 0; i < kNnueHidden; i++) {
+                a[i] += w[i];
+            }
+        }
+        for (int i = 0; i < kNnueHidden; i++) {
+            input[p * kNnueHidden + i] = std::clamp(a[i], 0.0f, 1.0f);
+        }
+    }
+
+    alignas(64) float hiddenPre[kNnueL1];
+    alignas(64) float hidden[kNnueL1];
+    float out = *net.outBias;
+    for (int o = 0; o < kNnueL1; o++) {
+        const float* w = net.l1Weights + o * kL1Inputs;
+        float sum = net.l1Bias[o];
+        for (int i = 0; i < kL1Inputs; i++) {
+            sum += w[i] * input[i];
+        }
+        hiddenPre[o] = sum;
+        hidden[o] = std::clamp(sum, 0.0f, 1.0f);
+        out += net.outWeights[o] * hidden[o];
+    }
+
+    float prediction = sigmoid(out);
+    float scoreTarget = sigmoid((float)s.score / kNnueOutputScale);
+    float resultTarget = (s.result + 1) * 0.5f;
+    float target = lambda * scoreTarget + (1.0f - lambda) * resultTarget;
+    float error = prediction - target;
+
+    // backward
+    float dOut = 2.0f * error * prediction * (1.0f - prediction);
+    *grad.outBias += dOut;
+
+    alignas(64) float dHidden[kNnueL1];
+    for (int o = 0; o < kNnueL1; o++) {
+        grad.outWeights[o] += dOut * hidden[o];
+        dHidden[o] = (hiddenPre[o] > 0.0f && hiddenPre[o] < 1.0f) ? dOut * net.outWeights[o] : 0.0f;
+    }
+
+    alignas(64) float dInput[kL1Inputs] = {};
+    for (int o = 0; o < kNnueL1; o++) {
+        float d = dHidden[o];
+        if (d == 0.0f) continue;
+        grad.l1Bias[o] += d;
+        const float* w = net.l1Weights + o * kL1Inputs;
+        float* g = grad.l1Weights + o * kL1Inputs;
+        for (int i = 0; i < kL1Inputs; i++) {
+            g[i] += d * input[i];
+            dInput[i] += d * w[i];
+        }
+    }
+
+    for (int p = 0; p < 2; p++) {
+        int persp = p == 0 ? us : us ^ 1;
+        float* d = dInput + p * kNnueHidden;
+        for (int i = 0; i < kNnueHidden; i++) {
+            if (acc[p][i] <= 0.0f || acc[p][i] >= 1.0f) d[i] = 0.0f;
+            grad.ftBias[i] += d[i];
+        }
+        for (int f = 0; f < count; f++) {
+            float* g = grad.ftWeights + features[persp][f] * kNnueHidden;
+            for (int i = 0; i < kNnueHidden; i++) {
+                g[i] += d[i];
+            }
+        }
+    }
+
+    return error * error;
+}
+
+void initialize(Parameters& net)
+{
+    std::mt19937 rng(12345);
+    auto fill = [&](float* p, size_t n, float range) {
+        std::uniform_real_distribution<float> dist(-range, range);
+        for (size_t i = 0; i < n; i++) p[i] = dist(rng);
+    };
+    fill(net.ftWeights, (size_t)kNnueInputs * kNnueHidden, 0.1f);
+    fill(net.l1Weights, (size_t)kNnueL1 * kL1Inputs, std::sqrt(1.0f / kL1Inputs));
+    fill(net.outWeights, kNnueL1, std::sqrt(1.0f / kNnueL1));
+    std::fill(net.ftBias, net.ftBias + kNnueHidden, 0.1f);
+}
+
+//
+// Adam over the whole parameter block, dense weights are kept inside the
+// range the int8 export can represent
+//
+class Adam
+{
+public:
+    Adam(size_t size, float lr) : _m(size, 0.0f), _v(size, 0.0f), _lr(lr), _step(0) {}
+
+    void update(Parameters& net, const Parameters& grad, float scale)
+    {
+        const float beta1 = 0.9f, beta2 = 0.999f, eps = 1e-8f;
+        _step++;
+        float c1 = 1.0f - std::pow(beta1, (float)_step);
+        float c2 = 1.0f - std::pow(beta2, (float)_step);
+        float* p = net.data.data();
+        const float* g = grad.data.data();
+        size_t n = net.data.size();
+        for (size_t i = 0; i < n; i++) {
+            float gi = g[i] * scale;
+            _m[i] = beta1 * _m[i] + (1.0f - beta1) * gi;
+            _v[i] = beta2 * _v[i] + (1.0f - beta2) * gi * gi;
+            p[i] -= _lr * (_m[i] / c1) / (std::sqrt(_v[i] / c2) + eps);
+        }
+
+        auto clampRange = [](float* w, size_t count) {
+            for (size_t i = 0; i < count; i++) w[i] = std::clamp(w[i], -kMaxDenseWeight, kMaxDenseWeight);
+        };
+        clampRange(net.l1Weights, (size_t)kNnueL1 * kL1Inputs);
+        clampRange(net.outWeights, kNnueL1);
+    }
+
+private:
+    std::vector<float> _m;
+    std::vector<float> _v;
+    float _lr;
+    int _step;
+};
+
+void exportNet(const Parameters& net, Nnue& nnue)
+{
+    auto q16 = [](float v, float scale) { return (int16_t)std::lround(std::clamp(v * scale, -32767.0f, 32767.0f)); };
+    auto q8  = [](float v, float scale) { return (int8_t)std::lround(std::clamp(v * scale, -127.0f, 127.0f)); };
+
+    for (int i = 0; i < kNnueInputs * kNnueHidden; i++) nnue.ftWeights[i] = q16(net.ftWeights[i], kNnueQA);
+    for (int i = 0; i < kNnueHidden; i++) nnue.ftBias[i] = q16(net.ftBias[i], kNnueQA);
+    for (int i = 0; i < kNnueL1 * kL1Inputs; i++) nnue.l1Weights[i] = q8(net.l1Weights[i], kNnueQB);
+    for (int o = 0; o < kNnueL1; o++) {
+        nnue.l1Bias[o] = (int32_t)std::lround(net.l1Bias[o] * kNnueQA * kNnueQB);
+        nnue.outWeights[o] = q8(net.outWeights[o], kNnueQB);
+    }
+    nnue.outBias = (int32_t)std::lround(*net.outBias * kNnueQA * kNnueQB);
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 3) return false;
+    opt.dataPath = argv[1];
+    opt.outPath = argv[2];
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        const char* value = argv[i + 1];
+        if (key == "--epochs") opt.epochs = std::atoi(value);
+        else if (key == "--batch") opt.batchSize = std::atoi(value);
+        else if (key == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else if (key == "--lr") opt.learningRate = (float)std::atof(value);
+        else if (key == "--lambda") opt.lambda = (float)std::atof(value);
+        else return false;
+    }
+    return opt.epochs > 0 && opt.batchSize > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: nnue_trainer <data.bin> <out.nnue> [--epochs N] [--batch N] [--threads N] [--lr F] [--lambda F]\n");
+        return 1;
+    }
+
+    std::vector<PackedPosition> data;
+    if (!readPackedPositions(opt.dataPath, data)) {
+        std::fprintf(stderr, "could not read %s\n", opt.dataPath.c_str());
+        return 1;
+    }
+    // mate scores say nothing useful about the eval scale
+    data.erase(std::remove_if(data.begin(), data.end(), [](const PackedPosition& p) {
+        return std::abs(p.score) > kMaxTrainingScore;
+    }), data.end());
+    if (data.empty()) {
+        std::fprintf(stderr, "no usable positions in %s\n", opt.dataPath.c_str());
+        return 1;
+    }
+    std::printf("%zu positions, %d threads, batch %d\n", data.size(), opt.threads, opt.batchSize);
+
+    Parameters net;
+    initialize(net);
+    Adam adam(net.data.size(), opt.learningRate);
+
+    // each worker owns a gradient buffer, reduced into grads[0] after every batch
+    std::vector<Parameters*> grads;
+    for (int t = 0; t < opt.threads; t++) grads.push_back(new Parameters());
+    std::vector<double> losses(opt.threads);
+
+    std::mt19937 rng(67890);
+    for (int epoch = 1; epoch <= opt.epochs; epoch++) {
+        std::shuffle(data.begin(), data.end(), rng);
+        auto start = std::chrono::steady_clock::now();
+        double epochLoss = 0.0;
+
+        for (size_t begin = 0; begin < data.size(); begin += opt.batchSize) {
+            size_t end = std::min(data.size(), begin + (size_t)opt.batchSize);
+            size_t perThread = (end - begin + opt.threads - 1) / opt.threads;
+
+            std::vector<std::thread> workers;
+            for (int t = 0; t < opt.threads; t++) {
+                workers.emplace_back([&, t]() {
+                    grads[t]->zero();
+                    double loss = 0.0;
+                    size_t from = begin + t * perThread;
+                    size_t to = std::min(end, from + perThread);
+                    for (size_t i = from; i < to; i++) {
+                        loss += trainSample(net, *grads[t], data[i], opt.lambda);
+                    }
+                    losses[t] = loss;
+                });
+            }
+            for (auto& w : workers) w.join();
+
+            float* total = grads[0]->data.data();
+            size_t n = grads[0]->data.size();
+            for (int t = 1; t < opt.threads; t++) {
+                const float* g = grads[t]->data.data();
+                for (size_t i = 0; i < n; i++) total[i] += g[i];
+            }
+            for (double l : losses) epochLoss += l;
+
+            adam.update(net, *grads[0], 1.0f / (float)(end - begin));
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("epoch %d  loss %.6f  %.0f pos/s\n", epoch, epochLoss / data.size(), data.size() / std::max(seconds, 1e-9));
+        std::fflush(stdout);
+    }
+
+    for (Parameters* g : grads) delete g;
+
+    Nnue nnue;
+    exportNet(net, nnue);
+    if (!nnue.save(opt.outPath)) {
+        std::fprintf(stderr, "could not write %s\n", opt.outPath.c_str());
+        return 1;
+    }
+    std::printf("wrote %s\n", opt.outPath.c_str());
+    return 0;
+}
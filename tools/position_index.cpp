@@ -0,0 +1,148 @@
+//
+// position_index: find the games of an archive that reached a position
+//
+//   position_index build <archive.gar> <out.idx> [--plies N] [--memory MB] [--threads N]
+//   position_index query <index.idx> <archive.gar> [--fen FEN] [--moves "e4 e5 Nf3"] [--games N]
+//
+// build replays every game (the first --plies plies, 0 for all) and external
+// sorts the (key, game, ply) entries; query prints the moves played from the
+// position with their results and the first few games that reached it
+//
+
+#include "../classes/Notation.h"
+#include "../classes/PositionIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    std::string command;
+    std::vector<std::string> paths;
+    IndexBuildOptions build;
+    std::string fen = kStartFen;
+    std::string moves;
+    int games = 10;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int build(const Options& opt)
+{
+    GameArchive archive;
+    if (!archive.open(opt.paths[0])) {
+        std::fprintf(stderr, "could not read %s\n", opt.paths[0].c_str());
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    IndexBuildStats stats;
+    if (!buildPositionIndex(archive, opt.paths[1], opt.build, stats)) {
+        std::fprintf(stderr, "could not build %s\n", opt.paths[1].c_str());
+        return 1;
+    }
+    std::printf("%llu games, %llu positions, %d sorted runs, %.1f s\n", (unsigned long long)stats.games,
+                (unsigned long long)stats.entries, stats.runs, secondsSince(start));
+    return 0;
+}
+
+int query(const Options& opt)
+{
+    PositionIndex index;
+    GameArchive archive;
+    if (!index.open(opt.paths[0]) || !archive.open(opt.paths[1])) {
+        std::fprintf(stderr, "could not read %s or %s\n", opt.paths[0].c_str(), opt.paths[1].c_str());
+        return 1;
+    }
+
+    Position pos;
+    if (!pos.setFen(opt.fen)) {
+        std::fprintf(stderr, "bad fen %s\n", opt.fen.c_str());
+        return 1;
+    }
+    std::istringstream in(opt.moves);
+    std::string token;
+    while (in >> token) {
+        Move m = parseSan(pos, token);
+        if (!m) m = parseLan(pos, token);
+        if (!m) {
+            std::fprintf(stderr, "illegal move %s\n", token.c_str());
+            return 1;
+        }
+        UndoInfo undo;
+        pos.makeMove(m, undo);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ExplorerMove> moves = index.explore(pos);
+    std::vector<PositionEntry> found = index.find(pos.key(), (size_t)opt.games);
+    uint64_t total = index.count(pos.key());
+    double lookupMs = secondsSince(start) * 1000;
+
+    std::printf("%s\nreached %llu times (%.2f ms)\n\n", pos.fen().c_str(), (unsigned long long)total, lookupMs);
+    std::printf("%-8s %9s %7s %7s %7s\n", "move", "games", "white", "draw", "black");
+    for (const ExplorerMove& m : moves) {
+        double n = (double)m.games;
+        std::printf("%-8s %9llu %6.1f%% %6.1f%% %6.1f%%\n", toSan(pos, m.move).c_str(), (unsigned long long)m.games,
+                    100 * m.whiteWins / n, 100 * m.draws / n, 100 * m.blackWins / n);
+    }
+
+    std::printf("\n");
+    for (const PositionEntry& e : found) {
+        PgnGame game;
+        if (!archive.readGame(e.game, game)) continue;
+        const std::string* white = game.tag("White");
+        const std::string* black = game.tag("Black");
+        std::printf("#%u ply %u  %s - %s  %s\n", e.game, e.ply, white ? white->c_str() : "?",
+                    black ? black->c_str() : "?",
+                    game.result == kPgnWhiteWins ? "1-0" : game.result == kPgnBlackWins ? "0-1" : game.result == kPgnDraw ? "1/2-1/2" : "*");
+    }
+    return 0;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 4) return false;
+    opt.command = argv[1];
+    opt.build.threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            opt.paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--plies") opt.build.maxPlies = std::max(0, std::atoi(value));
+        else if (arg == "--memory") opt.build.memoryBytes = (size_t)std::max(1, std::atoi(value)) << 20;
+        else if (arg == "--threads") opt.build.threads = std::max(1, std::atoi(value));
+        else if (arg == "--fen") opt.fen = value;
+        else if (arg == "--moves") opt.moves = value;
+        else if (arg == "--games") opt.games = std::max(0, std::atoi(value));
+        else return false;
+    }
+    return (opt.command == "build" || opt.command == "query") && opt.paths.size() == 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: position_index build <archive.gar> <out.idx> [--plies N] [--memory MB] [--threads N]\n"
+                             "       position_index query <index.idx> <archive.gar> [--fen FEN] [--moves \"e4 e5\"] [--games N]\n");
+        return 1;
+    }
+    return opt.command == "build" ? build(opt) : query(opt);
+}
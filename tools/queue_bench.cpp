@@ -0,0 +1,186 @@
+//
+// queue_bench: micro-benchmark for the lock-free queues in LockFreeQueue.h
+//
+// for 1..N producers it measures saturated throughput and the latency from
+// push to pop of paced messages (each producer waits --gap ns between
+// pushes), for SpscQueue, MpscQueue and a mutex protected std::deque
+//
+//   queue_bench [--messages N] [--producers N] [--gap NS] [--capacity N]
+//
+
+#include "../classes/LockFreeQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    uint64_t messages = 2000000;
+    int producers = (int)std::max(2u, std::thread::hardware_concurrency()) - 1;
+    int64_t gapNs = 2000;
+    size_t capacity = 4096;
+};
+
+struct Message
+{
+    int64_t stampNs = 0;
+};
+
+int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the baseline the lock-free queues replace
+class MutexQueue
+{
+public:
+    explicit MutexQueue(size_t capacity) : _capacity(capacity) {}
+
+    bool push(const Message& m)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_items.size() >= _capacity) return false;
+        _items.push_back(m);
+        return true;
+    }
+
+    bool pop(Message& m)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_items.empty()) return false;
+        m = _items.front();
+        _items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex _mutex;
+    std::deque<Message> _items;
+    size_t _capacity;
+};
+
+struct RunResult
+{
+    double messagesPerSecond = 0;
+    int64_t p50 = 0;
+    int64_t p99 = 0;
+    int64_t p999 = 0;
+    int64_t max = 0;
+};
+
+//
+// producers push messages / producers each, retrying while the queue is full;
+// with gapNs > 0 they busy-wait between pushes so the queue stays short and
+// the latency measured is the cost of the hand-over, not time spent queued
+//
+template <typename Queue>
+RunResult run(Queue& queue, int producers, uint64_t messages, int64_t gapNs)
+{
+    uint64_t perProducer = messages / (uint64_t)producers;
+    uint64_t total = perProducer * (uint64_t)producers;
+    std::vector<int64_t> latencies;
+    latencies.reserve(total);
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&]() {
+            while (!go.load(std::memory_order_acquire)) {}
+            int64_t next = nowNs();
+            for (uint64_t i = 0; i < perProducer; i++) {
+                if (gapNs > 0) {
+                    while (nowNs() < next) {}
+                    next += gapNs;
+                }
+                Message m;
+                m.stampNs = nowNs();
+                while (!queue.push(m)) std::this_thread::yield();
+            }
+        });
+    }
+
+    int64_t start = nowNs();
+    go.store(true, std::memory_order_release);
+    Message m;
+    while (latencies.size() < total) {
+        if (queue.pop(m)) latencies.push_back(nowNs() - m.stampNs);
+    }
+    int64_t elapsed = nowNs() - start;
+    for (auto& t : threads) t.join();
+
+    RunResult result;
+    result.messagesPerSecond = (double)total * 1e9 / (double)std::max<int64_t>(1, elapsed);
+    std::sort(latencies.begin(), latencies.end());
+    result.p50 = latencies[total / 2];
+    result.p99 = latencies[total * 99 / 100];
+    result.p999 = latencies[total * 999 / 1000];
+    result.max = latencies.back();
+    return result;
+}
+
+template <typename Queue>
+void report(const char* name, int producers, const Options& opt)
+{
+    Queue saturated(opt.capacity);
+    RunResult full = run(saturated, producers, opt.messages, 0);
+    // paced runs are slower per message, keep them short
+    Queue paced(opt.capacity);
+    RunResult latency = run(paced, producers, std::min<uint64_t>(opt.messages, 200000), opt.gapNs);
+
+    std::printf("%-6s %9d %12.2f %9lld %9lld %9lld %10lld\n", name, producers, full.messagesPerSecond / 1e6,
+                (long long)latency.p50, (long long)latency.p99, (long long)latency.p999, (long long)latency.max);
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--messages") opt.messages = std::strtoull(value, nullptr, 10);
+        else if (arg == "--producers") opt.producers = std::atoi(value);
+        else if (arg == "--gap") opt.gapNs = std::atoll(value);
+        else if (arg == "--capacity") opt.capacity = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return opt.messages > 0 && opt.producers > 0 && opt.capacity > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: queue_bench [--messages N] [--producers N] [--gap NS] [--capacity N]\n");
+        return 1;
+    }
+
+    std::printf("%llu messages, capacity %zu, latency paced at one message per %lld ns per producer\n",
+                (unsigned long long)opt.messages, opt.capacity, (long long)opt.gapNs);
+    std::printf("%-6s %9s %12s %9s %9s %9s %10s\n", "queue", "producers", "Mmsg/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+
+    report<SpscQueue<Message>>("spsc", 1, opt);
+    // powers of two up to the requested count, then the count itself
+    std::vector<int> counts;
+    for (int producers = 1; producers < opt.producers; producers *= 2) counts.push_back(producers);
+    counts.push_back(opt.producers);
+    for (int producers : counts) {
+        report<MpscQueue<Message>>("mpsc", producers, opt);
+        report<MutexQueue>("mutex", producers, opt);
+    }
+    return 0;
+}
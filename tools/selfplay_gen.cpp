@@ -0,0 +1,251 @@
+//
+// selfplay_gen: headless self-play training data generator
+//
+// plays fixed-node games on every core, keeps quiet positions with their
+// search score and the final game result, drops duplicates by zobrist key
+// and appends 32 byte PackedPosition records to the output file
+//
+//   selfplay_gen <out.bin> [--games N] [--nodes N] [--threads N]
+//                [--random-plies N] [--seed N]
+//
+
+#include "../classes/KeyHistory.h"
+#include "../classes/PackedPosition.h"
+#include "../classes/Position.h"
+#include "../classes/Search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kMaxGamePlies = 400;
+constexpr size_t kFlushEvery = 4096;
+
+struct Options
+{
+    std::string outPath;
+    int games = 1000;
+    uint64_t nodes = 5000;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int randomPlies = 8;
+    uint64_t seed = 1;
+};
+
+//
+// lock-free set of zobrist keys shared by all threads, open addressing
+// with a short probe; when a run of slots is full the position is kept
+//
+class KeySet
+{
+public:
+    explicit KeySet(size_t log2Size) : _slots(size_t(1) << log2Size), _mask((size_t(1) << log2Size) - 1)
+    {
+        for (auto& s : _slots) s.store(0, std::memory_order_relaxed);
+    }
+
+    // true if the key was not in the set yet
+    bool insert(uint64_t key)
+    {
+        if (!key) key = 1;
+        for (size_t i = 0; i < 16; i++) {
+            auto& slot = _slots[(key + i) & _mask];
+            uint64_t current = slot.load(std::memory_order_relaxed);
+            if (current == key) return false;
+            if (current == 0) {
+                if (slot.compare_exchange_strong(current, key, std::memory_order_relaxed)) return true;
+                if (current == key) return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::atomic<uint64_t>> _slots;
+    size_t _mask;
+};
+
+struct Shared
+{
+    Options options;
+    KeySet keys{22};
+    std::atomic<int> nextGame{0};
+    std::atomic<uint64_t> gamesDone{0};
+    std::atomic<uint64_t> positionsWritten{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::mutex fileMutex;
+};
+
+struct GameSample
+{
+    TrainingSample sample;
+    uint64_t key;
+};
+
+TrainingSample sampleFrom(const Position& pos, int score, Move move)
+{
+    TrainingSample s;
+    std::memcpy(s.board, pos.board(), 64);
+    s.whiteToMove = pos.whiteToMove();
+    s.castling = pos.castling();
+    s.epSquare = (uint8_t)pos.epSquare();
+    s.halfmoveClock = (uint8_t)std::min(pos.halfmoveClock(), 255);
+    s.score = (int16_t)std::clamp(score, -32000, 32000);
+    s.result = 0;
+    s.move = move.raw();
+    return s;
+}
+
+// plays one game, returns the kept samples with results filled in
+std::vector<GameSample> playGame(Search& search, TranspositionTable& tt, std::mt19937_64& rng, const Options& opt)
+{
+    Position pos;
+    std::vector<GameSample> samples;
+    KeyHistory history;
+
+    // random opening for variety, restart if it ran into a finished game
+    for (int ply = 0; ply < opt.randomPlies; ply++) {
+        MoveList legal;
+        pos.generateLegalMoves(legal);
+        if (legal.empty()) {
+            pos.setFen(kStartFen);
+            ply = -1;
+            continue;
+        }
+        UndoInfo undo;
+        pos.makeMove(legal[(int)(rng() % legal.size())], undo);
+    }
+
+    int whiteResult = 0;
+    SearchLimits limits;
+    limits.nodes = opt.nodes;
+
+    for (int ply = 0; ply < kMaxGamePlies; ply++) {
+        MoveList legal;
+        pos.generateLegalMoves(legal);
+        if (legal.empty()) {
+            if (pos.inCheck()) whiteResult = pos.whiteToMove() ? -1 : 1;
+            break;
+        }
+        // the engine's own draw rules, so adjudication agrees with the search
+        if (pos.halfmoveClock() >= 100 || pos.insufficientMaterial() ||
+            history.repetitions(pos.key(), pos.halfmoveClock()) >= 2) {
+            break;
+        }
+
+        tt.newSearch();
+        search.setGameHistory(history);
+        SearchResult r = search.think(pos, limits);
+        bool quiet = !r.bestMove.isCapture() && !r.bestMove.isPromotion();
+        if (quiet && !pos.inCheck() && std::abs(r.score) < kMateBound) {
+            samples.push_back({ sampleFrom(pos, r.score, r.bestMove), pos.key() });
+        }
+
+        history.push(pos.key());
+        UndoInfo undo;
+        pos.makeMove(r.bestMove, undo);
+    }
+
+    for (GameSample& s : samples) {
+        s.sample.result = (int8_t)(s.sample.whiteToMove ? whiteResult : -whiteResult);
+    }
+    return samples;
+}
+
+void worker(Shared& shared, int threadIndex)
+{
+    const Options& opt = shared.options;
+    TranspositionTable tt(16);
+    Search search(tt);
+    std::mt19937_64 rng(opt.seed * 1000003 + threadIndex);
+    std::vector<PackedPosition> buffer;
+
+    auto flush = [&]() {
+        if (buffer.empty()) return;
+        std::lock_guard<std::mutex> lock(shared.fileMutex);
+        appendPackedPositions(opt.outPath, buffer);
+        shared.positionsWritten += buffer.size();
+        buffer.clear();
+    };
+
+    while (shared.nextGame.fetch_add(1) < opt.games) {
+        tt.clear();
+        for (const GameSample& s : playGame(search, tt, rng, opt)) {
+            if (!shared.keys.insert(s.key)) {
+                shared.duplicates++;
+                continue;
+            }
+            buffer.push_back(PackedPosition::pack(s.sample));
+        }
+        shared.gamesDone++;
+        if (buffer.size() >= kFlushEvery) flush();
+    }
+    flush();
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 2) return false;
+    opt.outPath = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        const char* value = argv[i + 1];
+        if (key == "--games") opt.games = std::atoi(value);
+        else if (key == "--nodes") opt.nodes = std::strtoull(value, nullptr, 10);
+        else if (key == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else if (key == "--random-plies") opt.randomPlies = std::max(0, std::atoi(value));
+        else if (key == "--seed") opt.seed = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return opt.games > 0 && opt.nodes > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Shared shared;
+    if (!parseOptions(argc, argv, shared.options)) {
+        std::fprintf(stderr, "usage: selfplay_gen <out.bin> [--games N] [--nodes N] [--threads N] [--random-plies N] [--seed N]\n");
+        return 1;
+    }
+    const Options& opt = shared.options;
+
+    // start from an empty file, workers append
+    if (!std::ofstream(opt.outPath, std::ios::binary | std::ios::trunc)) {
+        std::fprintf(stderr, "could not write %s\n", opt.outPath.c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; t++) {
+        threads.emplace_back(worker, std::ref(shared), t);
+    }
+
+    while (shared.gamesDone.load() < (uint64_t)opt.games) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("\rgames %llu/%d  positions %llu  %.0f pos/s   ",
+                    (unsigned long long)shared.gamesDone.load(), opt.games,
+                    (unsigned long long)shared.positionsWritten.load(), shared.positionsWritten.load() / seconds);
+        std::fflush(stdout);
+    }
+    for (auto& t : threads) t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("\n%llu positions written, %llu duplicates dropped, %.1f s\n",
+                (unsigned long long)shared.positionsWritten.load(),
+                (unsigned long long)shared.duplicates.load(), seconds);
+    return 0;
+}
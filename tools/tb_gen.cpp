@@ -0,0 +1,436 @@
+//
+// tb_gen: build endgame tables by retrograde analysis and look positions up
+//
+//   tb_gen generate <dir> <KRvK> [more ...] [--threads N]
+//   tb_gen probe <dir> <fen>
+//   tb_gen export <dir> <KRvK> [more ...] [--threads N]
+//   tb_gen syzygy <dir> <fen>
+//
+// generate writes <dir>/<name>.ctb for each balance and every smaller one it
+// converts into, skipping tables already in the directory. probe prints the
+// distance to mate and, for a won or lost position, the line to mate
+//
+// export writes a three piece table without pawns as <dir>/<name>.rtbw and
+// .rtbz in the Syzygy layout and reads every position back through the
+// Syzygy prober. syzygy probes the Syzygy files in the directory the way the
+// engine does: win/draw/loss, DTZ and the root moves it would keep
+//
+
+#include "../classes/Notation.h"
+#include "../classes/Syzygy.h"
+#include "../classes/Tablebase.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    std::string command;
+    std::vector<std::string> args;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+};
+
+std::string describe(const TbProbe& result)
+{
+    if (result.wdl == 0) return "draw";
+    return std::string(result.wdl > 0 ? "win" : "loss") + " in " + std::to_string(result.dtm) + " plies";
+}
+
+int generate(const Options& opt)
+{
+    TbGenerateOptions generate;
+    generate.threads = opt.threads;
+    generate.directory = opt.args[0];
+    generate.onTable = [](const EndgameTable& table, bool generated, double seconds) {
+        if (generated) {
+            std::printf("%-8s %12llu positions, longest mate %3d plies, %.1f s\n", table.name().c_str(),
+                        (unsigned long long)table.positions() * 2, table.longestMate(), seconds);
+        } else {
+            std::printf("%-8s already built\n", table.name().c_str());
+        }
+        std::fflush(stdout);
+    };
+    for (size_t i = 1; i < opt.args.size(); i++) {
+        if (!generateTablebase(opt.args[i], generate)) {
+            std::fprintf(stderr, "could not build %s in %s\n", opt.args[i].c_str(), opt.args[0].c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int probe(const Options& opt)
+{
+    Tablebases tables;
+    if (tables.open(opt.args[0]) == 0) {
+        std::fprintf(stderr, "no tables in %s\n", opt.args[0].c_str());
+        return 1;
+    }
+    Position pos;
+    if (!pos.setFen(opt.args[1])) {
+        std::fprintf(stderr, "bad fen %s\n", opt.args[1].c_str());
+        return 1;
+    }
+    TbProbe result;
+    if (!tables.probe(pos, result)) {
+        std::fprintf(stderr, "no table for %s\n", pos.fen().c_str());
+        return 1;
+    }
+    std::printf("%s: %s\n", EndgameTable::materialName(pos).c_str(), describe(result).c_str());
+    if (result.wdl == 0) return 0;
+
+    std::string line;
+    for (int ply = 0; ply < result.dtm; ply++) {
+        Move best = tables.bestMove(pos);
+        if (!best) break;
+        if (pos.whiteToMove() || line.empty()) {
+            line += std::to_string(pos.fullmoveNumber()) + (pos.whiteToMove() ? ". " : "... ");
+        }
+        line += toSan(pos, best) + " ";
+        UndoInfo undo;
+        pos.makeMove(best, undo);
+    }
+    std::printf("%s\n", line.c_str());
+    return 0;
+}
+
+//
+// Syzygy export
+//
+// the Syzygy index of three pieces without pawns: the first piece in the
+// a1-d1-d4 triangle and the first one off the a1-h8 diagonal below it, in
+// four ranges (first piece off the diagonal, only the first on it, the first
+// two, all three). this decodes an index the other way round from the
+// prober, so the two check each other. a winner with nothing to capture
+// only zeroes the 50 move counter by mating, so DTZ is the distance to mate
+//
+
+constexpr uint8_t kWdlMagic[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+constexpr uint8_t kDtzMagic[4] = { 0x71, 0xE8, 0x23, 0x5D };
+constexpr uint8_t kSplitFlag = 1;           // file flag: the two sides to move are stored apart
+constexpr uint8_t kPliesFlags = 4 | 8;      // part flags: wins and losses counted in plies
+constexpr int kBlockBits = 6;               // 64 byte blocks
+constexpr int kSpanBits = 10;               // a sparse index entry every 1024 values
+constexpr uint64_t kTripleCount = 31332;
+
+// the s-th square not taken by a or b, for a piece placed after them
+int skipPast(int s, int a, int b)
+{
+    if (s >= std::min(a, b)) s++;
+    if (s >= std::max(a, b)) s++;
+    return s;
+}
+
+void tripleSquares(uint64_t idx, int squares[3])
+{
+    static const int kTriangle[6] = { 1, 2, 3, 10, 11, 19 };   // b1 c1 d1 c2 d2 d3
+    int below[28], count = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if ((sq >> 3) < (sq & 7)) below[count++] = sq;
+    }
+
+    if (idx < 6 * 63 * 62) {
+        squares[0] = kTriangle[idx / (63 * 62)];
+        int second = (int)(idx / 62 % 63);
+        squares[1] = second + (second >= squares[0]);
+        squares[2] = skipPast((int)(idx % 62), squares[0], squares[1]);
+        return;
+    }
+    idx -= 6 * 63 * 62;
+    if (idx < 4 * 28 * 62) {
+        squares[0] = 9 * (int)(idx / (28 * 62));
+        squares[1] = below[idx / 62 % 28];
+        squares[2] = skipPast((int)(idx % 62), squares[0], squares[1]);
+        return;
+    }
+    idx -= 4 * 28 * 62;
+    int first = (int)(idx / (7 * 28));
+    int second = (int)(idx / 28 % 7);
+    second += second >= first;
+    squares[0] = 9 * first;
+    squares[1] = 9 * second;
+    if (idx < 4 * 7 * 28) {
+        squares[2] = below[idx % 28];
+        return;
+    }
+    idx -= 4 * 7 * 28;
+    first = (int)(idx / (7 * 6));
+    second = (int)(idx / 6 % 7);
+    second += second >= first;
+    squares[0] = 9 * first;
+    squares[1] = 9 * second;
+    squares[2] = 9 * skipPast((int)(idx % 6), first, second);
+}
+
+void putLe16(std::vector<uint8_t>& out, uint32_t v)
+{
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+void putLe32(std::vector<uint8_t>& out, uint32_t v)
+{
+    putLe16(out, v & 0xFFFF);
+    putLe16(out, v >> 16);
+}
+
+// one side's values, packed as one symbol per distinct value with codes of
+// equal length: a canonical Huffman code with no pairs to expand
+struct SyzygyPart
+{
+    std::vector<uint8_t> sizes, sparseIndex, blockLength, blocks;
+};
+
+SyzygyPart packPart(const std::vector<int>& values, uint8_t flags)
+{
+    std::vector<int> symbols = values;
+    std::sort(symbols.begin(), symbols.end());
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+    int bits = 1;
+    while ((1u << bits) < symbols.size()) bits++;
+    size_t perBlock = (8u << kBlockBits) / bits;
+    uint32_t blockCount = (uint32_t)((values.size() + perBlock - 1) / perBlock);
+
+    SyzygyPart part;
+    part.sizes = { flags, (uint8_t)kBlockBits, (uint8_t)kSpanBits, 0 };
+    putLe32(part.sizes, blockCount);
+    part.sizes.push_back((uint8_t)bits);
+    part.sizes.push_back((uint8_t)bits);
+    putLe16(part.sizes, 0);                 // lowest symbol of the one code length
+    putLe16(part.sizes, (uint32_t)symbols.size());
+    for (int value : symbols) {
+        // left child the value, right child 0xFFF marks a leaf
+        part.sizes.push_back((uint8_t)value);
+        part.sizes.push_back((uint8_t)(((value >> 8) & 0xF) | 0xF0));
+        part.sizes.push_back(0xFF);
+    }
+    if (symbols.size() & 1) part.sizes.push_back(0);
+
+    for (uint32_t block = 0; block < blockCount; block++) {
+        size_t inBlock = std::min(perBlock, values.size() - block * perBlock);
+        putLe16(part.blockLength, (uint32_t)inBlock - 1);
+    }
+
+    // entry k locates the value at k * span + span / 2; past the end the
+    // last block is named and the prober walks back from there
+    size_t span = (size_t)1 << kSpanBits;
+    for (size_t k = 0; k < (values.size() + span - 1) / span; k++) {
+        size_t at = k * span + span / 2;
+        uint32_t block = (uint32_t)std::min<size_t>(at / perBlock, blockCount - 1);
+        putLe32(part.sparseIndex, block);
+        putLe16(part.sparseIndex, (uint32_t)(at - block * perBlock));
+    }
+
+    part.blocks.assign((size_t)blockCount << kBlockBits, 0);
+    for (size_t i = 0; i < values.size(); i++) {
+        int code = (int)(std::lower_bound(symbols.begin(), symbols.end(), values[i]) - symbols.begin());
+        size_t bit = (i / perBlock << kBlockBits) * 8 + i % perBlock * bits;
+        for (int b = bits - 1; b >= 0; b--, bit++) {
+            if (code >> b & 1) part.blocks[bit / 8] |= (uint8_t)(0x80 >> (bit % 8));
+        }
+    }
+    return part;
+}
+
+bool writeSyzygyFile(const std::string& path, const uint8_t (&magic)[4], const uint8_t pieces[3],
+                     const std::vector<SyzygyPart>& parts)
+{
+    std::vector<uint8_t> out(magic, magic + 4);
+    out.push_back(parts.size() == 2 ? kSplitFlag : 0);
+    out.push_back(0);                       // the three pieces are the first group for either side
+    for (int i = 0; i < 3; i++) out.push_back((uint8_t)(pieces[i] | pieces[i] << 4));
+    if (out.size() & 1) out.push_back(0);
+    for (const SyzygyPart& part : parts) out.insert(out.end(), part.sizes.begin(), part.sizes.end());
+    for (const SyzygyPart& part : parts) out.insert(out.end(), part.sparseIndex.begin(), part.sparseIndex.end());
+    for (const SyzygyPart& part : parts) out.insert(out.end(), part.blockLength.begin(), part.blockLength.end());
+    for (const SyzygyPart& part : parts) {
+        out.resize((out.size() + 63) & ~(size_t)63, 0);
+        out.insert(out.end(), part.blocks.begin(), part.blocks.end());
+    }
+    // Syzygy files end in a 16 byte checksum, which the prober checks the size for
+    out.resize(((out.size() + 63) & ~(size_t)63) + 16, 0);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)out.data(), (std::streamsize)out.size());
+    return (bool)file;
+}
+
+// the same position with the colours swapped
+bool colourFlipped(const Position& pos, Position& flipped)
+{
+    uint8_t board[64] = {};
+    for (int sq = 0; sq < 64; sq++) {
+        uint8_t tag = pos.pieceOn(sq);
+        if (tag) board[sq ^ 56] = pieceTag(tagColour(tag) ^ 1, tagPiece(tag));
+    }
+    return flipped.setBoard(board, !pos.whiteToMove(), 0, kNoSquare);
+}
+
+int syzygyDtz(const TbProbe& result)
+{
+    return result.wdl > 0 ? result.dtm : result.wdl < 0 ? -std::max(result.dtm, 1) : 0;
+}
+
+bool exportTable(const std::string& directory, const EndgameTable& table, const Tablebases& tables)
+{
+    const std::string& name = table.name();
+    ChessPiece extra = (ChessPiece)(std::strchr("PNBRQ", name[1]) - "PNBRQ" + Pawn);
+    const uint8_t pieces[3] = { King, (uint8_t)extra, King | 8 };     // Syzygy codes, + 8 for black
+
+    std::vector<int> wdl[2], dtz(kTripleCount, 0);
+    for (int stm = White; stm <= Black; stm++) {
+        wdl[stm].assign(kTripleCount, 2);   // illegal placements read as draws
+        for (uint64_t idx = 0; idx < kTripleCount; idx++) {
+            int squares[3];
+            tripleSquares(idx, squares);
+            uint8_t board[64] = {};
+            board[squares[0]] = pieceTag(White, King);
+            board[squares[1]] = pieceTag(White, extra);
+            board[squares[2]] = pieceTag(Black, King);
+            Position pos;
+            TbProbe result;
+            if (!pos.setBoard(board, stm == White, 0, kNoSquare) || !tables.probe(pos, result)) continue;
+            wdl[stm][idx] = 2 * result.wdl + 2;
+            // only white to move is stored, the prober searches a ply for black
+            if (stm == White && result.wdl > 0) dtz[idx] = syzygyDtz(result) - 1;
+        }
+    }
+
+    std::filesystem::path base = std::filesystem::path(directory) / name;
+    if (!writeSyzygyFile(base.string() + ".rtbw", kWdlMagic, pieces,
+                         { packPart(wdl[White], 0), packPart(wdl[Black], 0) }) ||
+        !writeSyzygyFile(base.string() + ".rtbz", kDtzMagic, pieces, { packPart(dtz, kPliesFlags) })) {
+        std::fprintf(stderr, "could not write %s\n", base.string().c_str());
+        return false;
+    }
+
+    // every position of the table, and each with the colours swapped
+    SyzygyTablebases syzygy;
+    syzygy.open(directory);
+    uint64_t checked = 0;
+    for (int stm = White; stm <= Black; stm++) {
+        for (uint64_t index = 0; index < table.positions(); index++) {
+            Position pos, flipped;
+            TbProbe expected;
+            if (!table.position(index, stm, pos) || !tables.probe(pos, expected) || !colourFlipped(pos, flipped)) continue;
+            for (const Position* p : { &pos, &flipped }) {
+                int gotWdl, gotDtz;
+                if (!syzygy.probeWdl(*p, gotWdl) || !syzygy.probeDtz(*p, gotDtz) || gotWdl != 2 * expected.wdl ||
+                    gotDtz != syzygyDtz(expected)) {
+                    std::fprintf(stderr, "%s: %s reads back wrong\n", name.c_str(), p->fen().c_str());
+                    return false;
+                }
+                checked++;
+            }
+        }
+    }
+    std::printf("%-8s %s.rtbw and .rtbz, %llu positions read back\n", name.c_str(), name.c_str(),
+                (unsigned long long)checked);
+    std::fflush(stdout);
+    return true;
+}
+
+int exportSyzygy(const Options& opt)
+{
+    TbGenerateOptions generate;
+    generate.threads = opt.threads;
+    generate.directory = opt.args[0];
+    for (size_t i = 1; i < opt.args.size(); i++) {
+        EndgameTable material;
+        if (!material.setMaterial(opt.args[i]) || material.pieceCount() != 3 ||
+            material.name().find('P') != std::string::npos) {
+            std::fprintf(stderr, "%s: only three piece tables without pawns can be exported\n", opt.args[i].c_str());
+            return 1;
+        }
+        if (!generateTablebase(material.name(), generate)) {
+            std::fprintf(stderr, "could not build %s in %s\n", material.name().c_str(), opt.args[0].c_str());
+            return 1;
+        }
+    }
+
+    Tablebases tables;
+    tables.open(opt.args[0]);
+    for (size_t i = 1; i < opt.args.size(); i++) {
+        EndgameTable material;
+        material.setMaterial(opt.args[i]);
+        const EndgameTable* table = tables.find(material.name());
+        if (!table || !exportTable(opt.args[0], *table, tables)) return 1;
+    }
+    return 0;
+}
+
+int probeSyzygy(const Options& opt)
+{
+    SyzygyTablebases syzygy;
+    if (syzygy.open(opt.args[0]) == 0) {
+        std::fprintf(stderr, "no syzygy tables in %s\n", opt.args[0].c_str());
+        return 1;
+    }
+    Position pos;
+    if (!pos.setFen(opt.args[1])) {
+        std::fprintf(stderr, "bad fen %s\n", opt.args[1].c_str());
+        return 1;
+    }
+    int wdl, dtz;
+    if (!syzygy.probeWdl(pos, wdl) || !syzygy.probeDtz(pos, dtz)) {
+        std::fprintf(stderr, "no syzygy table for %s\n", pos.fen().c_str());
+        return 1;
+    }
+    static const char* kWdlNames[] = { "loss", "blessed loss", "draw", "cursed win", "win" };
+    std::vector<Move> best;
+    syzygy.rankRootMoves(pos, best);
+    std::vector<std::string> moves;
+    for (Move m : best) moves.push_back(m.toUci());
+    std::sort(moves.begin(), moves.end());
+    std::string line;
+    for (const std::string& m : moves) line += " " + m;
+    std::printf("%s: %s, dtz %d, best%s\n", EndgameTable::materialName(pos).c_str(), kWdlNames[wdl + 2], dtz,
+                line.empty() ? " none" : line.c_str());
+    return 0;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 4) return false;
+    opt.command = argv[1];
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            opt.args.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else return false;
+    }
+    if (opt.command == "generate" || opt.command == "export") return opt.args.size() >= 2;
+    if (opt.command == "probe" || opt.command == "syzygy") return opt.args.size() == 2;
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: tb_gen generate <dir> <KRvK> [more ...] [--threads N]\n"
+                             "       tb_gen probe <dir> <fen>\n"
+                             "       tb_gen export <dir> <KRvK> [more ...] [--threads N]\n"
+                             "       tb_gen syzygy <dir> <fen>\n");
+        return 1;
+    }
+    if (opt.command == "generate") return generate(opt);
+    if (opt.command == "export") return exportSyzygy(opt);
+    return opt.command == "syzygy" ? probeSyzygy(opt) : probe(opt);
+}
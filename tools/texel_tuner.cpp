@@ -0,0 +1,383 @@
+//
+// texel_tuner: fits the weights in EvalParams.h to game results
+//
+// every position is first resolved with a quiescence search, the quiet leaf
+// is reduced to a sparse list of (weight, count) coefficients stored in flat
+// structure-of-arrays buffers, and the mean squared error between the game
+// result and sigmoid(K * eval) is minimised with Adam, the gradient being
+// summed over all positions on all cores
+//
+//   texel_tuner <out EvalParams.h> <data.bin> [more.bin ...]
+//               [--iterations N] [--threads N] [--lr F]
+//
+
+#include "../classes/EvalParams.h"
+#include "../classes/Evaluate.h"
+#include "../classes/PackedPosition.h"
+#include "../classes/Search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//
+// weight layout: material for pawn..queen, then a 64 entry table per piece
+// (king included), then the bishop pair; each weight has a mg and an eg half
+//
+constexpr int kMaterialBase = 0;
+constexpr int kPstBase = 5;
+constexpr int kBishopPairIndex = kPstBase + 6 * 64;
+constexpr int kNumWeights = kBishopPairIndex + 1;
+
+struct Options
+{
+    std::string outPath;
+    std::vector<std::string> dataPaths;
+    int iterations = 1000;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    double learningRate = 1.0;
+};
+
+//
+// all positions in structure-of-arrays form, coefficients for position i
+// are index/coeff[begin[i] .. begin[i + 1])
+//
+struct TuningSet
+{
+    std::vector<float>    result;     // 1 white win, 0.5 draw, 0 black win
+    std::vector<float>    phase;      // middlegame share, 0..1
+    std::vector<uint32_t> begin;
+    std::vector<uint16_t> index;
+    std::vector<int8_t>   coeff;
+
+    size_t size() const { return result.size(); }
+};
+
+struct Weights
+{
+    double mg[kNumWeights];
+    double eg[kNumWeights];
+};
+
+void loadCurrentWeights(Weights& w)
+{
+    for (int piece = Pawn; piece <= Queen; piece++) {
+        w.mg[kMaterialBase + piece - 1] = kPieceValueMg[piece];
+        w.eg[kMaterialBase + piece - 1] = kPieceValueEg[piece];
+    }
+    for (int piece = Pawn; piece <= King; piece++) {
+        for (int sq = 0; sq < 64; sq++) {
+            w.mg[kPstBase + (piece - 1) * 64 + sq] = kPstMg[piece][sq];
+            w.eg[kPstBase + (piece - 1) * 64 + sq] = kPstEg[piece][sq];
+        }
+    }
+    w.mg[kBishopPairIndex] = kBishopPairMg;
+    w.eg[kBishopPairIndex] = kBishopPairEg;
+}
+
+// same terms as evaluate(), white's point of view
+void extractCoefficients(const Position& pos, int counts[kNumWeights])
+{
+    std::fill(counts, counts + kNumWeights, 0);
+    for (int colour = White; colour <= Black; colour++) {
+        int sign = colour == White ? 1 : -1;
+        int flip = colour == White ? 56 : 0;
+        for (int piece = Pawn; piece <= King; piece++) {
+            uint64_t bb = pos.pieces(colour, (ChessPiece)piece);
+            while (bb) {
+                int sq = popLsb(bb) ^ flip;
+                if (piece != King) counts[kMaterialBase + piece - 1] += sign;
+                counts[kPstBase + (piece - 1) * 64 + sq] += sign;
+            }
+        }
+        if (popCount(pos.pieces(colour, Bishop)) >= 2) counts[kBishopPairIndex] += sign;
+    }
+}
+
+// resolve captures and append the quiet leaves of [from, to) to a thread-local set
+void buildRange(const std::vector<PackedPosition>& data, size_t from, size_t to, TuningSet& out)
+{
+    TranspositionTable tt(1);
+    Search search(tt);
+    int counts[kNumWeights];
+
+    for (size_t i = from; i < to; i++) {
+        TrainingSample s = data[i].unpack();
+        Position pos;
+        if (!pos.setBoard(s.board, s.whiteToMove, s.castling, s.epSquare, s.halfmoveClock)) continue;
+
+        SearchResult q = search.quiescence(pos);
+        std::vector<UndoInfo> undo(q.pv.size());
+        for (size_t m = 0; m < q.pv.size(); m++) pos.makeMove(q.pv[m], undo[m]);
+
+        extractCoefficients(pos, counts);
+        int whiteResult = s.whiteToMove ? s.result : -s.result;
+        out.result.push_back((whiteResult + 1) * 0.5f);
+        out.phase.push_back((float)gamePhase(pos) / kMaxPhase);
+        out.begin.push_back((uint32_t)out.index.size());
+        for (int w = 0; w < kNumWeights; w++) {
+            if (!counts[w]) continue;
+            out.index.push_back((uint16_t)w);
+            out.coeff.push_back((int8_t)counts[w]);
+        }
+    }
+}
+
+TuningSet buildTuningSet(const std::vector<PackedPosition>& data, int threads)
+{
+    std::vector<TuningSet> parts(threads);
+    std::vector<std::thread> workers;
+    size_t perThread = (data.size() + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        size_t from = std::min(data.size(), t * perThread);
+        size_t to = std::min(data.size(), from + perThread);
+        workers.emplace_back(buildRange, std::cref(data), from, to, std::ref(parts[t]));
+    }
+    for (auto& w : workers) w.join();
+
+    TuningSet set;
+    for (TuningSet& part : parts) {
+        uint32_t offset = (uint32_t)set.index.size();
+        set.result.insert(set.result.end(), part.result.begin(), part.result.end());
+        set.phase.insert(set.phase.end(), part.phase.begin(), part.phase.end());
+        for (uint32_t b : part.begin) set.begin.push_back(b + offset);
+        set.index.insert(set.index.end(), part.index.begin(), part.index.end());
+        set.coeff.insert(set.coeff.end(), part.coeff.begin(), part.coeff.end());
+    }
+    set.begin.push_back((uint32_t)set.index.size());
+    return set;
+}
+
+inline double linearEval(const TuningSet& set, size_t i, const Weights& w)
+{
+    double mg = 0.0, eg = 0.0;
+    for (uint32_t c = set.begin[i]; c < set.begin[i + 1]; c++) {
+        mg += set.coeff[c] * w.mg[set.index[c]];
+        eg += set.coeff[c] * w.eg[set.index[c]];
+    }
+    return mg * set.phase[i] + eg * (1.0 - set.phase[i]);
+}
+
+inline double sigmoid(double k, double eval)
+{
+    return 1.0 / (1.0 + std::exp(-k * eval / 400.0));
+}
+
+//
+// runs fn(from, to, threadIndex) over slices of the set on every thread
+//
+template <typename Func>
+void parallelFor(size_t count, int threads, Func fn)
+{
+    std::vector<std::thread> workers;
+    size_t perThread = (count + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        size_t from = std::min(count, t * perThread);
+        size_t to = std::min(count, from + perThread);
+        workers.emplace_back(fn, from, to, t);
+    }
+    for (auto& w : workers) w.join();
+}
+
+double meanError(const TuningSet& set, const Weights& w, double k, int threads)
+{
+    std::vector<double> sums(threads, 0.0);
+    parallelFor(set.size(), threads, [&](size_t from, size_t to, int t) {
+        double sum = 0.0;
+        for (size_t i = from; i < to; i++) {
+            double e = set.result[i] - sigmoid(k, linearEval(set, i, w));
+            sum += e * e;
+        }
+        sums[t] = sum;
+    });
+    double total = 0.0;
+    for (double s : sums) total += s;
+    return total / set.size();
+}
+
+// golden section search for the K that best maps the current eval to results
+double fitScale(const TuningSet& set, const Weights& w, int threads)
+{
+    double lo = 0.1, hi = 5.0;
+    const double ratio = 0.6180339887;
+    for (int i = 0; i < 40; i++) {
+        double a = hi - ratio * (hi - lo);
+        double b = lo + ratio * (hi - lo);
+        if (meanError(set, w, a, threads) < meanError(set, w, b, threads)) hi = b;
+        else lo = a;
+    }
+    return (lo + hi) * 0.5;
+}
+
+void computeGradient(const TuningSet& set, const Weights& w, double k, int threads, Weights& grad)
+{
+    std::vector<Weights> partial(threads);
+    parallelFor(set.size(), threads, [&](size_t from, size_t to, int t) {
+        Weights& g = partial[t];
+        std::fill(std::begin(g.mg), std::end(g.mg), 0.0);
+        std::fill(std::begin(g.eg), std::end(g.eg), 0.0);
+        for (size_t i = from; i < to; i++) {
+            double s = sigmoid(k, linearEval(set, i, w));
+            double d = -2.0 * (set.result[i] - s) * s * (1.0 - s) * k / 400.0;
+            double dMg = d * set.phase[i];
+            double dEg = d * (1.0 - set.phase[i]);
+            for (uint32_t c = set.begin[i]; c < set.begin[i + 1]; c++) {
+                g.mg[set.index[c]] += dMg * set.coeff[c];
+                g.eg[set.index[c]] += dEg * set.coeff[c];
+            }
+        }
+    });
+
+    for (int i = 0; i < kNumWeights; i++) {
+        grad.mg[i] = grad.eg[i] = 0.0;
+        for (const Weights& g : partial) {
+            grad.mg[i] += g.mg[i];
+            grad.eg[i] += g.eg[i];
+        }
+        grad.mg[i] /= set.size();
+        grad.eg[i] /= set.size();
+    }
+}
+
+void writeTable(std::ofstream& out, const char* name, const Weights& w, bool mg)
+{
+    static const char* names[] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+    out << "constexpr int " << name << "[7][64] = {\n    {},\n";
+    for (int piece = 0; piece < 6; piece++) {
+        out << "    // " << names[piece] << "\n";
+        for (int sq = 0; sq < 64; sq++) {
+            double v = mg ? w.mg[kPstBase + piece * 64 + sq] : w.eg[kPstBase + piece * 64 + sq];
+            char buf[16];
+            std::snprintf(buf, sizeof(buf), "%3ld", std::lround(v));
+            out << (sq % 8 == 0 ? (sq == 0 ? "    { " : "      ") : " ") << buf
+                << (sq == 63 ? " },\n" : (sq % 8 == 7 ? ",\n" : ","));
+        }
+    }
+    out << "};\n";
+}
+
+bool writeHeader(const std::string& path, const Weights& w)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+
+    auto value = [](double v) { return std::to_string(std::lround(v)); };
+    out << "#pragma once\n\n"
+        << "//\n"
+        << "// evaluation weights, middlegame / endgame pairs blended by game phase\n"
+        << "// texel_tuner rewrites this file, keep the layout it prints\n"
+        << "//\n"
+        << "// piece-square tables are laid out as you look at the board from white's side\n"
+        << "// (first row is rank 8), so a white piece on square sq reads entry sq ^ 56\n"
+        << "// and a black piece reads entry sq\n"
+        << "//\n\n"
+        << "constexpr int kPhaseWeight[7] = { 0, 0, 1, 1, 2, 4, 0 };\n"
+        << "constexpr int kMaxPhase = 24;\n\n";
+
+    out << "constexpr int kPieceValueMg[7] = { 0";
+    for (int p = 0; p < 5; p++) out << ", " << value(w.mg[kMaterialBase + p]);
+    out << ", 0 };\n";
+    out << "constexpr int kPieceValueEg[7] = { 0";
+    for (int p = 0; p < 5; p++) out << ", " << value(w.eg[kMaterialBase + p]);
+    out << ", 0 };\n\n";
+
+    out << "constexpr int kBishopPairMg = " << value(w.mg[kBishopPairIndex]) << ";\n";
+    out << "constexpr int kBishopPairEg = " << value(w.eg[kBishopPairIndex]) << ";\n\n";
+
+    writeTable(out, "kPstMg", w, true);
+    out << "\n";
+    writeTable(out, "kPstEg", w, false);
+    return (bool)out;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 3) return false;
+    opt.outPath = argv[1];
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            opt.dataPaths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--iterations") opt.iterations = std::atoi(value);
+        else if (arg == "--threads") opt.threads = std::max(1, std::atoi(value));
+        else if (arg == "--lr") opt.learningRate = std::atof(value);
+        else return false;
+    }
+    return !opt.dataPaths.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: texel_tuner <out EvalParams.h> <data.bin> [more.bin ...] [--iterations N] [--threads N] [--lr F]\n");
+        return 1;
+    }
+
+    std::vector<PackedPosition> data;
+    for (const std::string& path : opt.dataPaths) {
+        if (!readPackedPositions(path, data)) {
+            std::fprintf(stderr, "could not read %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    TuningSet set = buildTuningSet(data, opt.threads);
+    data.clear();
+    data.shrink_to_fit();
+    if (!set.size()) {
+        std::fprintf(stderr, "no positions\n");
+        return 1;
+    }
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu positions resolved in %.1f s, %zu coefficients\n", set.size(), buildSeconds, set.index.size());
+
+    Weights w;
+    loadCurrentWeights(w);
+    double k = fitScale(set, w, opt.threads);
+    std::printf("K = %.4f, starting error %.6f\n", k, meanError(set, w, k, opt.threads));
+
+    // Adam
+    Weights m{}, v{}, grad;
+    const double beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+    for (int it = 1; it <= opt.iterations; it++) {
+        computeGradient(set, w, k, opt.threads, grad);
+        double c1 = 1.0 - std::pow(beta1, it);
+        double c2 = 1.0 - std::pow(beta2, it);
+        auto step = [&](double& param, double& mi, double& vi, double g) {
+            mi = beta1 * mi + (1.0 - beta1) * g;
+            vi = beta2 * vi + (1.0 - beta2) * g * g;
+            param -= opt.learningRate * (mi / c1) / (std::sqrt(vi / c2) + eps);
+        };
+        for (int i = 0; i < kNumWeights; i++) {
+            step(w.mg[i], m.mg[i], v.mg[i], grad.mg[i]);
+            step(w.eg[i], m.eg[i], v.eg[i], grad.eg[i]);
+        }
+        if (it % 50 == 0 || it == opt.iterations) {
+            std::printf("iteration %d  error %.6f\n", it, meanError(set, w, k, opt.threads));
+            std::fflush(stdout);
+        }
+    }
+
+    if (!writeHeader(opt.outPath, w)) {
+        std::fprintf(stderr, "could not write %s\n", opt.outPath.c_str());
+        return 1;
+    }
+    std::printf("wrote %s\n", opt.outPath.c_str());
+    return 0;
+}